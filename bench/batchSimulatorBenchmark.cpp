@@ -0,0 +1,147 @@
+
+//Compares the simulation speed of BatchSimulator with running an
+//AIGameManager for each car, on one thread.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "AIGameManager.hpp"
+#include "BatchSimulator.hpp"
+#include "Track/createCircleTrack.hpp"
+
+using namespace car;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double getSeconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//The car physics of BatchSimulator::moveLanes() alone: the vectorized loop
+//over the lanes, and the same loop calling the scalar Car::moveLinear() for
+//each lane, as the lanes were moved before.
+void benchmarkPhysics(std::size_t carCount, float timeStep) {
+	const int stepCount = 20000;
+	std::vector<float> throttle(carCount), brake(carCount), orientationX(carCount), orientationY(carCount);
+	for (std::size_t i = 0; i < carCount; ++i) {
+		throttle[i] = (i % 3) / 2.f;
+		brake[i] = (i % 5 == 0) ? 0.5f : 0.f;
+		orientationX[i] = std::cos(i * 0.1f);
+		orientationY[i] = std::sin(i * 0.1f);
+	}
+	typedef std::vector<float> Lanes;
+	Lanes px, py, vx, vy, ax, ay, distance;
+	auto reset = [&] {
+		for (Lanes* lanes : {&px, &py, &vx, &vy, &ax, &ay, &distance}) {
+			lanes->assign(carCount, 0.f);
+		}
+	};
+
+	double scalarTime = 0.0;
+	double laneTime = 0.0;
+	Lanes scalarDistances;
+	for (int repeat = 0; repeat < 5; ++repeat) {
+		reset();
+		auto start = Clock::now();
+		for (int step = 0; step < stepCount; ++step) {
+			for (std::size_t i = 0; i < carCount; ++i) {
+				Car::moveLinear(timeStep, throttle[i], brake[i], orientationX[i], orientationY[i],
+						px[i], py[i], vx[i], vy[i], ax[i], ay[i], distance[i]);
+			}
+		}
+		double time = getSeconds(start);
+		scalarTime = repeat == 0 ? time : std::min(scalarTime, time);
+		scalarDistances = distance;
+
+		reset();
+		start = Clock::now();
+		for (int step = 0; step < stepCount; ++step) {
+			Car::moveLinear(carCount, timeStep, throttle.data(), brake.data(),
+					orientationX.data(), orientationY.data(), px.data(), py.data(),
+					vx.data(), vy.data(), ax.data(), ay.data(), distance.data());
+		}
+		time = getSeconds(start);
+		laneTime = repeat == 0 ? time : std::min(laneTime, time);
+	}
+
+	const double steps = static_cast<double>(stepCount) * carCount;
+	std::cout << "physics only, " << stepCount << " steps of " << carCount << " cars\n" <<
+			std::fixed << std::setprecision(0) <<
+			"scalar moveLinear: " << steps / scalarTime << " steps/s\n" <<
+			"lane moveLinear:   " << steps / laneTime << " steps/s\n" <<
+			std::setprecision(2) << "speedup: " << scalarTime / laneTime << "\n" <<
+			"same result: " << (scalarDistances == distance ? "yes" : "no") << std::endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+	const std::size_t carCount = argc > 1 ? std::atoi(argv[1]) : 64;
+	const int repeats = 5;
+
+	Parameters parameters;
+	parameters.seed = 1;
+	track::TrackPtr track = std::make_shared<const track::Track>(
+			track::createCircleTrack(track::CircleTrackParams{}));
+
+	RandomEngine engine{parameters.seed};
+	std::vector<NeuralNetwork> networks;
+	for (std::size_t i = 0; i < carCount; ++i) {
+		networks.emplace_back(parameters.hiddenLayerCount, parameters.neuronPerHiddenLayer,
+			parameters.getInputNeuronCount(), parameters.outputNeuronCount, parameters.useRecurrence);
+		networks.back().randomizeWeights(engine);
+	}
+	std::vector<Weights> weights;
+	for (const NeuralNetwork& network : networks) {
+		weights.push_back(network.getWeights());
+	}
+
+	std::vector<float> scalarFitnesses(carCount);
+	AIGameManager manager{parameters, track};
+	BatchSimulator simulator{parameters, track};
+	for (const Weights& carWeights : weights) {
+		simulator.addCar(carWeights.data());
+	}
+
+	double scalarTime = 0.0;
+	double batchTime = 0.0;
+	for (int i = 0; i < repeats; ++i) {
+		auto start = Clock::now();
+		for (std::size_t j = 0; j < carCount; ++j) {
+			manager.setNeuralNetwork(networks[j]);
+			manager.init();
+			manager.run();
+			scalarFitnesses[j] = manager.getFitness();
+		}
+		double time = getSeconds(start);
+		scalarTime = i == 0 ? time : std::min(scalarTime, time);
+
+		start = Clock::now();
+		simulator.run();
+		time = getSeconds(start);
+		batchTime = i == 0 ? time : std::min(batchTime, time);
+	}
+
+	float maxDifference = 0.f;
+	for (std::size_t i = 0; i < carCount; ++i) {
+		maxDifference = std::max(maxDifference,
+				std::abs(simulator.getFitness(i) - scalarFitnesses[i]));
+	}
+
+	const double steps = simulator.getStepCount();
+	std::cout << "cars: " << carCount << ", steps: " << steps << ", best of " << repeats << " runs\n" <<
+			std::fixed << std::setprecision(0) <<
+			"AIGameManager:  " << steps / scalarTime << " steps/s\n" <<
+			"BatchSimulator: " << steps / batchTime << " steps/s\n" <<
+			std::setprecision(2) << "speedup: " << scalarTime / batchTime << "\n" <<
+			std::setprecision(6) << "largest fitness difference: " << maxDifference << std::endl;
+
+	benchmarkPhysics(carCount, 1.f/parameters.physicsTimeStepsPerSecond);
+}
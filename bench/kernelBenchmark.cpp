@@ -0,0 +1,324 @@
+
+//Micro-benchmarks of the hot paths of the simulation: line intersection,
+//ray casting on every shipped track, car physics, network evaluation and
+//the fitness expression.
+//
+//Every benchmark is calibrated to run at least minSampleSeconds per sample,
+//then sampleCount samples are taken. The output is CSV with the median, the
+//minimum and the median absolute deviation of the time of an operation, so
+//the results of two builds can be compared line by line. The median and the
+//MAD are not thrown off by the occasional sample disturbed by the system.
+//
+//Usage: kernelBenchmark [name filter [tracks directory]]
+//Every .track file under the tracks directory is benchmarked. The benchmark
+//fails if one of them can't be loaded.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "AIGameManager.hpp"
+#include "Car.hpp"
+#include "LineIntersection.hpp"
+#include "MathExpression.hpp"
+#include "Model.hpp"
+#include "NeuralNetwork.hpp"
+#include "Parameters.hpp"
+#include "randomUtil.hpp"
+#include "Track/Track.hpp"
+#include "Track/TrackArgumentParser.hpp"
+
+using namespace car;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int sampleCount = 21;
+const double minSampleSeconds = 0.01;
+
+//keeps the compiler from optimizing the work away
+volatile float sink = 0.f;
+
+//Runs the given number of operations.
+typedef std::function<void(std::size_t operations)> Kernel;
+
+double runSample(const Kernel& kernel, std::size_t operations) {
+	const auto start = Clock::now();
+	kernel(operations);
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void measure(const std::string& name, const std::string& filter, const Kernel& kernel) {
+	if (name.find(filter) == std::string::npos) {
+		return;
+	}
+
+	//doubles the operations until a sample is long enough to be timed reliably
+	std::size_t operations = 1;
+	while (runSample(kernel, operations) < minSampleSeconds) {
+		operations *= 2;
+	}
+
+	std::vector<double> nanoseconds(sampleCount);
+	for (double& time : nanoseconds) {
+		time = runSample(kernel, operations) * 1e9 / operations;
+	}
+	std::sort(nanoseconds.begin(), nanoseconds.end());
+	const double median = nanoseconds[sampleCount / 2];
+
+	std::vector<double> deviations;
+	for (double time : nanoseconds) {
+		deviations.push_back(std::abs(time - median));
+	}
+	std::sort(deviations.begin(), deviations.end());
+
+	std::cout << name << "," << sampleCount << "," << operations << "," <<
+			std::fixed << std::setprecision(2) <<
+			median << "," << nanoseconds.front() << "," << deviations[sampleCount / 2] <<
+			std::endl;
+}
+
+struct NamedTrack {
+	std::string name;
+	track::TrackPtr track;
+};
+
+//Adds the .track files under directory + prefix to names, relative to
+//directory.
+void findTrackFiles(const std::string& directory, const std::string& prefix,
+		std::vector<std::string>& names) {
+	DIR* dir = opendir((directory + prefix).c_str());
+	if (dir == nullptr) {
+		return;
+	}
+	while (const dirent* entry = readdir(dir)) {
+		const std::string name = entry->d_name;
+		struct stat status;
+		if (name == "." || name == ".." ||
+				stat((directory + prefix + name).c_str(), &status) != 0) {
+			continue;
+		}
+		if (S_ISDIR(status.st_mode)) {
+			findTrackFiles(directory, prefix + name + "/", names);
+		} else if (name.size() > 6 && name.compare(name.size() - 6, 6, ".track") == 0) {
+			names.push_back(prefix + name);
+		}
+	}
+	closedir(dir);
+}
+
+//Loads every track under tracksPath, in the order of their names. Returns
+//false if a track can't be loaded or there are none.
+bool loadTracks(const std::string& tracksPath, std::vector<NamedTrack>& tracks) {
+	std::vector<std::string> names;
+	findTrackFiles(tracksPath, "", names);
+	std::sort(names.begin(), names.end());
+	if (names.empty()) {
+		std::cerr << "No tracks found in " << tracksPath << std::endl;
+		return false;
+	}
+
+	bool success = true;
+	for (const std::string& name : names) {
+		try {
+			//random tracks get a fixed seed, the others ignore it
+			auto creators = track::trackArgumentParser::parseArguments({tracksPath + name + ":1"});
+			tracks.push_back(NamedTrack{name.substr(0, name.size() - 6),
+					track::createTrack(creators.front())});
+		} catch (const std::exception& e) {
+			std::cerr << "Can't load " << name << ": " << e.what() << std::endl;
+			success = false;
+		}
+	}
+	return success;
+}
+
+//Segments and rays around the checkpoints of the track, where the cars are.
+struct TrackQueries {
+	std::vector<Line2f> segments;
+	std::vector<sf::Vector2f> origins;
+	std::vector<sf::Vector2f> directions;
+};
+
+TrackQueries createQueries(const track::Track& track, RandomEngine& engine) {
+	const std::size_t count = 1024;
+	TrackQueries queries;
+	for (std::size_t i = 0; i < count; ++i) {
+		const Line2f& checkpoint = track.getCheckpoint(i % track.getNumberOfCheckpoints());
+		const float ratio = randomReal(engine, 0.f, 1.f);
+		const sf::Vector2f origin = checkpoint.start + (checkpoint.end - checkpoint.start) * ratio;
+		const float angle = randomReal(engine, 0.f, 2.f * static_cast<float>(M_PI));
+		const sf::Vector2f direction{std::cos(angle), std::sin(angle)};
+
+		queries.origins.push_back(origin);
+		queries.directions.push_back(direction);
+		queries.segments.push_back(Line2f{origin, origin + direction * Model::maxViewDistance});
+	}
+	return queries;
+}
+
+void benchmarkTrack(const NamedTrack& namedTrack, const std::string& filter) {
+	const track::Track& track = *namedTrack.track;
+	RandomEngine engine{1};
+	const TrackQueries queries = createQueries(track, engine);
+	const std::size_t lineCount = track.getNumberOfLines();
+	const std::size_t queryCount = queries.segments.size();
+
+	measure("intersects/" + namedTrack.name, filter, [&](std::size_t operations) {
+			sf::Vector2f point;
+			float sum = 0.f;
+			for (std::size_t i = 0; i < operations; ++i) {
+				if (intersects(queries.segments[i % queryCount], track.getLine(i % lineCount), &point)) {
+					sum += point.x;
+				}
+			}
+			sink = sum;
+		});
+
+	measure("LineIntersection/" + namedTrack.name, filter, [&](std::size_t operations) {
+			float sum = 0.f;
+			for (std::size_t i = 0; i < operations; ++i) {
+				LineIntersection<float> intersection{queries.segments[i % queryCount],
+						track.getLine(i % lineCount)};
+				if (auto point = intersection.getIntersectionPoint()) {
+					sum += point->x;
+				}
+			}
+			sink = sum;
+		});
+
+	measure("collideWithRay/" + namedTrack.name, filter, [&](std::size_t operations) {
+			float sum = 0.f;
+			for (std::size_t i = 0; i < operations; ++i) {
+				sum += track.collideWithRay(queries.origins[i % queryCount],
+						queries.directions[i % queryCount], Model::maxViewDistance).x;
+			}
+			sink = sum;
+		});
+}
+
+void benchmarkCar(const std::string& filter) {
+	const float timeStep = 1.f / 64.f;
+	measure("Car::move", filter, [&](std::size_t operations) {
+			Car car;
+			for (std::size_t i = 0; i < operations; ++i) {
+				//changing controls, so every branch of the physics is used
+				car.setThrottle((i & 64) ? 1.f : 0.f);
+				car.setBrake((i & 192) == 192 ? 1.f : 0.f);
+				car.setTurnLevel((i & 32) ? 0.5f : -0.5f);
+				car.move(timeStep);
+			}
+			sink = car.getTravelDistance();
+		});
+}
+
+void benchmarkNetwork(const std::string& name, const std::string& filter,
+		unsigned hiddenLayerCount, unsigned hiddenLayerNeuronCount, bool useRecurrence) {
+	Parameters parameters;
+	NeuralNetwork network{hiddenLayerCount, hiddenLayerNeuronCount,
+			parameters.getInputNeuronCount(), parameters.outputNeuronCount, useRecurrence};
+	RandomEngine engine{1};
+	network.randomizeWeights(engine);
+
+	std::vector<Weights> inputs(64, Weights(parameters.getInputNeuronCount()));
+	for (Weights& input : inputs) {
+		for (Weight& value : input) {
+			value = randomReal(engine, 0.f, 1.f);
+		}
+	}
+
+	measure("evaluateInput/" + name, filter, [&](std::size_t operations) {
+			float sum = 0.f;
+			for (std::size_t i = 0; i < operations; ++i) {
+				sum += network.evaluateInput(inputs[i % inputs.size()])[0];
+			}
+			sink = sum;
+		});
+
+	//an operation is one row, like a car of a genome on one of 8 tracks
+	const std::size_t rows = 8;
+	Weights batch;
+	for (std::size_t i = 0; i < rows; ++i) {
+		batch.insert(batch.end(), inputs[i].begin(), inputs[i].end());
+	}
+	std::vector<Weights> states(rows, Weights(network.getRecurrentStateSize()));
+	std::vector<Weight*> statePointers;
+	for (Weights& state : states) {
+		statePointers.push_back(state.data());
+	}
+	measure("evaluateInputs8/" + name, filter, [&](std::size_t operations) {
+			float sum = 0.f;
+			for (std::size_t i = 0; i < operations; i += rows) {
+				sum += network.evaluateInputs(batch.data(), rows, statePointers.data())[0];
+			}
+			sink = sum;
+		});
+}
+
+void benchmarkExpression(const std::string& filter) {
+	Parameters parameters;
+	const CompiledMathExpression compiled{parameters.fitnessExpression,
+			AIGameManager::getFitnessSymbols()};
+
+	measure("evaluateMathExpression", filter, [&](std::size_t operations) {
+			float sum = 0.f;
+			SymbolTable symbols{{"td", 0.f}, {"cps", 40.f}, {"ccps", 0.f}};
+			for (std::size_t i = 0; i < operations; ++i) {
+				symbols["td"] = static_cast<float>(i % 1000);
+				symbols["ccps"] = static_cast<float>(i % 80);
+				sum += evaluateMathExpression(parameters.fitnessExpression, symbols);
+			}
+			sink = sum;
+		});
+
+	measure("CompiledMathExpression", filter, [&](std::size_t operations) {
+			float sum = 0.f;
+			FormulaValue slots[] = {0.f, 40.f, 0.f};
+			for (std::size_t i = 0; i < operations; ++i) {
+				slots[0] = static_cast<float>(i % 1000);
+				slots[2] = static_cast<float>(i % 80);
+				sum += compiled.evaluate(slots);
+			}
+			sink = sum;
+		});
+}
+
+}
+
+int main(int argc, char** argv) {
+	const std::string filter = argc > 1 ? argv[1] : "";
+
+	std::string binaryLocation = argv[0];
+	binaryLocation.erase(binaryLocation.find_last_of('/') + 1);
+	const std::string tracksPath = argc > 2 ? std::string{argv[2]} + "/" : binaryLocation + "../tracks/";
+
+	std::vector<NamedTrack> tracks;
+	if (!loadTracks(tracksPath, tracks)) {
+		return 1;
+	}
+
+	std::cout << "benchmark,samples,operations per sample,median ns/op,min ns/op,MAD ns/op" << std::endl;
+
+	for (const NamedTrack& track : tracks) {
+		benchmarkTrack(track, filter);
+	}
+	benchmarkCar(filter);
+
+	Parameters parameters;
+	benchmarkNetwork("default", filter, parameters.hiddenLayerCount,
+			parameters.neuronPerHiddenLayer, false);
+	benchmarkNetwork("default-recurrent", filter, parameters.hiddenLayerCount,
+			parameters.neuronPerHiddenLayer, true);
+	benchmarkNetwork("large", filter, 4, 64, false);
+
+	benchmarkExpression(filter);
+}
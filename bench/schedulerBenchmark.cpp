@@ -0,0 +1,116 @@
+
+//Compares TaskScheduler with the boost::asio based ThreadPool the training
+//used before. The io_service version waits for the tasks the same way as
+//PopulationRunner did: with a counter guarded by a mutex.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "TaskScheduler.hpp"
+#include "ThreadPool.hpp"
+
+using namespace car;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+//keeps the compiler from optimizing the work away
+std::atomic<float> sink{0.f};
+
+void work(unsigned iterations) {
+	float x = 1.f;
+	for (unsigned i = 0; i < iterations; ++i) {
+		x = x * 1.0001f + 0.5f;
+	}
+	sink.store(x, std::memory_order_relaxed);
+}
+
+double runIoService(boost::asio::io_service& ioService,
+		std::size_t taskCount, unsigned iterations) {
+	auto start = Clock::now();
+
+	std::condition_variable conditionVariable;
+	std::mutex mutex;
+	std::size_t tasksLeft = taskCount;
+
+	for (std::size_t i = 0; i < taskCount; ++i) {
+		ioService.post([&]() {
+				work(iterations);
+
+				std::unique_lock<std::mutex> lock{mutex};
+				if (--tasksLeft == 0) {
+					conditionVariable.notify_all();
+				}
+			});
+	}
+
+	{
+		std::unique_lock<std::mutex> lock{mutex};
+		while (tasksLeft != 0) {
+			conditionVariable.wait(lock);
+		}
+	}
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+double runTaskScheduler(TaskScheduler& scheduler,
+		std::size_t taskCount, unsigned iterations) {
+	auto start = Clock::now();
+	scheduler.parallelFor(0, taskCount, [iterations](std::size_t) { work(iterations); });
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+template<typename Function>
+double bestOf(int repeats, Function function) {
+	double best = function();
+	for (int i = 1; i < repeats; ++i) {
+		best = std::min(best, function());
+	}
+	return best;
+}
+
+}
+
+int main(int argc, char** argv) {
+	//the number of tasks and the work per task, like a generation of 60
+	//genomes on 4 tracks with short and long simulations
+	const std::size_t taskCount = argc > 1 ? std::atoi(argv[1]) : 240;
+	const int repeats = 5;
+	const unsigned threadCounts[] = {1, 2, 4, 8, 16, 32, 64};
+	const unsigned iterationCounts[] = {100, 10000, 1000000};
+
+	std::cout << "tasks: " << taskCount << ", best of " << repeats << " runs, time in ms\n";
+	std::cout << std::setw(8) << "threads" << std::setw(12) << "iterations" <<
+			std::setw(14) << "io_service" << std::setw(14) << "scheduler" << std::setw(10) << "ratio\n";
+
+	for (unsigned threads : threadCounts) {
+		ThreadPool threadPool;
+		threadPool.setNumThreads(threads);
+		ThreadPoolRunner runner{threadPool};
+
+		//the waiting thread works too
+		TaskScheduler scheduler{threads - 1};
+
+		for (unsigned iterations : iterationCounts) {
+			double ioServiceTime = bestOf(repeats, [&] {
+					return runIoService(threadPool.getIoService(), taskCount, iterations);
+				});
+			double schedulerTime = bestOf(repeats, [&] {
+					return runTaskScheduler(scheduler, taskCount, iterations);
+				});
+
+			std::cout << std::setw(8) << threads << std::setw(12) << iterations <<
+					std::fixed << std::setprecision(3) <<
+					std::setw(14) << ioServiceTime << std::setw(14) << schedulerTime <<
+					std::setw(10) << ioServiceTime / schedulerTime << std::endl;
+		}
+	}
+}
@@ -1,19 +1,21 @@
 
 #include "RealTimeGameManager.hpp"
+#include "Benchmark.hpp"
+#include "Checkpoint.hpp"
 #include "NeuralController.hpp"
 #include "Parameters.hpp"
-#include "ThreadPool.hpp"
+#include "TaskScheduler.hpp"
+#include "Trace.hpp"
 #include "Track/Track.hpp"
 #include "Track/TrackArgumentParser.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
 #include <string>
 #include <fstream>
 
-#include <boost/archive/text_iarchive.hpp>
-
 using namespace car;
 
 int main(int argc, char **argv) {
@@ -23,25 +25,36 @@ int main(int argc, char **argv) {
 	std::vector<std::function<track::Track()>> trackCreators =
 			track::trackArgumentParser::parseArguments(parameters.tracks);
 
-	if (parameters.isTrainingAI) {
-		ThreadPool threadPool;
-		threadPool.setNumThreads(parameters.threadCount);
-		ThreadPoolRunner runner{threadPool};
-		NeuralController controller{parameters, trackCreators, threadPool.getIoService()};
+	if (parameters.isBenchmarking) {
+		if (parameters.benchmarkOutputFile) {
+			const std::string& fileName = *parameters.benchmarkOutputFile;
+			std::ofstream ofs(fileName);
+			if (!ofs) {
+				std::cerr << "Can't open " << fileName << std::endl;
+				return 1;
+			}
+			runBenchmark(parameters, trackCreators, ofs);
+			if (!ofs) {
+				std::cerr << "Can't write " << fileName << std::endl;
+				return 1;
+			}
+		} else {
+			runBenchmark(parameters, trackCreators, std::cout);
+		}
+	} else if (parameters.isTrainingAI) {
+		trace::setThreadName("main");
+		//the main thread also runs tasks while it waits for them
+		TaskScheduler scheduler{std::max(parameters.threadCount, 1u) - 1};
+		NeuralController controller{parameters, trackCreators, scheduler};
 		controller.run();
 	} else {
-		RealTimeGameManager manager{parameters, trackCreators[0], parameters.neuralNetworkFile};
+		RealTimeGameManager manager{parameters, track::createTrack(trackCreators[0]),
+				static_cast<bool>(parameters.neuralNetworkFile)};
 
 		manager.setFPSLimit(parameters.fpsLimit);
 
 		if (parameters.neuralNetworkFile) {
-			NeuralNetwork network;
-
-			std::ifstream ifs(*parameters.neuralNetworkFile);
-			boost::archive::text_iarchive ia(ifs);
-			ia >> network;
-
-			manager.setNeuralNetwork(network);
+			manager.setNeuralNetwork(loadNeuralNetwork(*parameters.neuralNetworkFile));
 		}
 		manager.run();
 	}
@@ -11,28 +11,45 @@
 
 namespace car {
 
-AIGameManager::AIGameManager(const Parameters& parameters, std::function<track::Track()> trackCreator) :
-	GameManager(parameters, trackCreator) {}
+AIGameManager::AIGameManager(const Parameters& parameters, track::TrackPtr track) :
+	GameManager(parameters, std::move(track)),
+	fitnessExpression(parameters.fitnessExpression, getFitnessSymbols()),
+	stallLimits(getStallLimits(parameters)) {}
+
+const SymbolSlots& AIGameManager::getFitnessSymbols() {
+	static const SymbolSlots symbols{"td", "cps", "ccps"};
+	return symbols;
+}
 
 
 void AIGameManager::run() {
+	stallDetector.reset();
+	stallPolicy = StallPolicy::none;
 	while (!stopCondition()) {
 		advance();
+		if (stallLimits.isEnabled() && !model.hasCarCollided()) {
+			const Car& car = model.getCar();
+			stallPolicy = stallDetector.update(stallLimits, model.getCurrentTime(), car.getSpeed(),
+					model.getNumberOfCrossedCheckpoints(), model.getTrack(),
+					model.getCurrentCheckpoint(), car.getPosition());
+		}
 	}
 }
 
 float AIGameManager::getFitness() const {
-	SymbolTable symbolTable = {
-		{"td", model.getCar().getTravelDistance()},
-		{"cps", model.getTrack().getNumberOfCheckpoints()},
-		{"ccps", model.getNumberOfCrossedCheckpoints()}
+	//in the order of getFitnessSymbols()
+	const FormulaValue slots[] = {
+		model.getCar().getTravelDistance(),
+		static_cast<FormulaValue>(model.getTrack().getNumberOfCheckpoints()),
+		static_cast<FormulaValue>(model.getNumberOfCrossedCheckpoints())
 	};
 
-	return evaluateMathExpression(parameters.fitnessExpression, symbolTable);
+	return fitnessExpression.evaluate(slots);
 }
 
 bool AIGameManager::stopCondition() const {
-	return model.hasCarCollided() || model.getCurrentTime() > maxTime;
+	return model.hasCarCollided() || model.getCurrentTime() > maxTime ||
+			stallPolicy != StallPolicy::none;
 }
 
 }
@@ -2,22 +2,36 @@
 #define AIGAMEMANAGER_HPP
 
 #include "GameManager.hpp"
+#include "StallDetector.hpp"
 
 namespace car {
 
 class AIGameManager : public GameManager {
 public:
-	AIGameManager(const Parameters& parameters, std::function<track::Track()> trackCreator);
+	//Throws FormulaException if the fitness expression uses unknown symbols.
+	AIGameManager(const Parameters& parameters, track::TrackPtr track);
+
+	//The symbols the fitness expression can use
+	static const SymbolSlots& getFitnessSymbols();
 
 	void run();
 
 	//should be called after run()
 	float getFitness() const;
+	//the policy which stopped the car, StallPolicy::none if it crashed or
+	//ran out of time
+	StallPolicy getStallPolicy() const { return stallPolicy; }
 
 private:
 	bool stopCondition() const;
 
 	const float maxTime = 600.f;
+
+	CompiledMathExpression fitnessExpression;
+
+	StallLimits stallLimits;
+	StallDetector stallDetector;
+	StallPolicy stallPolicy = StallPolicy::none;
 };
 
 }
@@ -1,6 +1,7 @@
 #ifndef ASYNCHELPER_HPP_
 #define ASYNCHELPER_HPP_
 
+#include <exception>
 #include <future>
 #include <memory>
 #include <type_traits>
@@ -17,8 +18,14 @@ public:
 		return promise->get_future();
 	}
 
+	//Exceptions thrown by function are rethrown by the future.
 	void operator()() {
-		function();
+		try {
+			function();
+		} catch (...) {
+			promise->set_exception(std::current_exception());
+			return;
+		}
 		promise->set_value();
 	}
 private:
@@ -0,0 +1,552 @@
+#include "BatchSimulator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "AIGameManager.hpp"
+#include "Instrumentation.hpp"
+#include "Model.hpp"
+#include "mathUtil.hpp"
+
+namespace car {
+
+namespace {
+
+//The rays crossing a line at most this far from the car are found with the
+//near lines of the car. The rest are cast on the line grid.
+const float nearLinesRadius = 15.f;
+
+//The near lines are updated when the car moved this far from where they
+//were last updated.
+const float nearLinesMargin = 5.f;
+
+//the lines inside this distance from nearLinesCenter are the near lines
+const float nearLinesDistance = nearLinesRadius + nearLinesMargin + 1.f;
+
+//The near lines which can touch a car are selected again only after it moved
+//more than this.
+const float collisionMargin = 2.f;
+
+//The rays of Model::getRayDirection() are inside the fan |y| <= 2*x in the
+//coordinate system of the car. A line is left out of the ray casting if it's
+//on the outer side of a border of the near part of the fan by at least this
+//much, which is far more than the rounding errors.
+const float fanMargin = 1.f;
+
+std::size_t getLanePosition(std::size_t lane, std::size_t size, std::size_t index) {
+	const std::size_t width = NeuralNetwork::laneWidth;
+	return (lane / width * size + index) * width + lane % width;
+}
+
+void moveLane(std::vector<Weight>& lanes, std::size_t size, std::size_t from, std::size_t to) {
+	for (std::size_t i = 0; i < size; ++i) {
+		lanes[getLanePosition(to, size, i)] = lanes[getLanePosition(from, size, i)];
+	}
+}
+
+//writes the indices of the selected lines to the beginning of indices, which
+//is as long as selected, and returns their count
+std::size_t selectLines(const std::vector<unsigned>& selected, std::vector<unsigned>& indices) {
+	std::size_t count = 0;
+	for (std::size_t j = 0; j < selected.size(); ++j) {
+		indices[count] = j;
+		count += selected[j];
+	}
+	return count;
+}
+
+//The smallest getCrossingRatio() of each ray with the given lines, starting from
+//the values in ratios. rayCount is a multiple of 4, the rays are processed in
+//blocks of 4 which are vectorized, and their ratios stay in registers while
+//the lines are visited.
+void castRaysOnLines(const LineArrays& lines, const unsigned* lineIndices,
+		std::size_t lineCount, std::size_t rayCount,
+		const float* __restrict originX, const float* __restrict originY,
+		const float* __restrict rayX, const float* __restrict rayY, float* __restrict ratios) {
+	for (std::size_t i = 0; i < rayCount; i += 4) {
+		float blockRatios[4] = {ratios[i], ratios[i+1], ratios[i+2], ratios[i+3]};
+		for (std::size_t j = 0; j < lineCount; ++j) {
+			const float startX = lines.startX[lineIndices[j]];
+			const float startY = lines.startY[lineIndices[j]];
+			const float deltaX = lines.deltaX[lineIndices[j]];
+			const float deltaY = lines.deltaY[lineIndices[j]];
+			for (std::size_t k = 0; k < 4; ++k) {
+				blockRatios[k] = std::min(blockRatios[k], getCrossingRatio(
+						originX[i+k], originY[i+k], rayX[i+k], rayY[i+k],
+						startX, startY, deltaX, deltaY));
+			}
+		}
+		std::copy_n(blockRatios, 4, ratios + i);
+	}
+}
+
+//the same as Model::collidesWithTrack() with the lines, the sides of the car
+//are the rays of castRaysOnLines()
+bool collidesWithLines(const LineArrays& lines, const std::vector<unsigned>& lineIndices,
+		const Car::Corners& corners) {
+	const float originX[4] = {corners[0].x, corners[0].x, corners[1].x, corners[2].x};
+	const float originY[4] = {corners[0].y, corners[0].y, corners[1].y, corners[2].y};
+	const float sideX[4] = {corners[1].x - corners[0].x, corners[2].x - corners[0].x,
+			corners[3].x - corners[1].x, corners[3].x - corners[2].x};
+	const float sideY[4] = {corners[1].y - corners[0].y, corners[2].y - corners[0].y,
+			corners[3].y - corners[1].y, corners[3].y - corners[2].y};
+	const float infinity = std::numeric_limits<float>::infinity();
+	float ratios[4] = {infinity, infinity, infinity, infinity};
+	castRaysOnLines(lines, lineIndices.data(), lineIndices.size(), 4,
+			originX, originY, sideX, sideY, ratios);
+	return std::min(std::min(ratios[0], ratios[1]), std::min(ratios[2], ratios[3])) <= 1.f;
+}
+
+}
+
+BatchSimulator::BatchSimulator(const Parameters& parameters, track::TrackPtr track) :
+	BatchSimulator(parameters, std::vector<track::TrackPtr>{std::move(track)})
+{
+}
+
+BatchSimulator::BatchSimulator(const Parameters& parameters, std::vector<track::TrackPtr> tracks) :
+	physicsTimeStep(1.f/parameters.physicsTimeStepsPerSecond),
+	rayCount(parameters.rayCount),
+	rayStride((rayCount + 3) / 4 * 4),
+	stallLimits(getStallLimits(parameters)),
+	tracks(std::move(tracks)),
+	fitnessExpression(parameters.fitnessExpression, AIGameManager::getFitnessSymbols()),
+	prototypeNetwork(parameters.hiddenLayerCount, parameters.neuronPerHiddenLayer,
+		parameters.getInputNeuronCount(), parameters.outputNeuronCount, parameters.useRecurrence)
+{
+	for (unsigned i = 0; i < rayCount; ++i) {
+		rayDirections.push_back(Model::getRayDirection(i, rayCount));
+	}
+	rayOriginX.resize(rayStride);
+	rayOriginY.resize(rayStride);
+	rayInputs.resize(rayStride);
+	trackRays.resize(this->tracks.size());
+
+	for (const track::TrackPtr& track : this->tracks) {
+		startingCars.push_back(track->createCar());
+	}
+
+	//every car has the same shape
+	carRadius = 0.f;
+	for (const Car& car : startingCars) {
+		for (const sf::Vector2f& corner : car.getCorners()) {
+			carRadius = std::max(carRadius, getLength(corner - car.getPosition()));
+		}
+	}
+	//the lines which can touch a car are inside its near lines
+	assert(carRadius + collisionMargin + nearLinesMargin <= nearLinesRadius);
+}
+
+void BatchSimulator::clear() {
+	carCount = 0;
+	laneCount = 0;
+}
+
+std::size_t BatchSimulator::addCar(const Weight* weights, std::size_t trackIndex) {
+	assert(trackIndex < tracks.size());
+
+	if (carCount == cars.size()) {
+		cars.emplace_back();
+	}
+	CarData& car = cars[carCount];
+	car.weights = weights;
+	car.track = trackIndex;
+	return carCount++;
+}
+
+void BatchSimulator::run(float timeLimit) {
+	startLanes();
+	stepCount = 0;
+	networkCallCount = 0;
+	stallCounters = StallCounters{};
+
+	float currentTime = 0.f;
+	while (laneCount > 0 && currentTime <= timeLimit) {
+		stepCount += laneCount;
+		controlLanes();
+		currentTime += physicsTimeStep;
+		moveLanes();
+		collideLanes();
+
+		//backwards, so the lanes moved in place of the removed ones are
+		//already checked
+		for (std::size_t lane = laneCount; lane-- > 0;) {
+			if (collided[lane]) {
+				removeLane(lane);
+			}
+		}
+		if (stallLimits.isEnabled()) {
+			stopStalledLanes(currentTime, timeLimit);
+		}
+		senseLanes();
+	}
+
+	while (laneCount > 0) {
+		removeLane(laneCount - 1);
+	}
+}
+
+float BatchSimulator::getFitness(std::size_t car) const {
+	//in the order of AIGameManager::getFitnessSymbols()
+	const FormulaValue slots[] = {
+		cars[car].travelDistance,
+		static_cast<FormulaValue>(tracks[cars[car].track]->getNumberOfCheckpoints()),
+		static_cast<FormulaValue>(cars[car].crossedCheckpoints)
+	};
+
+	return fitnessExpression.evaluate(slots);
+}
+
+float BatchSimulator::getTravelDistance(std::size_t car) const {
+	return cars[car].travelDistance;
+}
+
+unsigned BatchSimulator::getNumberOfCrossedCheckpoints(std::size_t car) const {
+	return cars[car].crossedCheckpoints;
+}
+
+void BatchSimulator::startLanes() {
+	laneCount = carCount;
+	for (auto* lanes : {&positionX, &positionY, &velocityX, &velocityY,
+			&orientationX, &orientationY, &accelerationX, &accelerationY,
+			&travelDistance, &throttleLevel, &brakeLevel, &turnLevel}) {
+		lanes->assign(laneCount, 0.f);
+	}
+	collided.assign(laneCount, false);
+	laneCars.resize(laneCount);
+
+	const std::size_t width = NeuralNetwork::laneWidth;
+	const std::size_t groupCount = (laneCount + width - 1) / width;
+	const std::size_t weightCount = prototypeNetwork.getWeightCount();
+	laneWeights.assign(groupCount * weightCount * width, 0.f);
+	laneStates.assign(groupCount * prototypeNetwork.getRecurrentStateSize() * width, 0.f);
+	laneInputs.assign(groupCount * prototypeNetwork.getInputNeuronCount() * width, 0.f);
+
+	for (std::size_t lane = 0; lane < laneCount; ++lane) {
+		CarData& car = cars[lane];
+		const Car& startingCar = startingCars[car.track];
+		laneCars[lane] = lane;
+		positionX[lane] = startingCar.getPosition().x;
+		positionY[lane] = startingCar.getPosition().y;
+		orientationX[lane] = startingCar.getOrientation().x;
+		orientationY[lane] = startingCar.getOrientation().y;
+
+		for (std::size_t i = 0; i < weightCount; ++i) {
+			laneWeights[getLanePosition(lane, weightCount, i)] = car.weights[i];
+		}
+		car.rotation = Car::getRotation(startingCar.getOrientation());
+		car.corners = startingCar.getCorners();
+		car.travelDistance = 0.f;
+		car.crossedCheckpoints = 0;
+		car.currentCheckpoint = -1;
+		car.stallDetector.reset();
+		car.hasNearLines = false;
+		car.hasCollisionLines = false;
+		updateNearLines(lane);
+	}
+	senseLanes();
+}
+
+void BatchSimulator::controlLanes() {
+	CAR_TIME_PHASE(inference);
+	const std::size_t width = NeuralNetwork::laneWidth;
+	const std::size_t weightCount = prototypeNetwork.getWeightCount();
+	const std::size_t stateCount = prototypeNetwork.getRecurrentStateSize();
+	const std::size_t inputCount = prototypeNetwork.getInputNeuronCount();
+
+	for (std::size_t begin = 0; begin < laneCount; begin += width) {
+		const std::size_t group = begin / width;
+		const Weights& outputs = prototypeNetwork.evaluateLanes(
+				laneWeights.data() + group*weightCount*width,
+				laneInputs.data() + group*inputCount*width,
+				laneStates.data() + group*stateCount*width);
+		++networkCallCount;
+		assert(outputs.size() == 3 * width);
+
+		//the same as GameManager::handleInput() and Model::advanceTime()
+		for (std::size_t lane = begin; lane < std::min(begin + width, laneCount); ++lane) {
+			const Weight* output = outputs.data() + lane % width;
+			throttleLevel[lane] = Car::getDecreasedThrottle(
+					clamp((2.f/3.f)*output[0] + (2.f/3.f), 0.f, 1.f), physicsTimeStep);
+			brakeLevel[lane] = Car::getDecreasedBrake(
+					clamp((2.f/3.f)*output[width] + (1.f/3.f), 0.f, 1.f), physicsTimeStep);
+			turnLevel[lane] = Car::getStraightenedTurnLevel(output[2*width], physicsTimeStep);
+		}
+	}
+}
+
+void BatchSimulator::moveLanes() {
+	CAR_TIME_PHASE(physics);
+	const float deltaSeconds = physicsTimeStep;
+	Car::moveLinear(laneCount, deltaSeconds, throttleLevel.data(), brakeLevel.data(),
+			orientationX.data(), orientationY.data(), positionX.data(), positionY.data(),
+			velocityX.data(), velocityY.data(), accelerationX.data(), accelerationY.data(),
+			travelDistance.data());
+
+	for (std::size_t lane = 0; lane < laneCount; ++lane) {
+		sf::Vector2f orientation = Car::turn(deltaSeconds, turnLevel[lane],
+				{orientationX[lane], orientationY[lane]});
+		orientationX[lane] = orientation.x;
+		orientationY[lane] = orientation.y;
+
+		//the rotation is used for the rays too
+		CarData& car = cars[laneCars[lane]];
+		car.rotation = Car::getRotation(orientation);
+		Car::calculateCorners({positionX[lane], positionY[lane]}, car.rotation, car.corners);
+	}
+}
+
+void BatchSimulator::collideLanes() {
+	CAR_TIME_PHASE(collision);
+	for (std::size_t lane = 0; lane < laneCount; ++lane) {
+		updateNearLines(lane);
+		updateCollisionLines(lane);
+
+		const CarData& car = cars[laneCars[lane]];
+		collided[lane] = collidesWithLines(car.nearLines, car.collisionLines, car.corners);
+	}
+	for (std::size_t lane = 0; lane < laneCount; ++lane) {
+		CarData& car = cars[laneCars[lane]];
+		car.crossedCheckpoints += Model::handleCheckpoints(
+				*tracks[car.track], car.corners, car.currentCheckpoint);
+	}
+}
+
+void BatchSimulator::updateNearLines(std::size_t lane) {
+	CarData& car = cars[laneCars[lane]];
+	const sf::Vector2f position{positionX[lane], positionY[lane]};
+	if (car.hasNearLines &&
+			std::abs(position.x - car.nearLinesCenter.x) <= nearLinesMargin &&
+			std::abs(position.y - car.nearLinesCenter.y) <= nearLinesMargin) {
+		return;
+	}
+
+	car.nearLines.clear();
+	tracks[car.track]->getLinesNear(sf::FloatRect{position.x - nearLinesDistance,
+			position.y - nearLinesDistance, 2*nearLinesDistance, 2*nearLinesDistance}, car.nearLines);
+	car.nearLinesCenter = position;
+	car.hasNearLines = true;
+	car.hasCollisionLines = false;
+}
+
+void BatchSimulator::updateCollisionLines(std::size_t lane) {
+	CarData& car = cars[laneCars[lane]];
+	const float originX = positionX[lane];
+	const float originY = positionY[lane];
+	if (car.hasCollisionLines &&
+			std::abs(originX - car.collisionLinesCenter.x) <= collisionMargin &&
+			std::abs(originY - car.collisionLinesCenter.y) <= collisionMargin) {
+		return;
+	}
+
+	//selected without branches, so the first loop is vectorized
+	const LineArrays& nearLines = car.nearLines;
+	const std::size_t nearLineCount = nearLines.size();
+	const float distance = carRadius + collisionMargin + 1.f;
+	lineSelected.resize(nearLineCount);
+	for (std::size_t j = 0; j < nearLineCount; ++j) {
+		const float startX = nearLines.startX[j] - originX;
+		const float startY = nearLines.startY[j] - originY;
+		const float endX = startX + nearLines.deltaX[j];
+		const float endY = startY + nearLines.deltaY[j];
+		lineSelected[j] = !(((startX < -distance) & (endX < -distance)) |
+				((startX > distance) & (endX > distance)) |
+				((startY < -distance) & (endY < -distance)) |
+				((startY > distance) & (endY > distance)));
+	}
+	car.collisionLines.resize(nearLineCount);
+	car.collisionLines.resize(selectLines(lineSelected, car.collisionLines));
+	car.collisionLinesCenter = sf::Vector2f{originX, originY};
+	car.hasCollisionLines = true;
+}
+
+void BatchSimulator::senseLanes() {
+	CAR_TIME_PHASE(rayCasting);
+	const float wallDistanceDamping = 5.f;
+	const float speedDamping = 5.f;
+	const float checkpointDirectionDamping = 0.2f;
+
+	const std::size_t rayCountTotal = laneCount * rayStride;
+	for (auto* rays : {&rayDirectionX, &rayDirectionY, &rayX, &rayY, &rayRatios}) {
+		rays->resize(rayCountTotal);
+	}
+
+	//the same as Model::getRayPoints(), the directions after the first
+	//rayCount of a lane stay 0, so they don't cross anything
+	for (std::size_t lane = 0; lane < laneCount; ++lane) {
+		const sf::Transform& rotation = cars[laneCars[lane]].rotation;
+		for (unsigned i = 0; i < rayCount; ++i) {
+			const sf::Vector2f direction = rotation.transformPoint(rayDirections[i]);
+			rayDirectionX[lane*rayStride + i] = direction.x;
+			rayDirectionY[lane*rayStride + i] = direction.y;
+		}
+	}
+	track::Track::getRays(rayCountTotal, rayDirectionX.data(), rayDirectionY.data(),
+			Model::maxViewDistance, rayX.data(), rayY.data());
+
+	//The near part of the rays is inside the near lines, so if a ray crosses
+	//one of them there, no other line can be nearer.
+	const float nearRatio = nearLinesRadius / Model::maxViewDistance;
+	for (std::vector<std::size_t>& rays : trackRays) {
+		rays.clear();
+	}
+	for (std::size_t lane = 0; lane < laneCount; ++lane) {
+		CarData& car = cars[laneCars[lane]];
+		const float originX = positionX[lane];
+		const float originY = positionY[lane];
+		const sf::Vector2f forward = car.rotation.transformPoint({1.f, 0.f});
+		const sf::Vector2f left = car.rotation.transformPoint({0.f, 1.f});
+
+		//the near lines which can cross the near part of the rays, selected
+		//without branches, so the first loop is vectorized
+		const LineArrays& nearLines = car.nearLines;
+		const std::size_t nearLineCount = nearLines.size();
+		lineSelected.resize(nearLineCount);
+		for (std::size_t j = 0; j < nearLineCount; ++j) {
+			const float offsetX = nearLines.startX[j] - originX;
+			const float offsetY = nearLines.startY[j] - originY;
+			const float startX = offsetX*forward.x + offsetY*forward.y;
+			const float startY = offsetX*left.x + offsetY*left.y;
+			const float endOffsetX = offsetX + nearLines.deltaX[j];
+			const float endOffsetY = offsetY + nearLines.deltaY[j];
+			const float endX = endOffsetX*forward.x + endOffsetY*forward.y;
+			const float endY = endOffsetX*left.x + endOffsetY*left.y;
+			const bool behind = (startX < -fanMargin) & (endX < -fanMargin);
+			const bool beyond = (startX > nearLinesRadius + fanMargin) & (endX > nearLinesRadius + fanMargin);
+			const bool leftOf = (startY - 2*startX > 3*fanMargin) & (endY - 2*endX > 3*fanMargin);
+			const bool rightOf = (-startY - 2*startX > 3*fanMargin) & (-endY - 2*endX > 3*fanMargin);
+			//the near part of the fan is inside the circle of nearLinesRadius too
+			const float reach = nearLinesRadius + fanMargin;
+			const bool aside = ((startY > reach) & (endY > reach)) | ((startY < -reach) & (endY < -reach));
+			const float cross = offsetX*nearLines.deltaY[j] - offsetY*nearLines.deltaX[j];
+			const float lengthSquared = nearLines.deltaX[j]*nearLines.deltaX[j] +
+					nearLines.deltaY[j]*nearLines.deltaY[j];
+			const bool passes = cross*cross > reach*reach*lengthSquared;
+			lineSelected[j] = !(behind | beyond | leftOf | rightOf | aside | passes);
+		}
+		fanLines.resize(nearLineCount);
+		const std::size_t fanLineCount = selectLines(lineSelected, fanLines);
+
+		const float* laneRayX = rayX.data() + lane*rayStride;
+		const float* laneRayY = rayY.data() + lane*rayStride;
+		float* ratios = rayRatios.data() + lane*rayStride;
+		std::fill(rayOriginX.begin(), rayOriginX.end(), originX);
+		std::fill(rayOriginY.begin(), rayOriginY.end(), originY);
+		std::fill(ratios, ratios + rayStride, 1.f);
+		castRaysOnLines(nearLines, fanLines.data(), fanLineCount, rayStride,
+				rayOriginX.data(), rayOriginY.data(), laneRayX, laneRayY, ratios);
+		for (unsigned i = 0; i < rayCount; ++i) {
+			if (ratios[i] > nearRatio) {
+				trackRays[car.track].push_back(lane*rayStride + i);
+			}
+		}
+	}
+
+	//the far rays of every car on a track are cast in one batch
+	for (std::size_t trackIndex = 0; trackIndex < tracks.size(); ++trackIndex) {
+		const std::vector<std::size_t>& rays = trackRays[trackIndex];
+		for (auto* buffer : {&castOriginX, &castOriginY, &castRayX, &castRayY, &castRatios}) {
+			buffer->resize(rays.size());
+		}
+		for (std::size_t i = 0; i < rays.size(); ++i) {
+			castOriginX[i] = positionX[rays[i] / rayStride];
+			castOriginY[i] = positionY[rays[i] / rayStride];
+			castRayX[i] = rayX[rays[i]];
+			castRayY[i] = rayY[rays[i]];
+		}
+		tracks[trackIndex]->castRays(rays.size(), castOriginX.data(), castOriginY.data(),
+				castRayX.data(), castRayY.data(), nearRatio, castRatios.data());
+		for (std::size_t i = 0; i < rays.size(); ++i) {
+			rayRatios[rays[i]] = castRatios[i];
+		}
+	}
+
+	const std::size_t inputCount = prototypeNetwork.getInputNeuronCount();
+	for (std::size_t lane = 0; lane < laneCount; ++lane) {
+		CarData& car = cars[laneCars[lane]];
+		const track::Track& track = *tracks[car.track];
+		const sf::Vector2f position{positionX[lane], positionY[lane]};
+
+		//the same as Track::collideWithRays() and getDistance(position, rayPoint)
+		//in GameManager::callNeuralNetwork()
+		const float* laneRayX = rayX.data() + lane*rayStride;
+		const float* laneRayY = rayY.data() + lane*rayStride;
+		const float* ratios = rayRatios.data() + lane*rayStride;
+		for (unsigned i = 0; i < rayStride; ++i) {
+			const float x = (position.x + laneRayX[i] * ratios[i]) - position.x;
+			const float y = (position.y + laneRayY[i] * ratios[i]) - position.y;
+			const float distance = std::sqrt(x*x + y*y)/wallDistanceDamping;
+			rayInputs[i] = distance / (1 + std::abs(distance));
+		}
+		for (unsigned i = 0; i < rayCount; ++i) {
+			laneInputs[getLanePosition(lane, inputCount, i)] = rayInputs[i];
+		}
+
+		//the same as GameManager::callNeuralNetwork()
+		const sf::Vector2f velocity{velocityX[lane], velocityY[lane]};
+		laneInputs[getLanePosition(lane, inputCount, rayCount)] =
+				sigmoidApproximation(getLength(velocity)/speedDamping);
+
+		//the same as Model::getCheckpointDirection(), but the rotation back by the
+		//angle of the car is the transpose of its rotation, which is already known
+		sf::Vector2f checkpointDirection;
+		if (car.currentCheckpoint >= 0) {
+			const sf::Vector2f direction = nearestPoint(position,
+					track.getCheckpoint(car.currentCheckpoint)) - position;
+			const sf::Vector2f forward = car.rotation.transformPoint({1.f, 0.f});
+			const sf::Vector2f left = car.rotation.transformPoint({0.f, 1.f});
+			//+ 0.f is the translation added by sf::Transform::transformPoint()
+			checkpointDirection = normalize(sf::Vector2f{
+					forward.x*direction.x + forward.y*direction.y + 0.f,
+					left.x*direction.x + left.y*direction.y + 0.f});
+		}
+		laneInputs[getLanePosition(lane, inputCount, rayCount+1)] =
+				sigmoidApproximation(checkpointDirection.x/checkpointDirectionDamping);
+		laneInputs[getLanePosition(lane, inputCount, rayCount+2)] =
+				sigmoidApproximation(checkpointDirection.y/checkpointDirectionDamping);
+	}
+}
+
+void BatchSimulator::stopStalledLanes(float currentTime, float timeLimit) {
+	//the same as AIGameManager::run()
+	for (std::size_t lane = laneCount; lane-- > 0;) {
+		CarData& car = cars[laneCars[lane]];
+		const StallPolicy policy = car.stallDetector.update(stallLimits, currentTime,
+				getLength(sf::Vector2f{velocityX[lane], velocityY[lane]}), car.crossedCheckpoints,
+				*tracks[car.track], car.currentCheckpoint, {positionX[lane], positionY[lane]});
+		if (policy != StallPolicy::none) {
+			//the steps run() would have made until the time limit
+			stallCounters.add(policy, static_cast<std::uint64_t>((timeLimit - currentTime) / physicsTimeStep) + 1);
+			removeLane(lane);
+		}
+	}
+}
+
+void BatchSimulator::removeLane(std::size_t lane) {
+	cars[laneCars[lane]].travelDistance = travelDistance[lane];
+
+	const std::size_t last = --laneCount;
+	if (lane == last) {
+		return;
+	}
+	laneCars[lane] = laneCars[last];
+	moveLane(laneWeights, prototypeNetwork.getWeightCount(), last, lane);
+	moveLane(laneStates, prototypeNetwork.getRecurrentStateSize(), last, lane);
+	positionX[lane] = positionX[last];
+	positionY[lane] = positionY[last];
+	velocityX[lane] = velocityX[last];
+	velocityY[lane] = velocityY[last];
+	orientationX[lane] = orientationX[last];
+	orientationY[lane] = orientationY[last];
+	accelerationX[lane] = accelerationX[last];
+	accelerationY[lane] = accelerationY[last];
+	travelDistance[lane] = travelDistance[last];
+	throttleLevel[lane] = throttleLevel[last];
+	brakeLevel[lane] = brakeLevel[last];
+	turnLevel[lane] = turnLevel[last];
+	collided[lane] = collided[last];
+}
+
+}
@@ -0,0 +1,187 @@
+#ifndef BATCHSIMULATOR_HPP_
+#define BATCHSIMULATOR_HPP_
+
+#include <vector>
+
+#include "Car.hpp"
+#include "MathExpression.hpp"
+#include "NeuralNetwork.hpp"
+#include "Parameters.hpp"
+#include "StallDetector.hpp"
+#include "Track/Track.hpp"
+
+namespace car {
+
+//Simulates many AI controlled cars in lockstep: every car makes a step
+//before any of them makes the next one. The cars can be on different tracks. The state of the cars
+//is stored as separate arrays for each variable (structure of arrays), so
+//the linear physics of all cars is one vectorized loop (Car::moveLinear()
+//over the lanes), and every other part of a step is a pass over the cars.
+//
+//The networks are evaluated NeuralNetwork::laneWidth lanes at a time with
+//NeuralNetwork::evaluateLanes(), so the weights, the inputs and the
+//recurrent states are stored interleaved by the lanes.
+//
+//Every car keeps the lines of the track near it, and updates them only
+//after it moved far enough. The rays and the sides of the car are checked
+//against these lines in vectorized loops, and only the rays which don't
+//cross any of them near the car are cast on the line grid of the track.
+//The nearest line is found by getCrossingRatio(), whose minimum doesn't
+//depend on the order of the lines, so it's the same line Track would find.
+//
+//The cars which crashed or ran out of time are removed from the arrays, so
+//the passes only go through the running cars.
+//
+//The results are the same as running an AIGameManager for each car.
+class BatchSimulator {
+public:
+	//the same as AIGameManager::maxTime
+	static constexpr float maxTime = 600.f;
+
+	//Throws FormulaException if the fitness expression uses unknown symbols.
+	BatchSimulator(const Parameters& parameters, std::vector<track::TrackPtr> tracks);
+	BatchSimulator(const Parameters& parameters, track::TrackPtr track);
+
+	BatchSimulator(const BatchSimulator&) = delete;
+	BatchSimulator& operator=(const BatchSimulator&) = delete;
+	BatchSimulator(BatchSimulator&&) = default;
+	BatchSimulator& operator=(BatchSimulator&&) = default;
+
+	//Removes the cars, but keeps the memory allocated for them.
+	void clear();
+
+	//Adds a car controlled by a network with these weights on the track with
+	//this index, and returns the index of the car. The weights have to stay
+	//alive while the car is used.
+	std::size_t addCar(const Weight* weights, std::size_t trackIndex = 0);
+
+	std::size_t getCarCount() const { return carCount; }
+
+	//Simulates every car from the start of the track, until it crashes or
+	//timeLimit seconds passed.
+	void run(float timeLimit = maxTime);
+
+	//should be called after run()
+	float getFitness(std::size_t car) const;
+	float getTravelDistance(std::size_t car) const;
+	unsigned getNumberOfCrossedCheckpoints(std::size_t car) const;
+
+	//the number of car steps simulated by the last run(). Every car step is
+	//a physics step and a network evaluation.
+	std::size_t getStepCount() const { return stepCount; }
+	//the number of NeuralNetwork::evaluateLanes() calls made by the last run()
+	std::size_t getNetworkCallCount() const { return networkCallCount; }
+	//the cars stopped by the stall policies in the last run()
+	const StallCounters& getStallCounters() const { return stallCounters; }
+
+private:
+	//Results and the parts of the state which are not used in the
+	//vectorized loops. They are indexed by the car, so they don't have to be
+	//moved when the lanes are compacted.
+	struct CarData {
+		const Weight* weights;
+		std::size_t track; //index to tracks
+		sf::Transform rotation; //Car::getRotation() of the current orientation
+		Car::Corners corners;
+		float travelDistance;
+		unsigned crossedCheckpoints;
+		int currentCheckpoint;
+		StallDetector stallDetector;
+
+		//the lines of the track near nearLinesCenter
+		LineArrays nearLines;
+		sf::Vector2f nearLinesCenter;
+		bool hasNearLines;
+		//the indices of the near lines which can touch the car near
+		//collisionLinesCenter
+		std::vector<unsigned> collisionLines;
+		sf::Vector2f collisionLinesCenter;
+		bool hasCollisionLines;
+	};
+
+	void startLanes();
+	void controlLanes();
+	void moveLanes();
+	void collideLanes();
+	void senseLanes();
+	//removes the cars stopped by the stall policies
+	void stopStalledLanes(float currentTime, float timeLimit);
+	void removeLane(std::size_t lane);
+	void updateNearLines(std::size_t lane);
+	void updateCollisionLines(std::size_t lane);
+
+	float physicsTimeStep;
+	unsigned rayCount;
+	//The rays of a lane are rayStride apart in the ray buffers, so the loops
+	//over them are whole vectors.
+	unsigned rayStride;
+	//the largest distance of a corner of a car from its position
+	float carRadius;
+	StallLimits stallLimits;
+	StallCounters stallCounters;
+
+	std::vector<track::TrackPtr> tracks;
+	std::vector<Car> startingCars; //for each track
+	CompiledMathExpression fitnessExpression;
+	NeuralNetwork prototypeNetwork;
+
+	//The lanes of the networks, in groups of NeuralNetwork::laneWidth lanes.
+	//Element i of lane l is at [(l/laneWidth*size + i)*laneWidth + l%laneWidth]
+	//where size is the number of the elements of a lane.
+	std::vector<Weight> laneWeights;
+	std::vector<Weight> laneStates;
+	std::vector<Weight> laneInputs;
+
+	//the directions of the rays relative to the car
+	std::vector<sf::Vector2f> rayDirections;
+
+	//buffers of senseLanes(), the rays of every lane after each other
+	std::vector<float> rayDirectionX;
+	std::vector<float> rayDirectionY;
+	std::vector<float> rayX;
+	std::vector<float> rayY;
+	std::vector<float> rayRatios;
+	//the origins and the inputs of the rays of a lane
+	std::vector<float> rayOriginX;
+	std::vector<float> rayOriginY;
+	std::vector<float> rayInputs;
+	//the indices of the near lines of a car which can cross its rays near the
+	//car in senseLanes(), only the first ones up to the selected count are used
+	std::vector<unsigned> fanLines;
+	std::vector<unsigned> lineSelected;
+	//the rays which have to be cast on each track
+	std::vector<std::vector<std::size_t>> trackRays;
+	std::vector<float> castOriginX;
+	std::vector<float> castOriginY;
+	std::vector<float> castRayX;
+	std::vector<float> castRayY;
+	std::vector<float> castRatios;
+
+	//Only the first carCount elements are used, the rest are kept to reuse
+	//their memory.
+	std::vector<CarData> cars;
+	std::size_t carCount = 0;
+	std::size_t stepCount = 0;
+	std::size_t networkCallCount = 0;
+
+	//The running cars. Lane i simulates the car laneCars[i].
+	std::size_t laneCount = 0;
+	std::vector<std::size_t> laneCars;
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> velocityX;
+	std::vector<float> velocityY;
+	std::vector<float> orientationX;
+	std::vector<float> orientationY;
+	std::vector<float> accelerationX;
+	std::vector<float> accelerationY;
+	std::vector<float> travelDistance;
+	std::vector<float> throttleLevel;
+	std::vector<float> brakeLevel;
+	std::vector<float> turnLevel;
+	std::vector<char> collided;
+};
+
+}
+
+#endif /* BATCHSIMULATOR_HPP_ */
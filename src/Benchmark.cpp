@@ -0,0 +1,216 @@
+#include "Benchmark.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <iomanip>
+#include <limits>
+
+#include "Checkpoint.hpp"
+#include "Instrumentation.hpp"
+#include "PopulationRunner.hpp"
+#include "StallDetector.hpp"
+#include "TaskScheduler.hpp"
+
+namespace car {
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double getSeconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct BenchmarkResult {
+	unsigned threadCount = 0;
+	double wallSeconds = 0.0;
+	double simulationSeconds = 0.0;
+	double evolutionSeconds = 0.0;
+	double checkpointSeconds = 0.0;
+	std::uint64_t simulatedGenomes = 0;
+	std::uint64_t carSteps = 0;
+	std::uint64_t networkCalls = 0;
+	std::uint64_t rejectedGenomes = 0;
+	std::int64_t savedCarSteps = 0;
+	std::uint64_t prunedGenomes = 0;
+	std::uint64_t prunedSimulations = 0;
+	std::uint64_t prunedCarSteps = 0;
+	StallCounters stalls;
+	float bestFitness = 0.f;
+};
+
+BenchmarkResult runWithThreads(const Parameters& parameters,
+		const std::vector<track::TrackPtr>& tracks, unsigned threadCount) {
+	BenchmarkResult result;
+	result.threadCount = threadCount;
+
+	const auto start = Clock::now();
+	//the main thread also runs tasks while it waits for them
+	TaskScheduler scheduler{threadCount - 1};
+	PopulationRunner runner{parameters, tracks, scheduler, parameters.seed};
+
+	CheckpointInfo checkpointInfo;
+	checkpointInfo.topology = getNetworkTopology(parameters);
+
+	for (unsigned generation = 1; generation <= *parameters.generationLimit; ++generation) {
+		runner.runIteration();
+
+		const PopulationRunner::Statistics& statistics = runner.getStatistics();
+		result.simulationSeconds += statistics.simulationSeconds;
+		result.evolutionSeconds += statistics.evolutionSeconds;
+		result.simulatedGenomes += statistics.simulatedGenomes;
+		result.carSteps += statistics.carSteps;
+		result.networkCalls += statistics.networkCalls;
+		result.rejectedGenomes += statistics.rejectedGenomes;
+		result.savedCarSteps += statistics.savedCarSteps;
+		result.prunedGenomes += statistics.prunedGenomes;
+		result.prunedSimulations += statistics.prunedSimulations;
+		result.prunedCarSteps += statistics.prunedCarSteps;
+		result.stalls += statistics.stalls;
+
+		const auto checkpointStart = Clock::now();
+		const std::vector<char> checkpoint = serializeCheckpoint(checkpointInfo, runner.getPopulation());
+		result.checkpointSeconds += getSeconds(checkpointStart);
+	}
+	result.wallSeconds = getSeconds(start);
+	result.bestFitness = runner.getBestFitness();
+	return result;
+}
+
+std::string quote(const std::string& s) {
+	std::string result = "\"";
+	for (char ch : s) {
+		if (ch == '"' || ch == '\\') {
+			result += '\\';
+		}
+		result += ch;
+	}
+	return result + '"';
+}
+
+const char* getSimdName() {
+#if defined(__AVX__)
+	return "avx";
+#elif defined(__SSE__)
+	return "sse";
+#else
+	return "none";
+#endif
+}
+
+double getRate(std::uint64_t count, double seconds) {
+	return seconds > 0.0 ? count / seconds : 0.0;
+}
+
+void writeReport(std::ostream& out, const Parameters& parameters,
+		const std::vector<BenchmarkResult>& results) {
+	out << std::setprecision(std::numeric_limits<double>::digits10);
+	out << "{\n";
+	out << "\t\"version\": 1,\n";
+	out << "\t\"build\": {\n";
+#if defined(__clang__)
+	out << "\t\t\"compiler\": " << quote("clang " __VERSION__) << ",\n";
+#elif defined(__GNUC__)
+	out << "\t\t\"compiler\": " << quote("gcc " __VERSION__) << ",\n";
+#else
+	out << "\t\t\"compiler\": " << quote("unknown") << ",\n";
+#endif
+#ifdef __OPTIMIZE__
+	out << "\t\t\"optimized\": true,\n";
+#else
+	out << "\t\t\"optimized\": false,\n";
+#endif
+#ifdef NDEBUG
+	out << "\t\t\"assertions\": false,\n";
+#else
+	out << "\t\t\"assertions\": true,\n";
+#endif
+	out << "\t\t\"simd\": " << quote(getSimdName()) << ",\n";
+	out << "\t\t\"instrumentation\": " << (instrumentation::isEnabled() ? "true" : "false") << "\n";
+	out << "\t},\n";
+
+	out << "\t\"workload\": {\n";
+	out << "\t\t\"seed\": " << parameters.seed << ",\n";
+	out << "\t\t\"generations\": " << *parameters.generationLimit << ",\n";
+	out << "\t\t\"populationSize\": " << parameters.populationSize << ",\n";
+	out << "\t\t\"hiddenLayerCount\": " << parameters.hiddenLayerCount << ",\n";
+	out << "\t\t\"neuronPerHiddenLayer\": " << parameters.neuronPerHiddenLayer << ",\n";
+	out << "\t\t\"rayCount\": " << parameters.rayCount << ",\n";
+	out << "\t\t\"useRecurrence\": " << (parameters.useRecurrence ? "true" : "false") << ",\n";
+	out << "\t\t\"physicsFrequency\": " << parameters.physicsTimeStepsPerSecond << ",\n";
+	out << "\t\t\"prescreenSeconds\": " << parameters.prescreenSeconds << ",\n";
+	out << "\t\t\"racing\": " << (parameters.racing ? "true" : "false") << ",\n";
+	out << "\t\t\"stallSeconds\": {\"noCheckpoint\": " << parameters.stallCheckpointSeconds <<
+			", \"slow\": " << parameters.stallSpeedSeconds <<
+			", \"noApproach\": " << parameters.stallApproachSeconds << "},\n";
+	out << "\t\t\"stallSpeed\": " << parameters.stallSpeed << ",\n";
+	out << "\t\t\"batchBy\": " << quote(parameters.simulationBatching == SimulationBatching::byTrack ?
+			"track" : "genome") << ",\n";
+	out << "\t\t\"tracks\": [";
+	for (std::size_t i = 0; i < parameters.tracks.size(); ++i) {
+		out << (i > 0 ? ", " : "") << quote(parameters.tracks[i]);
+	}
+	out << "]\n";
+	out << "\t},\n";
+
+	out << "\t\"runs\": [";
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		const BenchmarkResult& result = results[i];
+		out << (i > 0 ? "," : "") << "\n\t\t{\n";
+		out << "\t\t\t\"threads\": " << result.threadCount << ",\n";
+		out << "\t\t\t\"wallSeconds\": " << result.wallSeconds << ",\n";
+		out << "\t\t\t\"phaseSeconds\": {\"simulate\": " << result.simulationSeconds <<
+				", \"evolve\": " << result.evolutionSeconds <<
+				", \"checkpoint\": " << result.checkpointSeconds << "},\n";
+		out << "\t\t\t\"simulatedGenomes\": " << result.simulatedGenomes << ",\n";
+		out << "\t\t\t\"physicsSteps\": " << result.carSteps << ",\n";
+		out << "\t\t\t\"networkCalls\": " << result.networkCalls << ",\n";
+		out << "\t\t\t\"prescreenRejectedGenomes\": " << result.rejectedGenomes << ",\n";
+		out << "\t\t\t\"savedPhysicsSteps\": " << result.savedCarSteps << ",\n";
+		out << "\t\t\t\"racingPrunedGenomes\": " << result.prunedGenomes << ",\n";
+		out << "\t\t\t\"racingSkippedSimulations\": " << result.prunedSimulations << ",\n";
+		out << "\t\t\t\"racingSavedPhysicsSteps\": " << result.prunedCarSteps << ",\n";
+		out << "\t\t\t\"stalledCars\": {";
+		for (std::size_t policy = 0; policy < stallPolicyCount; ++policy) {
+			out << (policy > 0 ? ", " : "") << quote(getStallPolicyName(static_cast<StallPolicy>(policy))) <<
+					": " << result.stalls.stoppedCars[policy];
+		}
+		out << "},\n";
+		out << "\t\t\t\"stallSavedPhysicsSteps\": {";
+		for (std::size_t policy = 0; policy < stallPolicyCount; ++policy) {
+			out << (policy > 0 ? ", " : "") << quote(getStallPolicyName(static_cast<StallPolicy>(policy))) <<
+					": " << result.stalls.savedSteps[policy];
+		}
+		out << "},\n";
+		out << "\t\t\t\"physicsStepsPerSecond\": " <<
+				getRate(result.carSteps, result.simulationSeconds) << ",\n";
+		out << "\t\t\t\"genomesPerSecond\": " <<
+				getRate(result.simulatedGenomes, result.wallSeconds) << ",\n";
+		out << "\t\t\t\"bestFitness\": " << result.bestFitness << "\n";
+		out << "\t\t}";
+	}
+	out << "\n\t]\n";
+	out << "}" << std::endl;
+}
+
+}
+
+void runBenchmark(const Parameters& parameters,
+		const std::vector<std::function<track::Track()>>& trackCreators,
+		std::ostream& out) {
+	assert(parameters.generationLimit);
+
+	//the tracks are the same for every run, so they are not measured
+	std::vector<track::TrackPtr> tracks;
+	for (const auto& trackCreator : trackCreators) {
+		tracks.push_back(track::createTrack(trackCreator));
+	}
+
+	std::vector<BenchmarkResult> results;
+	for (unsigned threadCount : parameters.benchmarkThreadCounts) {
+		results.push_back(runWithThreads(parameters, tracks, threadCount));
+	}
+	writeReport(out, parameters, results);
+}
+
+}
@@ -0,0 +1,30 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <functional>
+#include <ostream>
+#include <vector>
+
+#include "Parameters.hpp"
+#include "Track/Track.hpp"
+
+namespace car {
+
+//Runs generational training of a single population for
+//parameters.generationLimit generations with each of
+//parameters.benchmarkThreadCounts, and writes a JSON report to out: the
+//workload, the build, and for every thread count the wall time, the time of
+//each phase (simulate, evolve, checkpoint) and the throughput.
+//Every physics step evaluates the network of its car once, so the network
+//evaluations are the physics steps; networkCalls is the number of batched
+//network calls they took.
+//
+//The checkpoint phase is the snapshot made by the training thread, the file
+//is written in the background during training.
+void runBenchmark(const Parameters& parameters,
+		const std::vector<std::function<track::Track()>>& trackCreators,
+		std::ostream& out);
+
+}
+
+#endif /* !BENCHMARK_HPP */
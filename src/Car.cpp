@@ -53,52 +53,41 @@ void Car::setColor(const sf::Color& newColor) {
 }
 
 void Car::move(float deltaSeconds) {
+	moveLinear(deltaSeconds, throttleLevel, brakeLevel, orientation.x, orientation.y,
+			position.x, position.y, velocity.x, velocity.y,
+			acceleration.x, acceleration.y, travelDistance);
 
-	using namespace boost::math::float_constants;
-
-	sf::Vector2f velocityDirection = orientation;
-
-	velocity = orientation*getLength(velocity); //hack, TODO something
-
-	float speed = getSpeed();
-	float weight = mass * gravity;
-
-	float power = pEngine * throttleLevel;
-
-	float engineForce = std::max(0.f, std::min(power / speed, fEngineMax));
-	float brakeForce = fBrake * brakeLevel;
+	orientation = turn(deltaSeconds, turnLevel, orientation);
 
-	sf::Vector2f fTraction = velocityDirection * engineForce;
-	sf::Vector2f fBraking = -velocityDirection * brakeForce;
-	sf::Vector2f fDrag = -cDrag * velocity * speed;
-	sf::Vector2f fRollingResistance = -cRollingResistance * velocity;
-
-	sf::Vector2f fLongtitudinal = fTraction + fBraking + fDrag + fRollingResistance;
-
-	acceleration = fLongtitudinal / mass;
-
-	float weightFront = (rearWheelCMDistance / wheelBase)*weight - (heightOfCG / wheelBase)*mass*(getLength(acceleration));
-	float weightRear = (frontWheelCMDistance / wheelBase)*weight - (heightOfCG / wheelBase)*mass*(getLength(acceleration));
-	(void)weightFront;
-	(void)weightRear;
+	updateCorners();
+}
 
-	velocity += deltaSeconds * acceleration;
-	position += deltaSeconds * velocity;
+float Car::getMaxSpeedAfterStep(float deltaSeconds, float speed) {
+	//full throttle without braking, as in moveLinear()
+	const float engineForce = speed > 0.f ? std::min(pEngine / speed, fEngineMax) : fEngineMax;
+	const float resistance = cDrag*speed*speed + cRollingResistance*speed;
+	const float forward = speed + deltaSeconds * (engineForce - resistance) / mass;
+	//braking a slow car turns its velocity backwards, which moveLinear()
+	//turns to the orientation in the next step
+	const float backward = deltaSeconds * (fBrake + resistance) / mass;
+	return std::max(forward, backward);
+}
 
-	//We don't want anything accurate here
-	travelDistance += deltaSeconds * speed;
+sf::Vector2f Car::turn(float deltaSeconds, float turnLevel, const sf::Vector2f& orientation) {
 
-	if (std::abs(turnLevel) > 0.0001) {
-		float steeringAngle = maxTurnAngle * turnLevel;
-		float turnRadius = wheelBase / std::sin(steeringAngle);
+	using namespace boost::math::float_constants;
 
-		float angularVelocity = turnRate / turnRadius;
-		sf::Transform rotateTransform;
-		rotateTransform.rotate(angularVelocity*deltaSeconds * 180.f/pi);
-		orientation = rotateTransform.transformPoint(orientation);
+	if (std::abs(turnLevel) <= 0.0001) {
+		return orientation;
 	}
 
-	updateCorners();
+	float steeringAngle = maxTurnAngle * turnLevel;
+	float turnRadius = wheelBase / std::sin(steeringAngle);
+
+	float angularVelocity = turnRate / turnRadius;
+	sf::Transform rotateTransform;
+	rotateTransform.rotate(angularVelocity*deltaSeconds * 180.f/pi);
+	return rotateTransform.transformPoint(orientation);
 }
 
 void Car::setThrottle(float value) {
@@ -118,10 +107,7 @@ void Car::increaseThrottle(float deltaSeconds) {
 }
 
 void Car::decreaseThrottle(float deltaSeconds) {
-	throttleLevel -= throttleDecreaseSpeed*deltaSeconds;
-	if (throttleLevel < 0.) {
-		throttleLevel = 0.;
-	}
+	throttleLevel = getDecreasedThrottle(throttleLevel, deltaSeconds);
 }
 
 void Car::setBrake(float value) {
@@ -141,10 +127,7 @@ void Car::increaseBrake(float deltaSeconds) {
 }
 
 void Car::decreaseBrake(float deltaSeconds) {
-	brakeLevel -= brakeDecreaseSpeed*deltaSeconds;
-	if (brakeLevel < 0.) {
-		brakeLevel = 0.;
-	}
+	brakeLevel = getDecreasedBrake(brakeLevel, deltaSeconds);
 }
 
 void Car::setTurnLevel(float value) {
@@ -167,40 +150,34 @@ void Car::increaseTurnToLeft(float deltaSeconds) {
 }
 
 void Car::dontTurn(float deltaSeconds) {
-	if (turnLevel > 0.) {
-		turnLevel -= turnSpeed*deltaSeconds;
-		if (turnLevel < 0.) {
-			turnLevel = 0.;
-		}
-	} else if (turnLevel < 0.) {
-		turnLevel += turnSpeed*deltaSeconds;
-		if (turnLevel > 0.) {
-			turnLevel = 0.;
-		}
-	}
+	turnLevel = getStraightenedTurnLevel(turnLevel, deltaSeconds);
 }
 
 const sf::Vector2f& Car::getFrontLeftCorner() const {
-	return frontLeftCorner;
+	return corners[0];
 }
 
 const sf::Vector2f& Car::getFrontRightCorner() const {
-	return frontRightCorner;
+	return corners[1];
 }
 
 const sf::Vector2f& Car::getRearLeftCorner() const {
-	return rearLeftCorner;
+	return corners[2];
 }
 
 const sf::Vector2f& Car::getRearRightCorner() const {
-	return rearRightCorner;
+	return corners[3];
+}
+
+const Car::Corners& Car::getCorners() const {
+	return corners;
 }
 
 void Car::draw(sf::RenderWindow& window) const {
-	drawLine(window, frontLeftCorner, frontRightCorner, color);
-	drawLine(window, frontLeftCorner, rearLeftCorner, color);
-	drawLine(window, frontRightCorner, rearRightCorner, color);
-	drawLine(window, rearLeftCorner, rearRightCorner, color);
+	drawLine(window, getFrontLeftCorner(), getFrontRightCorner(), color);
+	drawLine(window, getFrontLeftCorner(), getRearLeftCorner(), color);
+	drawLine(window, getFrontRightCorner(), getRearRightCorner(), color);
+	drawLine(window, getRearLeftCorner(), getRearRightCorner(), color);
 }
 
 const sf::Vector2f& Car::getPosition() const {
@@ -232,20 +209,30 @@ float Car::getTravelDistance() const {
 }
 
 void Car::updateCorners() {
+	calculateCorners(position, getRotation(orientation), corners);
+}
+
+sf::Transform Car::getRotation(const sf::Vector2f& orientation) {
 
 	using namespace boost::math::float_constants;
 
 	sf::Transform transform;
-	transform.translate(getPosition());
-	transform.rotate(std::atan2(getOrientation().y, getOrientation().x) * 180.f/pi);
+	transform.rotate(std::atan2(orientation.y, orientation.x) * 180.f/pi);
+	return transform;
+}
+
+void Car::calculateCorners(const sf::Vector2f& position, const sf::Transform& rotation,
+		Corners& corners) {
 
 	const float carHalfWidth = carWidth/2.f;
 
-	//CM is the origin when drawing
-	frontLeftCorner = transform.transformPoint(sf::Vector2f(frontCMDistance, -carHalfWidth));
-	frontRightCorner = transform.transformPoint(sf::Vector2f(frontCMDistance, carHalfWidth));
-	rearLeftCorner = transform.transformPoint(sf::Vector2f(-rearCMDistance, -carHalfWidth));
-	rearRightCorner = transform.transformPoint(sf::Vector2f(-rearCMDistance, carHalfWidth));
+	//CM is the origin when drawing. Translating after the rotation gives the
+	//same result as a combined transform, the translation part of that is
+	//only added to the rotated point.
+	corners[0] = rotation.transformPoint(sf::Vector2f(frontCMDistance, -carHalfWidth)) + position;
+	corners[1] = rotation.transformPoint(sf::Vector2f(frontCMDistance, carHalfWidth)) + position;
+	corners[2] = rotation.transformPoint(sf::Vector2f(-rearCMDistance, -carHalfWidth)) + position;
+	corners[3] = rotation.transformPoint(sf::Vector2f(-rearCMDistance, carHalfWidth)) + position;
 }
 
 }
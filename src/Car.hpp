@@ -1,6 +1,10 @@
 #ifndef CAR_HPP
 #define CAR_HPP
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+
 #include <SFML/Graphics.hpp>
 
 namespace car {
@@ -44,10 +48,48 @@ public:
 	const sf::Vector2f& getRearLeftCorner() const;
 	const sf::Vector2f& getRearRightCorner() const;
 
+	//front left, front right, rear left, rear right
+	typedef std::array<sf::Vector2f, 4> Corners;
+	const Corners& getCorners() const;
+
 	float getTravelDistance() const;
 
 	void draw(sf::RenderWindow& window) const;
 
+	//The calculations of move() and of the control decrease functions on
+	//plain values, so BatchSimulator can run them on its own storage with the
+	//same results. moveLinear() only calls sqrt, so a loop of it can be
+	//vectorized.
+	static void moveLinear(float deltaSeconds, float throttleLevel, float brakeLevel,
+			float orientationX, float orientationY,
+			float& positionX, float& positionY, float& velocityX, float& velocityY,
+			float& accelerationX, float& accelerationY, float& travelDistance);
+	//moveLinear() for count cars, whose variables are in separate arrays
+	//which don't overlap. The loop is straight-line arithmetic, which the
+	//compiler vectorizes (sqrt needs -fno-math-errno, see Tuprules.tup).
+	static void moveLinear(std::size_t count, float deltaSeconds,
+			const float* __restrict throttleLevel, const float* __restrict brakeLevel,
+			const float* __restrict orientationX, const float* __restrict orientationY,
+			float* __restrict positionX, float* __restrict positionY,
+			float* __restrict velocityX, float* __restrict velocityY,
+			float* __restrict accelerationX, float* __restrict accelerationY,
+			float* __restrict travelDistance);
+	static sf::Vector2f turn(float deltaSeconds, float turnLevel, const sf::Vector2f& orientation);
+
+	//Rotates from the coordinate system of the car, where (1, 0) is the front.
+	static sf::Transform getRotation(const sf::Vector2f& orientation);
+	static void calculateCorners(const sf::Vector2f& position, const sf::Transform& rotation,
+			Corners& corners);
+
+	static float getDecreasedThrottle(float throttleLevel, float deltaSeconds);
+	static float getDecreasedBrake(float brakeLevel, float deltaSeconds);
+	static float getStraightenedTurnLevel(float turnLevel, float deltaSeconds);
+
+	//An upper bound of the speed after a moveLinear() step from speed, with
+	//any throttle and brake level. Increasing in speed, so repeating it from
+	//0 bounds the speed of every car.
+	static float getMaxSpeedAfterStep(float deltaSeconds, float speed);
+
 private:
 
 	void updateCorners();
@@ -93,16 +135,108 @@ private:
 	sf::Vector2f orientation = sf::Vector2f(1., 0.); //unit vector
 	sf::Vector2f acceleration; //recalculated with move();
 
-	sf::Vector2f frontLeftCorner; //recalculated with move()
-	sf::Vector2f frontRightCorner; //recalculated with move()
-	sf::Vector2f rearLeftCorner; //recalculated with move()
-	sf::Vector2f rearRightCorner; //recalculated with move()
+	Corners corners; //recalculated with move()
 
 	float travelDistance = 0.f; //recalculated with move()
 
 	sf::Color color = sf::Color::White;
 };
 
+inline
+void Car::moveLinear(float deltaSeconds, float throttleLevel, float brakeLevel,
+		float orientationX, float orientationY,
+		float& positionX, float& positionY, float& velocityX, float& velocityY,
+		float& accelerationX, float& accelerationY, float& travelDistance) {
+
+	const float oldSpeed = std::sqrt(velocityX*velocityX + velocityY*velocityY);
+	velocityX = orientationX*oldSpeed; //hack, TODO something
+	velocityY = orientationY*oldSpeed;
+
+	const float speed = std::sqrt(velocityX*velocityX + velocityY*velocityY);
+
+	const float power = pEngine * throttleLevel;
+
+	const float engineForce = std::max(0.f, std::min(power / speed, fEngineMax));
+	const float brakeForce = fBrake * brakeLevel;
+
+	const float longtitudinalX = orientationX*engineForce + -orientationX*brakeForce +
+			-cDrag*velocityX*speed + -cRollingResistance*velocityX;
+	const float longtitudinalY = orientationY*engineForce + -orientationY*brakeForce +
+			-cDrag*velocityY*speed + -cRollingResistance*velocityY;
+
+	accelerationX = longtitudinalX / mass;
+	accelerationY = longtitudinalY / mass;
+
+	velocityX += deltaSeconds * accelerationX;
+	velocityY += deltaSeconds * accelerationY;
+	positionX += deltaSeconds * velocityX;
+	positionY += deltaSeconds * velocityY;
+
+	//We don't want anything accurate here
+	travelDistance += deltaSeconds * speed;
+}
+
+inline
+void Car::moveLinear(std::size_t count, float deltaSeconds,
+		const float* __restrict throttleLevel, const float* __restrict brakeLevel,
+		const float* __restrict orientationX, const float* __restrict orientationY,
+		float* __restrict positionX, float* __restrict positionY,
+		float* __restrict velocityX, float* __restrict velocityY,
+		float* __restrict accelerationX, float* __restrict accelerationY,
+		float* __restrict travelDistance) {
+	for (std::size_t i = 0; i < count; ++i) {
+		//through locals, so nothing is written through the pointers until the
+		//end of the iteration
+		float x = positionX[i], y = positionY[i];
+		float vx = velocityX[i], vy = velocityY[i];
+		float ax = 0.f, ay = 0.f;
+		float distance = travelDistance[i];
+		moveLinear(deltaSeconds, throttleLevel[i], brakeLevel[i], orientationX[i], orientationY[i],
+				x, y, vx, vy, ax, ay, distance);
+		positionX[i] = x;
+		positionY[i] = y;
+		velocityX[i] = vx;
+		velocityY[i] = vy;
+		accelerationX[i] = ax;
+		accelerationY[i] = ay;
+		travelDistance[i] = distance;
+	}
+}
+
+inline
+float Car::getDecreasedThrottle(float throttleLevel, float deltaSeconds) {
+	throttleLevel -= throttleDecreaseSpeed*deltaSeconds;
+	if (throttleLevel < 0.) {
+		throttleLevel = 0.;
+	}
+	return throttleLevel;
+}
+
+inline
+float Car::getDecreasedBrake(float brakeLevel, float deltaSeconds) {
+	brakeLevel -= brakeDecreaseSpeed*deltaSeconds;
+	if (brakeLevel < 0.) {
+		brakeLevel = 0.;
+	}
+	return brakeLevel;
+}
+
+inline
+float Car::getStraightenedTurnLevel(float turnLevel, float deltaSeconds) {
+	if (turnLevel > 0.) {
+		turnLevel -= turnSpeed*deltaSeconds;
+		if (turnLevel < 0.) {
+			turnLevel = 0.;
+		}
+	} else if (turnLevel < 0.) {
+		turnLevel += turnSpeed*deltaSeconds;
+		if (turnLevel > 0.) {
+			turnLevel = 0.;
+		}
+	}
+	return turnLevel;
+}
+
 }
 
 #endif /* !CAR_HPP */
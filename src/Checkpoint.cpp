@@ -0,0 +1,413 @@
+#include "Checkpoint.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+
+#include "GeneticPopulation.hpp"
+
+namespace car {
+
+namespace {
+
+const char magic[8] = {'C', 'A', 'R', 'C', 'K', 'P', 'T', '\0'};
+const std::uint32_t currentVersion = 1;
+
+//byte offsets in the header
+enum HeaderField : std::size_t {
+	magicOffset = 0,
+	versionOffset = 8,
+	kindOffset = 12,
+	hiddenLayerCountOffset = 16,
+	hiddenLayerNeuronCountOffset = 20,
+	inputNeuronCountOffset = 24,
+	outputNeuronCountOffset = 28,
+	useRecurrenceOffset = 32,
+	genomeCountOffset = 36,
+	weightCountOffset = 40,
+	generationOffset = 44,
+	seedOffset = 48,
+	simulationFingerprintOffset = 56,
+	fitnessesOffset = 64,
+	unchangedOffset = 72,
+	weightsOffset = 80,
+	headerSize = 96 //the rest is reserved
+};
+
+const std::size_t weightAlignment = 64;
+
+bool isLittleEndian() {
+	const std::uint32_t one = 1;
+	return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+void checkLittleEndian() {
+	if (!isLittleEndian()) {
+		throw CheckpointError{"Binary checkpoints are only supported on little-endian hosts"};
+	}
+}
+
+template<typename T>
+void writeNumber(char* data, T value) {
+	for (std::size_t i = 0; i < sizeof(T); ++i) {
+		data[i] = static_cast<char>((value >> (8*i)) & 0xff);
+	}
+}
+
+template<typename T>
+T readNumber(const char* data) {
+	T value = 0;
+	for (std::size_t i = 0; i < sizeof(T); ++i) {
+		value |= static_cast<T>(static_cast<unsigned char>(data[i])) << (8*i);
+	}
+	return value;
+}
+
+std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+//getWeights(i), getFitness(i) and isUnchanged(i) give the data of genome i
+template<typename GetWeights, typename GetFitness, typename IsUnchanged>
+std::vector<char> serialize(const CheckpointInfo& info,
+		std::size_t genomeCount, unsigned weightCount,
+		GetWeights getWeights, GetFitness getFitness, IsUnchanged isUnchanged) {
+	checkLittleEndian();
+	if (info.topology.isKnown() && info.topology.getWeightCount() != weightCount) {
+		throw CheckpointError{"The weight count doesn't match the network topology"};
+	}
+
+	const std::uint64_t fitnesses = headerSize;
+	const std::uint64_t unchanged = fitnesses + genomeCount*sizeof(float);
+	const std::uint64_t weights = alignUp(unchanged + genomeCount, weightAlignment);
+	const std::size_t genomeBytes = weightCount*sizeof(Weight);
+
+	std::vector<char> data(weights + genomeCount*genomeBytes, 0);
+	std::copy(std::begin(magic), std::end(magic), data.begin() + magicOffset);
+	writeNumber<std::uint32_t>(&data[versionOffset], currentVersion);
+	writeNumber<std::uint32_t>(&data[kindOffset], static_cast<std::uint32_t>(info.kind));
+	writeNumber<std::uint32_t>(&data[hiddenLayerCountOffset], info.topology.hiddenLayerCount);
+	writeNumber<std::uint32_t>(&data[hiddenLayerNeuronCountOffset], info.topology.hiddenLayerNeuronCount);
+	writeNumber<std::uint32_t>(&data[inputNeuronCountOffset], info.topology.inputNeuronCount);
+	writeNumber<std::uint32_t>(&data[outputNeuronCountOffset], info.topology.outputNeuronCount);
+	writeNumber<std::uint32_t>(&data[useRecurrenceOffset], info.topology.useRecurrence);
+	writeNumber<std::uint32_t>(&data[genomeCountOffset], genomeCount);
+	writeNumber<std::uint32_t>(&data[weightCountOffset], weightCount);
+	writeNumber<std::uint32_t>(&data[generationOffset], info.generation);
+	writeNumber<std::uint64_t>(&data[seedOffset], info.seed);
+	writeNumber<std::uint64_t>(&data[simulationFingerprintOffset], info.simulationFingerprint);
+	writeNumber<std::uint64_t>(&data[fitnessesOffset], fitnesses);
+	writeNumber<std::uint64_t>(&data[unchangedOffset], unchanged);
+	writeNumber<std::uint64_t>(&data[weightsOffset], weights);
+
+	for (std::size_t i = 0; i < genomeCount; ++i) {
+		const float fitness = getFitness(i);
+		std::memcpy(&data[fitnesses + i*sizeof(float)], &fitness, sizeof(float));
+		data[unchanged + i] = isUnchanged(i) ? 1 : 0;
+		if (genomeBytes > 0) {
+			std::memcpy(&data[weights + i*genomeBytes], getWeights(i), genomeBytes);
+		}
+	}
+	return data;
+}
+
+}
+
+unsigned NetworkTopology::getWeightCount() const {
+	return NeuralNetwork::getWeightCountForNetwork(hiddenLayerCount, hiddenLayerNeuronCount,
+			inputNeuronCount, outputNeuronCount, useRecurrence);
+}
+
+NeuralNetwork NetworkTopology::createNetwork() const {
+	assert(isKnown());
+	return NeuralNetwork{hiddenLayerCount, hiddenLayerNeuronCount,
+			inputNeuronCount, outputNeuronCount, useRecurrence};
+}
+
+bool operator==(const NetworkTopology& left, const NetworkTopology& right) {
+	return left.hiddenLayerCount == right.hiddenLayerCount &&
+			left.hiddenLayerNeuronCount == right.hiddenLayerNeuronCount &&
+			left.inputNeuronCount == right.inputNeuronCount &&
+			left.outputNeuronCount == right.outputNeuronCount &&
+			left.useRecurrence == right.useRecurrence;
+}
+
+bool operator!=(const NetworkTopology& left, const NetworkTopology& right) {
+	return !(left == right);
+}
+
+NetworkTopology getNetworkTopology(const Parameters& parameters) {
+	NetworkTopology topology;
+	topology.hiddenLayerCount = parameters.hiddenLayerCount;
+	topology.hiddenLayerNeuronCount = parameters.hiddenLayerCount > 0 ? parameters.neuronPerHiddenLayer : 0;
+	topology.inputNeuronCount = parameters.getInputNeuronCount();
+	topology.outputNeuronCount = parameters.outputNeuronCount;
+	topology.useRecurrence = parameters.useRecurrence;
+	return topology;
+}
+
+NetworkTopology getNetworkTopology(const NeuralNetwork& network) {
+	NetworkTopology topology;
+	topology.hiddenLayerCount = network.getHiddenLayerCount();
+	topology.hiddenLayerNeuronCount = network.getHiddenLayerNeuronCount();
+	topology.inputNeuronCount = network.getInputNeuronCount();
+	topology.outputNeuronCount = network.getOutputNeuronCount();
+	topology.useRecurrence = network.usesRecurrence();
+	return topology;
+}
+
+std::vector<char> serializeCheckpoint(CheckpointInfo info, const GeneticPopulation& population) {
+	info.seed = population.getSeed();
+	info.generation = population.getGeneration();
+	return serialize(info, population.size(), population.getWeightCount(),
+			[&](std::size_t i) { return population.getWeights(i); },
+			[&](std::size_t i) { return population.getFitness(i); },
+			[&](std::size_t i) { return population.isUnchanged(i); });
+}
+
+std::vector<char> serializeCheckpoint(const CheckpointInfo& info, const Genomes& genomes) {
+	const unsigned weightCount = genomes.empty() ? 0 : genomes.front().weights.size();
+	for (const Genome& genome : genomes) {
+		if (genome.weights.size() != weightCount) {
+			throw CheckpointError{"The genomes have different weight counts"};
+		}
+	}
+	return serialize(info, genomes.size(), weightCount,
+			[&](std::size_t i) { return genomes[i].weights.data(); },
+			[&](std::size_t i) { return genomes[i].fitness; },
+			[&](std::size_t i) { return genomes[i].unchanged; });
+}
+
+void saveCheckpoint(const std::string& fileName, const CheckpointInfo& info,
+		const GeneticPopulation& population) {
+	writeFile(fileName, serializeCheckpoint(info, population));
+}
+
+void saveCheckpoint(const std::string& fileName, const CheckpointInfo& info,
+		const Genomes& genomes) {
+	writeFile(fileName, serializeCheckpoint(info, genomes));
+}
+
+void writeFile(const std::string& fileName, const std::vector<char>& data) {
+	std::ofstream ofs(fileName, std::ios::binary);
+	ofs.write(data.data(), data.size());
+	if (!ofs) {
+		throw CheckpointError{"Can't write checkpoint: " + fileName};
+	}
+}
+
+MappedCheckpoint::MappedCheckpoint(const std::string& fileName) {
+	checkLittleEndian();
+
+	const int file = ::open(fileName.c_str(), O_RDONLY);
+	if (file < 0) {
+		throw CheckpointError{"Can't open checkpoint: " + fileName};
+	}
+	struct stat fileStatus;
+	if (::fstat(file, &fileStatus) != 0 || fileStatus.st_size < static_cast<off_t>(headerSize)) {
+		::close(file);
+		throw CheckpointError{"Not a checkpoint: " + fileName};
+	}
+	dataSize = fileStatus.st_size;
+	data = ::mmap(nullptr, dataSize, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (data == MAP_FAILED) {
+		data = nullptr;
+		throw CheckpointError{"Can't map checkpoint: " + fileName};
+	}
+
+	try {
+		const char* bytes = static_cast<const char*>(data);
+		if (!std::equal(std::begin(magic), std::end(magic), bytes + magicOffset)) {
+			throw CheckpointError{"Not a checkpoint: " + fileName};
+		}
+		const std::uint32_t version = readNumber<std::uint32_t>(bytes + versionOffset);
+		if (version != currentVersion) {
+			throw CheckpointError{"Unsupported checkpoint version " + std::to_string(version) +
+					": " + fileName};
+		}
+
+		const std::uint32_t kind = readNumber<std::uint32_t>(bytes + kindOffset);
+		if (kind > static_cast<std::uint32_t>(CheckpointKind::network)) {
+			throw CheckpointError{"Invalid checkpoint kind: " + fileName};
+		}
+		info.kind = static_cast<CheckpointKind>(kind);
+		info.topology.hiddenLayerCount = readNumber<std::uint32_t>(bytes + hiddenLayerCountOffset);
+		info.topology.hiddenLayerNeuronCount = readNumber<std::uint32_t>(bytes + hiddenLayerNeuronCountOffset);
+		info.topology.inputNeuronCount = readNumber<std::uint32_t>(bytes + inputNeuronCountOffset);
+		info.topology.outputNeuronCount = readNumber<std::uint32_t>(bytes + outputNeuronCountOffset);
+		info.topology.useRecurrence = readNumber<std::uint32_t>(bytes + useRecurrenceOffset) != 0;
+		info.generation = readNumber<std::uint32_t>(bytes + generationOffset);
+		info.seed = readNumber<std::uint64_t>(bytes + seedOffset);
+		info.simulationFingerprint = readNumber<std::uint64_t>(bytes + simulationFingerprintOffset);
+		genomeCount = readNumber<std::uint32_t>(bytes + genomeCountOffset);
+		weightCount = readNumber<std::uint32_t>(bytes + weightCountOffset);
+
+		const std::uint64_t fitnessesStart = readNumber<std::uint64_t>(bytes + fitnessesOffset);
+		const std::uint64_t unchangedStart = readNumber<std::uint64_t>(bytes + unchangedOffset);
+		const std::uint64_t weightsStart = readNumber<std::uint64_t>(bytes + weightsOffset);
+
+		//every block has to be inside the file, and the floats have to be aligned;
+		//the sizes are compared to the rest of the file, so a corrupt start can't wrap
+		const std::uint64_t fitnessBytes = std::uint64_t{genomeCount} * sizeof(float);
+		const std::uint64_t weightBytes = std::uint64_t{genomeCount} * weightCount * sizeof(Weight);
+		if (fitnessesStart < headerSize || fitnessesStart % sizeof(float) != 0 ||
+				weightsStart % sizeof(Weight) != 0 ||
+				fitnessesStart > dataSize || fitnessBytes > dataSize - fitnessesStart ||
+				unchangedStart > dataSize || genomeCount > dataSize - unchangedStart ||
+				weightsStart > dataSize || weightBytes > dataSize - weightsStart) {
+			throw CheckpointError{"Truncated or corrupt checkpoint: " + fileName};
+		}
+		if (info.topology.isKnown() && info.topology.getWeightCount() != weightCount) {
+			throw CheckpointError{"The weight count doesn't match the network topology: " + fileName};
+		}
+
+		fitnesses = reinterpret_cast<const float*>(bytes + fitnessesStart);
+		unchanged = reinterpret_cast<const std::uint8_t*>(bytes + unchangedStart);
+		weights = reinterpret_cast<const Weight*>(bytes + weightsStart);
+	} catch (...) {
+		::munmap(data, dataSize);
+		throw;
+	}
+}
+
+MappedCheckpoint::~MappedCheckpoint() {
+	if (data != nullptr) {
+		::munmap(data, dataSize);
+	}
+}
+
+Genomes MappedCheckpoint::getGenomes() const {
+	Genomes genomes;
+	genomes.reserve(genomeCount);
+	for (std::size_t i = 0; i < genomeCount; ++i) {
+		Genome genome{Weights(getWeights(i), getWeights(i) + weightCount), fitnesses[i]};
+		genome.unchanged = unchanged[i] != 0;
+		genomes.push_back(genome);
+	}
+	return genomes;
+}
+
+void MappedCheckpoint::restorePopulation(GeneticPopulation& population,
+		std::uint64_t simulationFingerprint, bool restoreSeed) const {
+	if (population.getWeightCount() != weightCount) {
+		throw CheckpointError{"The checkpoint has " + std::to_string(weightCount) +
+				" weights per genome instead of " + std::to_string(population.getWeightCount())};
+	}
+
+	if (info.simulationFingerprint != 0 && info.simulationFingerprint == simulationFingerprint) {
+		population.setGenomes(genomeCount, weights, fitnesses, unchanged);
+	} else {
+		//the fitnesses were calculated in a different setup
+		const std::vector<float> zeroFitnesses(genomeCount, 0.f);
+		const std::vector<std::uint8_t> changed(genomeCount, 0);
+		population.setGenomes(genomeCount, weights, zeroFitnesses.data(), changed.data());
+	}
+	population.restoreState(restoreSeed ? info.seed : population.getSeed(), info.generation);
+}
+
+bool isBinaryCheckpoint(const std::string& fileName) {
+	std::ifstream ifs(fileName, std::ios::binary);
+	char start[sizeof(magic)] = {};
+	ifs.read(start, sizeof(start));
+	return ifs && std::equal(std::begin(magic), std::end(magic), start);
+}
+
+void saveNeuralNetwork(const std::string& fileName, const NeuralNetwork& network,
+		CheckpointFormat format) {
+	if (format == CheckpointFormat::binary) {
+		writeFile(fileName, serializeNeuralNetwork(network));
+		return;
+	}
+
+	std::ofstream ofs(fileName);
+	{
+		boost::archive::text_oarchive oa(ofs);
+		oa << network;
+	}
+	if (!ofs) {
+		throw CheckpointError{"Can't write network: " + fileName};
+	}
+}
+
+std::vector<char> serializeNeuralNetwork(const NeuralNetwork& network) {
+	CheckpointInfo info;
+	info.kind = CheckpointKind::network;
+	info.topology = getNetworkTopology(network);
+	return serializeCheckpoint(info, Genomes{Genome{network.getWeights()}});
+}
+
+NeuralNetwork loadNeuralNetwork(const std::string& fileName) {
+	if (isBinaryCheckpoint(fileName)) {
+		MappedCheckpoint checkpoint{fileName};
+		if (checkpoint.getInfo().kind != CheckpointKind::network || checkpoint.getGenomeCount() != 1) {
+			throw CheckpointError{"Not a network checkpoint: " + fileName};
+		}
+		NeuralNetwork network = checkpoint.getInfo().topology.createNetwork();
+		network.setWeights(Weights(checkpoint.getWeights(0),
+				checkpoint.getWeights(0) + checkpoint.getWeightCount()));
+		return network;
+	}
+
+	std::ifstream ifs(fileName);
+	if (!ifs) {
+		throw CheckpointError{"Can't open network: " + fileName};
+	}
+	boost::archive::text_iarchive ia(ifs);
+	NeuralNetwork network;
+	ia >> network;
+	return network;
+}
+
+void savePopulationText(const std::string& fileName, const Genomes& genomes) {
+	std::ofstream ofs(fileName);
+	{
+		boost::archive::text_oarchive oa(ofs);
+		oa << genomes;
+	}
+	if (!ofs) {
+		throw CheckpointError{"Can't write population: " + fileName};
+	}
+}
+
+Genomes loadPopulationText(const std::string& fileName) {
+	std::ifstream ifs(fileName);
+	if (!ifs) {
+		throw CheckpointError{"Can't open population: " + fileName};
+	}
+	boost::archive::text_iarchive ia(ifs);
+	Genomes genomes;
+	ia >> genomes;
+	return genomes;
+}
+
+void convertCheckpoint(CheckpointKind kind, const std::string& input, const std::string& output) {
+	if (kind == CheckpointKind::network) {
+		const CheckpointFormat format = isBinaryCheckpoint(input) ?
+				CheckpointFormat::text : CheckpointFormat::binary;
+		saveNeuralNetwork(output, loadNeuralNetwork(input), format);
+		return;
+	}
+
+	if (isBinaryCheckpoint(input)) {
+		MappedCheckpoint checkpoint{input};
+		if (checkpoint.getInfo().kind != CheckpointKind::population) {
+			throw CheckpointError{"Not a population checkpoint: " + input};
+		}
+		savePopulationText(output, checkpoint.getGenomes());
+	} else {
+		//the text archive only has the weights
+		saveCheckpoint(output, CheckpointInfo{}, loadPopulationText(input));
+	}
+}
+
+}
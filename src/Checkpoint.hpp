@@ -0,0 +1,142 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Genome.hpp"
+#include "NeuralNetwork.hpp"
+#include "Parameters.hpp"
+
+namespace car {
+
+class GeneticPopulation;
+
+//Binary checkpoint of a population or a network (a population of 1 genome).
+//
+//Layout, every number is little-endian:
+//  header (headerSize bytes, see Checkpoint.cpp)
+//  fitnesses: float per genome
+//  unchanged flags: byte per genome
+//  weights: genome after genome, weightCount floats each, starting at a
+//           multiple of 64 bytes
+//
+//The weight block is used directly from the memory-mapped file. Only
+//little-endian hosts are supported, others throw CheckpointError.
+
+struct CheckpointError : std::runtime_error {
+	using std::runtime_error::runtime_error;
+};
+
+//The shape of the networks. All 0 if unknown: text population archives
+//don't store it.
+struct NetworkTopology {
+	unsigned hiddenLayerCount = 0;
+	unsigned hiddenLayerNeuronCount = 0;
+	unsigned inputNeuronCount = 0;
+	unsigned outputNeuronCount = 0;
+	bool useRecurrence = false;
+
+	bool isKnown() const { return inputNeuronCount > 0; }
+	unsigned getWeightCount() const;
+	NeuralNetwork createNetwork() const;
+};
+
+bool operator==(const NetworkTopology& left, const NetworkTopology& right);
+bool operator!=(const NetworkTopology& left, const NetworkTopology& right);
+
+NetworkTopology getNetworkTopology(const Parameters& parameters);
+NetworkTopology getNetworkTopology(const NeuralNetwork& network);
+
+enum class CheckpointKind : std::uint32_t {
+	population = 0,
+	network = 1
+};
+
+//Everything in the header besides the sizes
+struct CheckpointInfo {
+	CheckpointKind kind = CheckpointKind::population;
+	NetworkTopology topology;
+	std::uint64_t seed = 0;
+	unsigned generation = 0;
+	//getSimulationFingerprint() of the fitnesses, 0 if unknown
+	std::uint64_t simulationFingerprint = 0;
+};
+
+//The content of the checkpoint file. The seed and the generation are taken
+//from population.
+std::vector<char> serializeCheckpoint(CheckpointInfo info, const GeneticPopulation& population);
+std::vector<char> serializeCheckpoint(const CheckpointInfo& info, const Genomes& genomes);
+
+void saveCheckpoint(const std::string& fileName, const CheckpointInfo& info,
+		const GeneticPopulation& population);
+void saveCheckpoint(const std::string& fileName, const CheckpointInfo& info,
+		const Genomes& genomes);
+
+//throws CheckpointError if it fails
+void writeFile(const std::string& fileName, const std::vector<char>& data);
+
+//A checkpoint file mapped into memory. Throws CheckpointError if the file
+//can't be read or it's not a valid checkpoint.
+class MappedCheckpoint {
+public:
+	explicit MappedCheckpoint(const std::string& fileName);
+	~MappedCheckpoint();
+
+	MappedCheckpoint(const MappedCheckpoint&) = delete;
+	MappedCheckpoint& operator=(const MappedCheckpoint&) = delete;
+
+	const CheckpointInfo& getInfo() const { return info; }
+	std::size_t getGenomeCount() const { return genomeCount; }
+	unsigned getWeightCount() const { return weightCount; }
+
+	//the weights of every genome, the ones of genome i start at
+	//[i * getWeightCount()]
+	const Weight* getWeights() const { return weights; }
+	const Weight* getWeights(std::size_t i) const { return weights + i*weightCount; }
+	const float* getFitnesses() const { return fitnesses; }
+	const std::uint8_t* getUnchangedFlags() const { return unchanged; }
+
+	Genomes getGenomes() const;
+
+	//Sets the genomes of population, and its seed and generation. The
+	//fitnesses are kept only if simulationFingerprint is the same as the
+	//saved one, otherwise every genome is simulated again.
+	void restorePopulation(GeneticPopulation& population,
+			std::uint64_t simulationFingerprint, bool restoreSeed = true) const;
+
+private:
+	void* data = nullptr;
+	std::size_t dataSize = 0;
+
+	CheckpointInfo info;
+	std::size_t genomeCount = 0;
+	unsigned weightCount = 0;
+	const Weight* weights = nullptr;
+	const float* fitnesses = nullptr;
+	const std::uint8_t* unchanged = nullptr;
+};
+
+//true if the file starts like a binary checkpoint
+bool isBinaryCheckpoint(const std::string& fileName);
+
+//Saves and loads networks and populations in the given format. The loaders
+//detect the format from the file.
+void saveNeuralNetwork(const std::string& fileName, const NeuralNetwork& network,
+		CheckpointFormat format);
+//the content of a binary network checkpoint
+std::vector<char> serializeNeuralNetwork(const NeuralNetwork& network);
+NeuralNetwork loadNeuralNetwork(const std::string& fileName);
+
+void savePopulationText(const std::string& fileName, const Genomes& genomes);
+Genomes loadPopulationText(const std::string& fileName);
+
+//Converts a checkpoint from text to binary or from binary to text, depending
+//on the format of input.
+void convertCheckpoint(CheckpointKind kind, const std::string& input, const std::string& output);
+
+}
+
+#endif /* !CHECKPOINT_HPP */
@@ -0,0 +1,127 @@
+#include "CheckpointWriter.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#include "Checkpoint.hpp"
+#include "Instrumentation.hpp"
+#include "Trace.hpp"
+
+namespace car {
+
+CheckpointWriter::CheckpointWriter() : thread([this] { run(); }) {}
+
+CheckpointWriter::~CheckpointWriter() {
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		stopping = true;
+	}
+	conditionVariable.notify_all();
+	thread.join();
+}
+
+void CheckpointWriter::submit(const std::string& fileName, WriteFunction write) {
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		rethrowError();
+		auto it = pending.find(fileName);
+		if (it != pending.end()) {
+			it->second = std::move(write);
+			++droppedCount;
+		} else {
+			pending.emplace(fileName, std::move(write));
+		}
+	}
+	conditionVariable.notify_all();
+}
+
+void CheckpointWriter::flush() {
+	std::unique_lock<std::mutex> lock{mutex};
+	conditionVariable.wait(lock, [this] { return pending.empty() && !writing; });
+	rethrowError();
+}
+
+std::size_t CheckpointWriter::getWrittenCount() const {
+	std::lock_guard<std::mutex> lock{mutex};
+	return writtenCount;
+}
+
+std::size_t CheckpointWriter::getDroppedCount() const {
+	std::lock_guard<std::mutex> lock{mutex};
+	return droppedCount;
+}
+
+void CheckpointWriter::rethrowError() {
+	if (error) {
+		std::exception_ptr result = error;
+		error = nullptr;
+		std::rethrow_exception(result);
+	}
+}
+
+void CheckpointWriter::run() {
+	trace::setThreadName("checkpoint writer");
+	std::unique_lock<std::mutex> lock{mutex};
+	while (true) {
+		conditionVariable.wait(lock, [this] { return stopping || !pending.empty(); });
+		if (pending.empty()) {
+			return; //stopping, and everything is written
+		}
+
+		const std::string fileName = pending.begin()->first;
+		const WriteFunction function = std::move(pending.begin()->second);
+		pending.erase(pending.begin());
+		writing = true;
+
+		lock.unlock();
+		std::exception_ptr writeError;
+		try {
+			write(fileName, function);
+		} catch (...) {
+			writeError = std::current_exception();
+		}
+		lock.lock();
+
+		writing = false;
+		if (writeError) {
+			if (!error) {
+				error = writeError;
+			}
+		} else {
+			++writtenCount;
+		}
+		conditionVariable.notify_all();
+	}
+}
+
+void CheckpointWriter::write(const std::string& fileName, const WriteFunction& function) {
+	CAR_TIME_PHASE(checkpoint);
+	trace::Scope scope{"write checkpoint"};
+	const std::string temporaryFileName = fileName + ".tmp";
+	try {
+		function(temporaryFileName);
+	} catch (...) {
+		std::remove(temporaryFileName.c_str());
+		throw;
+	}
+
+	//the content has to be on the disk before the rename makes it visible
+	const int file = ::open(temporaryFileName.c_str(), O_RDONLY);
+	if (file < 0 || ::fsync(file) != 0) {
+		if (file >= 0) {
+			::close(file);
+		}
+		std::remove(temporaryFileName.c_str());
+		throw CheckpointError{"Can't write checkpoint: " + fileName};
+	}
+	::close(file);
+
+	if (std::rename(temporaryFileName.c_str(), fileName.c_str()) != 0) {
+		std::remove(temporaryFileName.c_str());
+		throw CheckpointError{"Can't rename checkpoint: " + temporaryFileName};
+	}
+}
+
+}
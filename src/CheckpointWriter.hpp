@@ -0,0 +1,64 @@
+#ifndef CHECKPOINTWRITER_HPP
+#define CHECKPOINTWRITER_HPP
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <boost/noncopyable.hpp>
+
+namespace car {
+
+//Writes files on its own thread, so the training doesn't wait for the disk.
+//
+//The caller makes a snapshot of the data (e.g. a serialized checkpoint) and
+//submits a function writing it. Every file is written to a temporary file
+//first, then renamed, so a crash never leaves a half written file behind.
+//If a file is submitted again before the previous snapshot was written, the
+//older one is dropped instead of blocking the caller.
+class CheckpointWriter: public boost::noncopyable {
+public:
+	//Writes its snapshot to the given (temporary) file name. Throws on error.
+	typedef std::function<void(const std::string& fileName)> WriteFunction;
+
+	CheckpointWriter();
+	//Writes the pending snapshots before returning. Errors are ignored, call
+	//flush() to get them.
+	~CheckpointWriter();
+
+	//Rethrows the error of a previous write.
+	void submit(const std::string& fileName, WriteFunction write);
+
+	//Waits until every submitted snapshot is written, then rethrows the
+	//error of a write if there was one.
+	void flush();
+
+	std::size_t getWrittenCount() const;
+	std::size_t getDroppedCount() const;
+
+private:
+	void run();
+	void write(const std::string& fileName, const WriteFunction& write);
+	void rethrowError();
+
+	mutable std::mutex mutex;
+	std::condition_variable conditionVariable;
+
+	//the latest snapshot of each file
+	std::map<std::string, WriteFunction> pending;
+	bool writing = false;
+	bool stopping = false;
+	std::exception_ptr error;
+
+	std::size_t writtenCount = 0;
+	std::size_t droppedCount = 0;
+
+	std::thread thread;
+};
+
+}
+
+#endif /* !CHECKPOINTWRITER_HPP */
@@ -0,0 +1,104 @@
+#include "FitnessBound.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "AIGameManager.hpp"
+#include "Car.hpp"
+#include "Line2.hpp"
+#include "MathExpression.hpp"
+#include "mathUtil.hpp"
+
+namespace car {
+
+namespace {
+
+//for the rounding errors of the sums of the simulation
+const float distanceMargin = 1.01f;
+
+//the fitness expression is evaluated for every possible number of crossed
+//checkpoints up to this
+const float maxCrossedCheckpoints = 1e6f;
+
+}
+
+float getFitnessUpperBound(const Parameters& parameters, const track::Track& track,
+		float timeLimit) {
+	const float infinity = std::numeric_limits<float>::infinity();
+
+	//the same steps as BatchSimulator::run(), at the top speed
+	const float timeStep = 1.f / parameters.physicsTimeStepsPerSecond;
+	float travelDistance = 0.f;
+	float displacement = 0.f; //bound of the length of the path
+	float speed = 0.f;
+	for (float currentTime = 0.f; currentTime <= timeLimit;) {
+		travelDistance += timeStep * speed;
+		speed = Car::getMaxSpeedAfterStep(timeStep, speed);
+		currentTime += timeStep;
+		displacement += timeStep * speed;
+	}
+	travelDistance *= distanceMargin;
+	displacement *= distanceMargin;
+
+	const Car car = track.createCar();
+	float carRadius = 0.f;
+	for (const sf::Vector2f& corner : car.getCorners()) {
+		carRadius = std::max(carRadius, getDistance(car.getPosition(), corner));
+	}
+
+	//The first step can cross any number of checkpoints, after that they are
+	//crossed in order. So from touching a checkpoint, the car has to move
+	//close enough to touch the next ones. A lap is at least the length of
+	//the tour through every stride-th checkpoint, the stride which gives the
+	//longest one is used.
+	const std::size_t checkpointCount = track.getNumberOfCheckpoints();
+	float crossedBound = static_cast<float>(checkpointCount);
+	if (checkpointCount > 0) {
+		float lapDistance = 0.f;
+		float maxGap = 0.f;
+		for (std::size_t stride = 1; stride <= checkpointCount; ++stride) {
+			float distance = 0.f;
+			float strideMaxGap = 0.f;
+			for (std::size_t i = 0; i < checkpointCount; i += stride) {
+				const std::size_t next = std::min(i + stride, checkpointCount) % checkpointCount;
+				const float gap = std::max(0.f, getDistance(track.getCheckpoint(i),
+						track.getCheckpoint(next)) - 2*carRadius);
+				distance += gap;
+				strideMaxGap = std::max(strideMaxGap, gap);
+			}
+			if (distance > lapDistance) {
+				lapDistance = distance;
+				maxGap = strideMaxGap;
+			}
+		}
+		if (lapDistance <= 0.f) {
+			return infinity;
+		}
+		//the tour of the laps misses at most one gap at its start
+		const float lapCount = std::floor((displacement + maxGap) / lapDistance) + 1;
+		crossedBound += lapCount * checkpointCount;
+	}
+	if (crossedBound > maxCrossedCheckpoints) {
+		return infinity;
+	}
+
+	const CompiledMathExpression fitnessExpression{parameters.fitnessExpression,
+			AIGameManager::getFitnessSymbols()};
+	float bound = -infinity;
+	for (float crossed = 0.f; crossed <= crossedBound; ++crossed) {
+		//in the order of AIGameManager::getFitnessSymbols()
+		const FormulaInterval slots[] = {
+			FormulaInterval{0.f, travelDistance},
+			static_cast<FormulaValue>(checkpointCount), crossed
+		};
+		const float fitness = fitnessExpression.evaluateInterval(slots).upper;
+		if (std::isnan(fitness)) {
+			return infinity;
+		}
+		bound = std::max(bound, fitness);
+	}
+	return bound;
+}
+
+}
@@ -0,0 +1,22 @@
+#ifndef FITNESSBOUND_HPP_
+#define FITNESSBOUND_HPP_
+
+#include "Parameters.hpp"
+#include "Track/Track.hpp"
+
+namespace car {
+
+//An upper bound of the fitness any car can get on track in timeLimit
+//seconds. The travel distance is bounded by the top speed, the number of
+//crossed checkpoints by the distance between consecutive ones. The fitness
+//expression is bounded with interval evaluation over the whole range of td,
+//so it doesn't have to be monotonic.
+//
+//Infinity if the number of crossed checkpoints can't be bounded, because two
+//consecutive checkpoints are closer than the size of the car.
+float getFitnessUpperBound(const Parameters& parameters, const track::Track& track,
+		float timeLimit);
+
+}
+
+#endif /* FITNESSBOUND_HPP_ */
@@ -0,0 +1,130 @@
+#include "FitnessCache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#include "Car.hpp"
+#include "StallDetector.hpp"
+
+namespace car {
+
+namespace {
+
+//FNV-1a over 32 bit words
+class Hasher {
+public:
+	void add(std::uint32_t value) {
+		hash = (hash ^ value) * 0x100000001b3ull;
+	}
+
+	void add(float value) {
+		std::uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		add(bits);
+	}
+
+	void add(const sf::Vector2f& point) {
+		add(point.x);
+		add(point.y);
+	}
+
+	void add(const Line2f& line) {
+		add(line.start);
+		add(line.end);
+	}
+
+	void add(const std::string& string) {
+		for (char ch : string) {
+			add(static_cast<std::uint32_t>(static_cast<unsigned char>(ch)));
+		}
+	}
+
+	std::uint64_t get() const { return hash; }
+
+private:
+	std::uint64_t hash = 0xcbf29ce484222325ull;
+};
+
+}
+
+std::uint64_t getSimulationFingerprint(const Parameters& parameters,
+		const std::vector<track::TrackPtr>& tracks) {
+	Hasher hasher;
+	hasher.add(parameters.physicsTimeStepsPerSecond);
+	hasher.add(parameters.hiddenLayerCount);
+	hasher.add(parameters.neuronPerHiddenLayer);
+	hasher.add(static_cast<std::uint32_t>(parameters.useRecurrence));
+	hasher.add(parameters.rayCount);
+
+	std::ostringstream fitnessExpression;
+	fitnessExpression << parameters.fitnessExpression;
+	hasher.add(fitnessExpression.str());
+
+	//only if they are on, so the fingerprint of other setups doesn't change
+	const StallLimits stallLimits = getStallLimits(parameters);
+	if (stallLimits.isEnabled()) {
+		hasher.add(stallLimits.noCheckpointSeconds);
+		hasher.add(stallLimits.slowSpeed);
+		hasher.add(stallLimits.slowSeconds);
+		hasher.add(stallLimits.noApproachSeconds);
+	}
+
+	for (const track::TrackPtr& track : tracks) {
+		hasher.add(static_cast<std::uint32_t>(track->getNumberOfLines()));
+		for (std::size_t i = 0; i < track->getNumberOfLines(); ++i) {
+			hasher.add(track->getLine(i));
+		}
+		hasher.add(static_cast<std::uint32_t>(track->getNumberOfCheckpoints()));
+		for (std::size_t i = 0; i < track->getNumberOfCheckpoints(); ++i) {
+			hasher.add(track->getCheckpoint(i));
+		}
+		Car car = track->createCar();
+		hasher.add(car.getPosition());
+		hasher.add(car.getOrientation());
+	}
+	return hasher.get();
+}
+
+std::uint64_t hashWeights(const Weight* weights, std::size_t count) {
+	Hasher hasher;
+	for (std::size_t i = 0; i < count; ++i) {
+		hasher.add(weights[i]);
+	}
+	return hasher.get();
+}
+
+std::uint64_t hashWeights(const Weights& weights) {
+	return hashWeights(weights.data(), weights.size());
+}
+
+std::uint64_t FitnessCache::getKey(const Weight* weights, std::size_t count) const {
+	return hashWeights(weights, count) ^ fingerprint;
+}
+
+boost::optional<float> FitnessCache::find(const Weight* weights, std::size_t count) const {
+	auto range = entries.equal_range(getKey(weights, count));
+	for (auto it = range.first; it != range.second; ++it) {
+		const Weights& entryWeights = it->second.weights;
+		if (entryWeights.size() == count && std::equal(entryWeights.begin(), entryWeights.end(), weights)) {
+			return it->second.fitness;
+		}
+	}
+	return boost::none;
+}
+
+boost::optional<float> FitnessCache::find(const Weights& weights) const {
+	return find(weights.data(), weights.size());
+}
+
+void FitnessCache::insert(const Weight* weights, std::size_t count, float fitness) {
+	if (!find(weights, count)) {
+		entries.emplace(getKey(weights, count), Entry{Weights(weights, weights + count), fitness});
+	}
+}
+
+void FitnessCache::insert(const Weights& weights, float fitness) {
+	insert(weights.data(), weights.size(), fitness);
+}
+
+}
@@ -0,0 +1,52 @@
+#ifndef FITNESSCACHE_HPP_
+#define FITNESSCACHE_HPP_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "NeuronWeights.hpp"
+#include "Parameters.hpp"
+#include "Track/Track.hpp"
+
+namespace car {
+
+//Hash of everything besides the weights that the result of a simulation
+//depends on: the tracks and the simulation and network parameters.
+std::uint64_t getSimulationFingerprint(const Parameters& parameters,
+		const std::vector<track::TrackPtr>& tracks);
+
+std::uint64_t hashWeights(const Weight* weights, std::size_t count);
+std::uint64_t hashWeights(const Weights& weights);
+
+//Remembers the fitness of weights evaluated in the same simulation setup.
+//The simulation is deterministic, so they don't have to be simulated again.
+class FitnessCache {
+public:
+	explicit FitnessCache(std::uint64_t fingerprint = 0): fingerprint(fingerprint) {}
+
+	boost::optional<float> find(const Weight* weights, std::size_t count) const;
+	boost::optional<float> find(const Weights& weights) const;
+	void insert(const Weight* weights, std::size_t count, float fitness);
+	void insert(const Weights& weights, float fitness);
+	void clear() { entries.clear(); }
+
+	std::size_t size() const { return entries.size(); }
+
+private:
+	struct Entry {
+		Weights weights; //to tell hash collisions apart
+		float fitness;
+	};
+
+	std::uint64_t getKey(const Weight* weights, std::size_t count) const;
+
+	std::uint64_t fingerprint;
+	std::unordered_multimap<std::uint64_t, Entry> entries;
+};
+
+}
+
+#endif /* FITNESSCACHE_HPP_ */
@@ -6,25 +6,24 @@
 
 namespace car {
 
-GameManager::GameManager(const Parameters& parameters, std::function<track::Track()> trackCreator) :
+GameManager::GameManager(const Parameters& parameters, track::TrackPtr track) :
 	parameters(parameters),
-	track(trackCreator())
+	track(std::move(track))
 {
-	track.check();
 	init();
 }
 
 void GameManager::init() {
 	model = Model{};
 	model.setTrack(track);
-	model.setCar(model.getTrack().createCar());
-	rayPoints = model.getRayPoints(rayCount);
+	model.setCar(track->createCar());
+	model.getRayPoints(rayCount, rayPoints);
 }
 
 void GameManager::advance() {
 	handleInput();
 	model.advanceTime(physicsTimeStep);
-	rayPoints = model.getRayPoints(rayCount);
+	model.getRayPoints(rayCount, rayPoints);
 }
 
 void GameManager::setNeuralNetwork(const NeuralNetwork& network) {
@@ -38,7 +37,7 @@ void GameManager::setNeuralNetwork(const NeuralNetwork& network) {
 void GameManager::handleInput() {
 	handleUserInput();
 	if ( isAIControl ) {
-		Weights outputs = callNeuralNetwork();
+		const Weights& outputs = callNeuralNetwork();
 		assert(outputs.size() == 3);
 
 		Car& car = model.getCar();
@@ -55,10 +54,11 @@ void GameManager::handleInput() {
 
 void GameManager::handleUserInput() {}
 
-Weights GameManager::callNeuralNetwork() {
+const Weights& GameManager::callNeuralNetwork() {
 	using namespace boost::math::float_constants;
 
-	Weights inputs(rayCount + parameters.extraInputNeuronCount);
+	Weights& inputs = neuralNetworkInputs;
+	inputs.resize(rayCount + parameters.extraInputNeuronCount);
 
 	const float wallDistanceDamping = 5.f;
 	const float speedDamping = 5.f;
@@ -66,7 +66,7 @@ Weights GameManager::callNeuralNetwork() {
 
 	const sf::Vector2f& carPosition = model.getCar().getPosition();
 	for (unsigned i = 0; i < rayCount; ++i) {
-		auto rayPoint = rayPoints[i];
+		const auto& rayPoint = rayPoints[i];
 		if (rayPoint) {
 			float distance = getDistance(carPosition, *rayPoint);
 			inputs[i] = sigmoidApproximation(distance/wallDistanceDamping);
@@ -14,7 +14,7 @@ namespace car {
 class GameManager {
 public:
 
-	GameManager(const Parameters& parameters, std::function<track::Track()> trackCreator);
+	GameManager(const Parameters& parameters, track::TrackPtr track);
 
 	void advance();
 
@@ -25,7 +25,7 @@ protected:
 	void handleInput();
 	virtual void handleUserInput();
 
-	Weights callNeuralNetwork();
+	const Weights& callNeuralNetwork();
 
 	Parameters parameters;
 
@@ -36,7 +36,10 @@ protected:
 	//TODO something has to be done about who stores the variables concerning the number of
 	//inputs/outputs
 	unsigned rayCount = parameters.rayCount;
-	std::vector<boost::optional<sf::Vector2f>> rayPoints;
+
+	//These are reused in every step, so advance() doesn't allocate memory
+	Model::RayPoints rayPoints;
+	Weights neuralNetworkInputs;
 
 	NeuralNetwork neuralNetwork = NeuralNetwork(parameters.hiddenLayerCount, parameters.neuronPerHiddenLayer,
 		   parameters.getInputNeuronCount(), parameters.outputNeuronCount, parameters.useRecurrence);
@@ -44,7 +47,7 @@ protected:
 	bool isAIControl = true;
 
 	Model model;
-	track::Track track;
+	track::TrackPtr track;
 };
 
 }
@@ -1,134 +1,291 @@
 
 #include <cassert>
 #include <algorithm>
+#include <numeric>
 
 #include "GeneticPopulation.hpp"
 
+#include "Instrumentation.hpp"
 #include "randomUtil.hpp"
+#include "TaskScheduler.hpp"
 
 namespace car {
 
-GeneticPopulation::GeneticPopulation(unsigned populationSize, unsigned numberOfWeights) {
+void GeneticPopulation::Buffer::resize(std::size_t populationSize, unsigned weightCount) {
+	weights.resize(populationSize * weightCount);
+	fitnesses.resize(populationSize);
+	unchanged.resize(populationSize);
+}
+
+GeneticPopulation::GeneticPopulation(unsigned populationSize, unsigned numberOfWeights,
+		std::uint64_t seed, SelectionMethod selection) :
+	weightCount(numberOfWeights), seed(seed), selector(selection, tournamentSize) {
+	for (Buffer& buffer : buffers) {
+		buffer.resize(populationSize, weightCount);
+	}
+	sortedIndices.resize(populationSize);
+
+	const std::uint64_t generationSeed = RandomEngine::mixSeed(seed, generation);
+	Buffer& buffer = getBuffer();
 	for (unsigned i = 0; i < populationSize; ++i) {
-		Weights weights(numberOfWeights);
-		for (Weight& weight : weights) {
-			weight = randomReal(-1, 1);
+		RandomEngine engine{generationSeed, i};
+		Weight* weights = buffer.weights.data() + i*weightCount;
+		for (unsigned j = 0; j < weightCount; ++j) {
+			weights[j] = randomReal(engine, -1, 1);
 		}
-		population.push_back(Genome(weights));
 	}
 }
 
-const Genomes& GeneticPopulation::getPopulation() const {
-	return population;
+void GeneticPopulation::setFitness(std::size_t i, float fitness) {
+	getBuffer().fitnesses[i] = fitness;
+	getBuffer().unchanged[i] = true;
 }
 
-Genomes& GeneticPopulation::getPopulation() {
-	return population;
+void GeneticPopulation::setFitnessEstimate(std::size_t i, float fitness) {
+	getBuffer().fitnesses[i] = fitness;
+	getBuffer().unchanged[i] = false;
 }
 
-void GeneticPopulation::evolve() {
+Genome GeneticPopulation::getGenome(std::size_t i) const {
+	Genome genome{Weights(getWeights(i), getWeights(i) + weightCount), getFitness(i)};
+	genome.unchanged = isUnchanged(i);
+	return genome;
+}
 
-	std::sort(population.begin(), population.end());
+Genomes GeneticPopulation::getGenomes() const {
+	Genomes genomes;
+	for (std::size_t i = 0; i < size(); ++i) {
+		genomes.push_back(getGenome(i));
+	}
+	return genomes;
+}
 
-	calculateStats();
-	Genomes newPopulation;
+void GeneticPopulation::setGenomes(const Genomes& genomes) {
+	for (Buffer& buffer : buffers) {
+		buffer.resize(genomes.size(), weightCount);
+	}
+	sortedIndices.resize(genomes.size());
+
+	Buffer& buffer = getBuffer();
+	for (std::size_t i = 0; i < genomes.size(); ++i) {
+		assert(genomes[i].weights.size() == weightCount);
+		std::copy(genomes[i].weights.begin(), genomes[i].weights.end(),
+				buffer.weights.begin() + i*weightCount);
+		buffer.fitnesses[i] = genomes[i].fitness;
+		buffer.unchanged[i] = genomes[i].unchanged;
+	}
+}
+
+void GeneticPopulation::setGenomes(std::size_t count, const Weight* weights,
+		const float* fitnesses, const std::uint8_t* unchanged) {
+	for (Buffer& buffer : buffers) {
+		buffer.resize(count, weightCount);
+	}
+	sortedIndices.resize(count);
+
+	Buffer& buffer = getBuffer();
+	std::copy(weights, weights + count*weightCount, buffer.weights.begin());
+	std::copy(fitnesses, fitnesses + count, buffer.fitnesses.begin());
+	std::copy(unchanged, unchanged + count, buffer.unchanged.begin());
+}
+
+void GeneticPopulation::restoreState(std::uint64_t seed, unsigned generation) {
+	this->seed = seed;
+	this->generation = generation;
+}
+
+void GeneticPopulation::evolve(TaskScheduler* scheduler) {
+	CAR_TIME_PHASE(evolve);
 
 	assert((bestTopN * bestCopies) % 2 == 0);
-	assert(population.size() % 2 == 0);
+	assert(size() % 2 == 0);
+	assert(size() >= bestTopN);
+
+	//only the best ones have to be in order
+	const Buffer& current = getBuffer();
+	std::iota(sortedIndices.begin(), sortedIndices.end(), 0);
+	std::partial_sort(sortedIndices.begin(), sortedIndices.begin() + bestTopN, sortedIndices.end(),
+			[&current](std::size_t left, std::size_t right) {
+				return current.fitnesses[left] > current.fitnesses[right];
+			});
+
+	selector.prepare(current.fitnesses);
+	Buffer& next = buffers[1 - currentBuffer];
+
+	pickBest(bestTopN, bestCopies, next);
+
+	++generation;
+	const std::uint64_t generationSeed = RandomEngine::mixSeed(seed, generation);
+
+	//every pair of children has its own random stream and rows, so they can
+	//be bred in any order
+	const std::size_t firstChild = bestTopN * bestCopies;
+	const std::size_t pairCount = (size() - firstChild) / 2;
+	auto breedPairs = [&](std::size_t begin, std::size_t end) {
+		for (std::size_t pair = begin; pair < end; ++pair) {
+			breedPair(generationSeed, pair, firstChild, next);
+		}
+	};
+	if (scheduler != nullptr && pairCount > pairsPerTask) {
+		scheduler->parallelFor(0, (pairCount + pairsPerTask - 1) / pairsPerTask,
+			[&](std::size_t task) {
+				breedPairs(task * pairsPerTask, std::min(pairCount, (task + 1) * pairsPerTask));
+			});
+	} else {
+		breedPairs(0, pairCount);
+	}
 
-	pickBest(bestTopN, bestCopies, newPopulation);
+	currentBuffer = 1 - currentBuffer;
+}
 
-	while (newPopulation.size() < population.size()) {
-		Genome parent1 = pickRoulette();
-		Genome parent2 = pickRoulette();
+void GeneticPopulation::breedPair(std::uint64_t generationSeed, std::size_t pair,
+		std::size_t firstChild, Buffer& next) const {
+	RandomEngine engine{generationSeed, pair};
 
-		Weights child1, child2;
+	const std::size_t parent1 = selector.pick(engine);
+	const std::size_t parent2 = selector.pick(engine);
 
-		crossover(parent1.weights, parent2.weights, child1, child2);
+	const std::size_t child = firstChild + 2*pair;
+	Weight* child1 = next.weights.data() + child*weightCount;
+	Weight* child2 = child1 + weightCount;
 
-		mutate(child1);
-		mutate(child2);
+	bool crossed = crossover(engine, getWeights(parent1), getWeights(parent2), child1, child2);
 
-		newPopulation.push_back(Genome(child1, 0));
-		newPopulation.push_back(Genome(child2, 0));
-	}
+	bool mutated1 = mutate(engine, child1);
+	bool mutated2 = mutate(engine, child2);
 
-	population = newPopulation;
+	//children that are copies of their parents keep their fitness, unless
+	//it was only an estimate
+	next.unchanged[child] = !crossed && !mutated1 && isUnchanged(parent1);
+	next.fitnesses[child] = next.unchanged[child] ? getFitness(parent1) : 0.f;
+	next.unchanged[child + 1] = !crossed && !mutated2 && isUnchanged(parent2);
+	next.fitnesses[child + 1] = next.unchanged[child + 1] ? getFitness(parent2) : 0.f;
 }
 
-void GeneticPopulation::mutate(Weights& weights) const {
-	for (Weight& weight : weights) {
-		if (randomReal(0, 1) < mutationRate) {
-			weight += (randomReal(-1, 1) * maxPerturbation);
-		}
+void GeneticPopulation::receiveMigrants(const GeneticPopulation& source, unsigned count) {
+	//evolve() puts the best ones to the front
+	const std::size_t bestCount = bestTopN * bestCopies;
+	assert(size() >= bestCount && source.size() >= bestCount);
+	assert(source.getWeightCount() == weightCount);
+	const std::size_t migrantCount = std::min<std::size_t>(count,
+			std::min(bestCount, size() - bestCount));
+
+	Buffer& buffer = getBuffer();
+	for (std::size_t i = 0; i < migrantCount; ++i) {
+		const std::size_t destination = size() - 1 - i;
+		std::copy(source.getWeights(i), source.getWeights(i) + weightCount,
+				buffer.weights.begin() + destination*weightCount);
+		buffer.fitnesses[destination] = source.getFitness(i);
+		buffer.unchanged[destination] = source.isUnchanged(i);
 	}
 }
 
-Genome GeneticPopulation::pickRoulette() const {
-	float slice = randomReal(0, totalFitness);
+Genome GeneticPopulation::breedChild(std::uint64_t childIndex) const {
+	CAR_TIME_PHASE(evolve);
+	//a stream id which is not used by evolve()
+	RandomEngine engine{RandomEngine::mixSeed(seed, ~std::uint64_t{0}), childIndex};
 
-	float fitnessSoFar = 0;
-
-	for (const Genome& genome : population) {
-		fitnessSoFar += genome.fitness;
-		if (genome.fitness >= slice) {
-			return genome;
+	std::vector<std::size_t> candidates;
+	for (std::size_t i = 0; i < size(); ++i) {
+		if (isUnchanged(i)) {
+			candidates.push_back(i);
 		}
 	}
-	//we shouldn't ever get here (only if rounding error occurs)
-	return population.back();
-}
+	assert(candidates.size() >= 2);
 
-void GeneticPopulation::crossover(
-	const Weights& parent1,
-	const Weights& parent2,
-	Weights& child1,
-	Weights& child2) const {
+	const std::size_t parent1 = pickTournament(engine, candidates);
+	const std::size_t parent2 = pickTournament(engine, candidates);
 
-	assert(parent1.size() == parent2.size());
+	Weights child1(weightCount), child2(weightCount);
+	bool crossed = crossover(engine, getWeights(parent1), getWeights(parent2),
+			child1.data(), child2.data());
+	bool mutated = mutate(engine, child1.data());
 
-	if (randomReal(0, 1) > crossoverRate || parent1 == parent2) {
-		child1 = parent1;
-		child2 = parent2;
-		return;
+	Genome child{child1, 0};
+	if (!crossed && !mutated) {
+		child.fitness = getFitness(parent1);
+		child.unchanged = true;
 	}
+	return child;
+}
 
-	unsigned crossoverPoint = static_cast<unsigned>(randomInt(0, parent1.size()));
-
-	child1.clear();
-	child2.clear();
+void GeneticPopulation::replaceWorst(const Genome& child) {
+	CAR_TIME_PHASE(evolve);
+	assert(child.weights.size() == weightCount);
 
-	//create the offspring
-	for (unsigned i = 0; i < crossoverPoint; ++i) {
-		child1.push_back(parent1[i]);
-		child2.push_back(parent2[i]);
+	std::size_t worst = size();
+	for (std::size_t i = 0; i < size(); ++i) {
+		if (isUnchanged(i) && (worst == size() || getFitness(i) < getFitness(worst))) {
+			worst = i;
+		}
 	}
+	assert(worst != size());
 
-	for (unsigned i = crossoverPoint; i < parent1.size(); ++i) {
-		child1.push_back(parent2[i]);
-		child2.push_back(parent1[i]);
+	Buffer& buffer = getBuffer();
+	std::copy(child.weights.begin(), child.weights.end(), buffer.weights.begin() + worst*weightCount);
+	buffer.fitnesses[worst] = child.fitness;
+	buffer.unchanged[worst] = true;
+}
+
+std::size_t GeneticPopulation::pickTournament(RandomEngine& engine,
+		const std::vector<std::size_t>& candidates) const {
+	std::size_t best = candidates[randomInt(engine, 0, candidates.size() - 1)];
+	for (unsigned i = 1; i < tournamentSize; ++i) {
+		const std::size_t genome = candidates[randomInt(engine, 0, candidates.size() - 1)];
+		if (getFitness(genome) > getFitness(best)) {
+			best = genome;
+		}
 	}
+	return best;
 }
 
-void GeneticPopulation::pickBest(unsigned topN, unsigned copies, Genomes& newPopulation) {
-	for (unsigned i = 0; i < topN; ++i) {
-		for (unsigned j = 0; j < copies; ++j) {
-			newPopulation.push_back(population[population.size() - 1 - i]);
+bool GeneticPopulation::mutate(RandomEngine& engine, Weight* weights) const {
+	bool mutated = false;
+	for (unsigned i = 0; i < weightCount; ++i) {
+		if (randomReal(engine, 0, 1) < mutationRate) {
+			weights[i] += (randomReal(engine, -1, 1) * maxPerturbation);
+			mutated = true;
 		}
 	}
+	return mutated;
 }
 
+bool GeneticPopulation::crossover(
+	RandomEngine& engine,
+	const Weight* parent1,
+	const Weight* parent2,
+	Weight* child1,
+	Weight* child2) const {
+
+	if (randomReal(engine, 0, 1) > crossoverRate ||
+			std::equal(parent1, parent1 + weightCount, parent2)) {
+		std::copy(parent1, parent1 + weightCount, child1);
+		std::copy(parent2, parent2 + weightCount, child2);
+		return false;
+	}
 
-void GeneticPopulation::calculateStats() {
-	assert(population.size() > 0);
+	unsigned crossoverPoint = static_cast<unsigned>(randomInt(engine, 0, weightCount));
 
-	auto minmax = std::minmax_element(population.begin(), population.end());
-	worstFitnessIndex = minmax.first - population.begin();
-	bestFitnessIndex = minmax.second - population.end();
+	//create the offspring
+	std::copy(parent1, parent1 + crossoverPoint, child1);
+	std::copy(parent2, parent2 + crossoverPoint, child2);
+	std::copy(parent2 + crossoverPoint, parent2 + weightCount, child1 + crossoverPoint);
+	std::copy(parent1 + crossoverPoint, parent1 + weightCount, child2 + crossoverPoint);
 
-	totalFitness = std::accumulate(population.begin(), population.end(), 0.f,
-			[](float sum, const Genome& genome) { return sum + genome.fitness; });
+	return true;
 }
 
+void GeneticPopulation::pickBest(unsigned topN, unsigned copies, Buffer& next) const {
+	std::size_t child = 0;
+	for (unsigned i = 0; i < topN; ++i) {
+		const std::size_t best = sortedIndices[i];
+		for (unsigned j = 0; j < copies; ++j, ++child) {
+			std::copy(getWeights(best), getWeights(best) + weightCount,
+					next.weights.begin() + child*weightCount);
+			next.fitnesses[child] = getFitness(best);
+			next.unchanged[child] = isUnchanged(best);
+		}
+	}
 }
 
+}
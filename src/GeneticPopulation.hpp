@@ -1,56 +1,161 @@
 #ifndef GENETICPOPULATION_HPP
 #define GENETICPOPULATION_HPP
 
+#include <cstdint>
 #include <vector>
 
 #include "NeuralNetwork.hpp"
 #include "Genome.hpp"
+#include "RandomEngine.hpp"
+#include "Selector.hpp"
 
 namespace car {
 
+class TaskScheduler;
 
 //This class implements Genetic algorithms to mutate its population
+//
+//The weights of the genomes are the rows of a contiguous array (arena).
+//evolve() writes the next generation into a second arena, then swaps them,
+//so it doesn't copy or allocate anything after the construction.
 class GeneticPopulation {
 public:
 
 	GeneticPopulation() = default;
-	GeneticPopulation(unsigned populationSize, unsigned numberOfWeights);
+	//Every random decision is made with a generator derived from seed, the
+	//generation and the index of the genome, so the results only depend on
+	//the seed.
+	GeneticPopulation(unsigned populationSize, unsigned numberOfWeights, std::uint64_t seed,
+			SelectionMethod selection = SelectionMethod::roulette);
 
 	GeneticPopulation(const GeneticPopulation&) = default;
 	GeneticPopulation(GeneticPopulation&&) = default;
 	GeneticPopulation& operator=(const GeneticPopulation&) = default;
 	GeneticPopulation& operator=(GeneticPopulation&&) = default;
 
-	const Genomes& getPopulation() const;
-	Genomes& getPopulation();
-
-	void evolve();
+	std::size_t size() const { return getBuffer().fitnesses.size(); }
+	unsigned getWeightCount() const { return weightCount; }
+
+	//getWeightCount() weights, valid until the next evolve()
+	const Weight* getWeights(std::size_t i) const {
+		return getBuffer().weights.data() + i*weightCount;
+	}
+	float getFitness(std::size_t i) const { return getBuffer().fitnesses[i]; }
+
+	//The weights are the same as when the fitness was calculated, see
+	//Genome::unchanged.
+	bool isUnchanged(std::size_t i) const { return getBuffer().unchanged[i]; }
+
+	//Also marks the genome unchanged.
+	void setFitness(std::size_t i, float fitness);
+	//An approximate fitness, used for selection. The genome stays changed,
+	//so it's simulated again if evolve() keeps it.
+	void setFitnessEstimate(std::size_t i, float fitness);
+
+	Genome getGenome(std::size_t i) const;
+	Genomes getGenomes() const;
+
+	//The size of the population becomes the size of genomes. Every genome
+	//has to have getWeightCount() weights.
+	void setGenomes(const Genomes& genomes);
+
+	//The same for count genomes in contiguous arrays: the weights of genome i
+	//start at weights[i * getWeightCount()].
+	void setGenomes(std::size_t count, const Weight* weights, const float* fitnesses,
+			const std::uint8_t* unchanged);
+
+	std::uint64_t getSeed() const { return seed; }
+	//the number of evolve() calls
+	unsigned getGeneration() const { return generation; }
+	//the number of the best genomes evolve() keeps
+	unsigned getEliteCount() const { return bestTopN; }
+
+	//Every random generator is derived from the seed and the generation, so
+	//after restoring them (and the genomes), evolve() continues exactly as
+	//the saved population would have.
+	void restoreState(std::uint64_t seed, unsigned generation);
+
+	//The fitness of every genome has to be calculated before calling this.
+	//If scheduler is given, the children are bred in parallel tasks. The
+	//result is the same either way.
+	void evolve(TaskScheduler* scheduler = nullptr);
+
+	//Replaces the last genomes of the population with copies of the best
+	//genomes of source, which keep their fitness. Both of them have to be
+	//evolved since their fitness was calculated. At most as many genomes are
+	//moved as the number of best genomes kept by evolve(), so the best
+	//genomes of this population are not replaced.
+	void receiveMigrants(const GeneticPopulation& source, unsigned count);
+
+	//Steady-state evolution: instead of replacing the whole population at
+	//once, children are bred one by one from the genomes whose fitness is
+	//already known (unchanged), and each replaces the worst genome when its
+	//fitness is known. Every child has its own random stream, so the result
+	//only depends on the seed and the order the children are inserted.
+
+	//Picks the parents by tournament selection. At least 2 genomes have to
+	//be unchanged. If the child is a copy of a parent, it has its fitness.
+	Genome breedChild(std::uint64_t childIndex) const;
+
+	//Replaces the worst unchanged genome with child.
+	void replaceWorst(const Genome& child);
 
 private:
-	void mutate(Weights& weights) const;
+	//a generation of genomes
+	struct Buffer {
+		Weights weights; //the weights of genome i start at [i * weightCount]
+		std::vector<float> fitnesses;
+		std::vector<char> unchanged;
+
+		void resize(std::size_t populationSize, unsigned weightCount);
+	};
+
+	const Buffer& getBuffer() const { return buffers[currentBuffer]; }
+	Buffer& getBuffer() { return buffers[currentBuffer]; }
+
+	//Breeds the children at [2*pair + firstChild] and the one after it into next.
+	void breedPair(std::uint64_t generationSeed, std::size_t pair,
+			std::size_t firstChild, Buffer& next) const;
 
-	Genome pickRoulette() const;
-	void pickBest(unsigned topN, unsigned copies, Genomes& newPopulation);
+	//returns false if nothing was changed
+	bool mutate(RandomEngine& engine, Weight* weights) const;
 
-	void crossover(
-		const Weights& parent1,
-		const Weights& parent2,
-		Weights& child1,
-		Weights& child2) const;
+	//the index of the picked genome
+	std::size_t pickTournament(RandomEngine& engine, const std::vector<std::size_t>& candidates) const;
+	void pickBest(unsigned topN, unsigned copies, Buffer& next) const;
 
-	void calculateStats();
+	//returns false if the children are copies of the parents
+	bool crossover(
+		RandomEngine& engine,
+		const Weight* parent1,
+		const Weight* parent2,
+		Weight* child1,
+		Weight* child2) const;
 
-	Genomes population;
+	unsigned weightCount = 0;
+	Buffer buffers[2];
+	unsigned currentBuffer = 0;
 
-	unsigned bestFitnessIndex; //updated by calculateStats()
-	unsigned worstFitnessIndex; //updated by calculateStats()
-	float totalFitness; //updated by calculateStats()
+	//The indices of the genomes, updated by evolve(). The first ones are
+	//the best genomes in decreasing order of fitness, the rest are in no
+	//particular order.
+	std::vector<std::size_t> sortedIndices;
+
+	std::uint64_t seed = 0;
+	unsigned generation = 0; //incremented by evolve()
 
 	//constants
 	float mutationRate = 0.1;
 	float crossoverRate = 0.7;
 	float maxPerturbation = 0.3;
 	unsigned bestTopN = 8, bestCopies = 1;
+	unsigned tournamentSize = 3;
+
+	//picks the parents in evolve(), after the constants it's made of
+	Selector selector;
+
+	//the number of children pairs bred by a task of evolve()
+	static const std::size_t pairsPerTask = 8;
 
 };
 
@@ -18,6 +18,10 @@ public:
 	Weights weights;
 	float fitness = 0.f;
 
+	//The weights are the same as when fitness was calculated, so it doesn't
+	//have to be calculated again. Not serialized.
+	bool unchanged = false;
+
 private:
 	friend class boost::serialization::access;
 
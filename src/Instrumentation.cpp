@@ -0,0 +1,110 @@
+#include "Instrumentation.hpp"
+
+#ifdef CAR_INSTRUMENTATION
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace car { namespace instrumentation {
+
+const char* getPhaseName(Phase phase) {
+	switch (phase) {
+	case Phase::physics: return "physics";
+	case Phase::rayCasting: return "rayCasting";
+	case Phase::collision: return "collision";
+	case Phase::inference: return "inference";
+	case Phase::fitness: return "fitness";
+	case Phase::evolve: return "evolve";
+	case Phase::checkpoint: return "checkpoint";
+	default: return "";
+	}
+}
+
+Totals operator-(const Totals& left, const Totals& right) {
+	Totals result;
+	for (std::size_t i = 0; i < phaseCount; ++i) {
+		result.nanoseconds[i] = left.nanoseconds[i] - right.nanoseconds[i];
+		result.calls[i] = left.calls[i] - right.calls[i];
+	}
+	return result;
+}
+
+#ifdef CAR_INSTRUMENTATION
+
+namespace {
+
+//The counters of every thread which ever measured something. They are kept
+//after the thread exits, so the totals never decrease.
+struct Registry {
+	std::mutex mutex;
+	std::vector<std::shared_ptr<ThreadCounters>> threads;
+};
+
+Registry& getRegistry() {
+	static Registry registry;
+	return registry;
+}
+
+ThreadCounters* registerThread() {
+	auto counters = std::make_shared<ThreadCounters>();
+	Registry& registry = getRegistry();
+	std::lock_guard<std::mutex> lock{registry.mutex};
+	registry.threads.push_back(counters);
+	return counters.get();
+}
+
+}
+
+ThreadCounters& getThreadCounters() {
+	//a plain pointer needs no guard for the dynamic initialization on every call
+	thread_local ThreadCounters* counters = nullptr;
+	if (counters == nullptr) {
+		counters = registerThread();
+	}
+	return *counters;
+}
+
+Totals collect() {
+	Totals totals;
+	Registry& registry = getRegistry();
+	std::lock_guard<std::mutex> lock{registry.mutex};
+	for (const auto& counters : registry.threads) {
+		for (std::size_t i = 0; i < phaseCount; ++i) {
+			totals.nanoseconds[i] += counters->nanoseconds[i].load(std::memory_order_relaxed);
+			totals.calls[i] += counters->calls[i].load(std::memory_order_relaxed);
+		}
+	}
+	return totals;
+}
+
+#else
+
+Totals collect() {
+	return Totals{};
+}
+
+#endif
+
+PhaseLog::PhaseLog(std::ostream& out): out(out), previous(collect()) {
+	out << "generation";
+	for (std::size_t i = 0; i < phaseCount; ++i) {
+		const char* name = getPhaseName(static_cast<Phase>(i));
+		out << "," << name << " seconds," << name << " calls";
+	}
+	out << std::endl;
+}
+
+void PhaseLog::write(unsigned generation) {
+	const Totals totals = collect();
+	const Totals difference = totals - previous;
+	previous = totals;
+
+	out << generation;
+	for (std::size_t i = 0; i < phaseCount; ++i) {
+		out << "," << difference.nanoseconds[i] * 1e-9 << "," << difference.calls[i];
+	}
+	out << std::endl;
+}
+
+}} /* namespace car::instrumentation */
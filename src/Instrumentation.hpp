@@ -0,0 +1,117 @@
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+#ifdef CAR_INSTRUMENTATION
+#include <atomic>
+#include <chrono>
+#endif
+
+namespace car { namespace instrumentation {
+
+//Time spent in the phases of the training, measured when the program is
+//built with -DCAR_INSTRUMENTATION (see build/instrumented.config). Otherwise
+//CAR_TIME_PHASE compiles to nothing, and the counters stay 0.
+//
+//Every thread adds to its own counters, without locks or shared cache
+//lines. collect() sums the counters of every thread.
+
+enum class Phase {
+	physics,
+	rayCasting,
+	collision,
+	inference,
+	fitness,
+	evolve,
+	checkpoint
+};
+
+const std::size_t phaseCount = 7;
+
+const char* getPhaseName(Phase phase);
+
+struct Totals {
+	std::array<std::uint64_t, phaseCount> nanoseconds{};
+	std::array<std::uint64_t, phaseCount> calls{};
+};
+
+Totals operator-(const Totals& left, const Totals& right);
+
+constexpr bool isEnabled() {
+#ifdef CAR_INSTRUMENTATION
+	return true;
+#else
+	return false;
+#endif
+}
+
+//the sum of the counters of every thread since the start of the program
+Totals collect();
+
+//Writes a CSV line per generation: the generation, then the seconds and the
+//number of calls of each phase since the previous line. The seconds are
+//summed over the threads.
+class PhaseLog {
+public:
+	explicit PhaseLog(std::ostream& out);
+	void write(unsigned generation);
+
+private:
+	std::ostream& out;
+	Totals previous;
+};
+
+#ifdef CAR_INSTRUMENTATION
+
+//the counters of a thread
+struct ThreadCounters {
+	std::array<std::atomic<std::uint64_t>, phaseCount> nanoseconds{};
+	std::array<std::atomic<std::uint64_t>, phaseCount> calls{};
+};
+
+ThreadCounters& getThreadCounters();
+
+class ScopedTimer {
+public:
+	explicit ScopedTimer(Phase phase):
+			phase(static_cast<std::size_t>(phase)),
+			start(std::chrono::steady_clock::now()) {}
+
+	~ScopedTimer() {
+		const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count();
+		//only this thread writes the counters, so they don't need a locked add
+		ThreadCounters& counters = getThreadCounters();
+		counters.nanoseconds[phase].store(counters.nanoseconds[phase].load(std::memory_order_relaxed) +
+				nanoseconds, std::memory_order_relaxed);
+		counters.calls[phase].store(counters.calls[phase].load(std::memory_order_relaxed) + 1,
+				std::memory_order_relaxed);
+	}
+
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+	std::size_t phase;
+	std::chrono::steady_clock::time_point start;
+};
+
+#define CAR_INSTRUMENTATION_CONCAT_(a, b) a##b
+#define CAR_INSTRUMENTATION_CONCAT(a, b) CAR_INSTRUMENTATION_CONCAT_(a, b)
+
+//Measures the rest of the enclosing scope.
+#define CAR_TIME_PHASE(phase) ::car::instrumentation::ScopedTimer \
+		CAR_INSTRUMENTATION_CONCAT(carPhaseTimer, __LINE__){::car::instrumentation::Phase::phase}
+
+#else
+
+#define CAR_TIME_PHASE(phase) static_cast<void>(0)
+
+#endif
+
+}} /* namespace car::instrumentation */
+
+#endif /* !INSTRUMENTATION_HPP */
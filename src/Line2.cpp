@@ -1,4 +1,7 @@
 #include "Line2.hpp"
+
+#include <algorithm>
+
 #include "LineIntersection.hpp"
 
 namespace car {
@@ -150,6 +153,18 @@ sf::Vector2f nearestPoint(const sf::Vector2f& point, const Line2f& line) {
 	return detail::nearestPoint<float>(point, line);
 }
 
+float getDistance(const Line2f& line1, const Line2f& line2) {
+	if (intersects(line1, line2)) {
+		return 0.f;
+	}
+	//the nearest points of lines which don't intersect include an endpoint
+	return std::min(
+			std::min(getDistance(line1.start, nearestPoint(line1.start, line2)),
+				getDistance(line1.end, nearestPoint(line1.end, line2))),
+			std::min(getDistance(line2.start, nearestPoint(line2.start, line1)),
+				getDistance(line2.end, nearestPoint(line2.end, line1))));
+}
+
 } // namespace car
 
 
@@ -1,6 +1,10 @@
 #ifndef LINE_HPP
 #define LINE_HPP
 
+#include <cmath>
+#include <limits>
+#include <vector>
+
 #include <SFML/System/Vector2.hpp>
 
 #include "mathUtil.hpp"
@@ -21,6 +25,38 @@ struct Line2 {
 
 typedef Line2<float> Line2f;
 
+//Lines stored as separate arrays of the coordinates of their starts and of
+//their end - start vectors, for vectorized loops over many lines.
+struct LineArrays {
+	std::vector<float> startX;
+	std::vector<float> startY;
+	std::vector<float> deltaX;
+	std::vector<float> deltaY;
+
+	std::size_t size() const { return startX.size(); }
+
+	void clear() {
+		startX.clear();
+		startY.clear();
+		deltaX.clear();
+		deltaY.clear();
+	}
+
+	void resize(std::size_t size) {
+		startX.resize(size);
+		startY.resize(size);
+		deltaX.resize(size);
+		deltaY.resize(size);
+	}
+
+	void add(const Line2f& line) {
+		startX.push_back(line.start.x);
+		startY.push_back(line.start.y);
+		deltaX.push_back(line.end.x - line.start.x);
+		deltaY.push_back(line.end.y - line.start.y);
+	}
+};
+
 namespace detail {
 bool intersects(const Line2f& line1, const Line2f& line2, sf::Vector2f *outPtr);
 bool intersectsRay(const Line2f& line, const sf::Vector2f& origin, const sf::Vector2f& direction, sf::Vector2f *outPtr);
@@ -45,6 +81,8 @@ inline bool isOutsideRange(float origin1, float origin2, float start, float end)
 bool intersectsInfinite(const Line2f& line1, const Line2f& line2, sf::Vector2f *outPtr = 0);
 bool isParallel(const Line2f& line1, const Line2f& line2);
 sf::Vector2f nearestPoint(const sf::Vector2f& point, const Line2f& line);
+//the shortest distance between the points of the lines, 0 if they intersect
+float getDistance(const Line2f& line1, const Line2f& line2);
 
 inline
 bool intersects(const Line2f& line1, const Line2f& line2, sf::Vector2f *outPtr = 0) {
@@ -55,6 +93,26 @@ bool intersects(const Line2f& line1, const Line2f& line2, sf::Vector2f *outPtr =
 	return detail::intersects(line1, line2, outPtr);
 }
 
+//The ratio along the segment from origin to origin + ray where it crosses the
+//segment from start to start + delta, or infinity if they don't cross.
+//Parallel segments never cross. There are no branches, so a loop of it over
+//many segments can be vectorized, and the minimum over the segments doesn't
+//depend on their order.
+inline
+float getCrossingRatio(float originX, float originY, float rayX, float rayY,
+		float startX, float startY, float deltaX, float deltaY) {
+	const float denominator = rayX*deltaY - rayY*deltaX;
+	const float offsetX = startX - originX;
+	const float offsetY = startY - originY;
+	const float ratio = (offsetX*deltaY - offsetY*deltaX) / denominator;
+	//the ratio along the other segment is lineNumerator / |denominator|,
+	//compared without a second division
+	const float lineNumerator = std::copysign(1.f, denominator) * (offsetX*rayY - offsetY*rayX);
+	const bool crosses = (ratio >= 0.f) & (ratio <= 1.f) &
+			(lineNumerator >= 0.f) & (lineNumerator <= std::abs(denominator));
+	return crosses ? ratio : std::numeric_limits<float>::infinity();
+}
+
 inline
 bool intersectsRay(const Line2f& line, const sf::Vector2f& origin,
 		const sf::Vector2f& direction, sf::Vector2f *outPtr = 0) {
@@ -1,6 +1,13 @@
 
 #include "MathExpression.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+
 #include <boost/spirit/include/qi.hpp>
 #include <boost/spirit/include/phoenix.hpp>
 
@@ -227,6 +234,239 @@ private:
 	int precedence;
 };
 
+struct CompileVisitor : boost::static_visitor<void> {
+	typedef CompiledMathExpression::OpCode OpCode;
+	typedef CompiledMathExpression::Instruction Instruction;
+
+	CompileVisitor(CompiledMathExpression& result, const SymbolSlots& symbols) :
+		result(result), symbols(symbols) {}
+
+	void operator()(const FormulaValue& value) const {
+		Instruction instruction;
+		instruction.opCode = OpCode::constant;
+		instruction.value = value;
+		push(instruction);
+	}
+
+	void operator()(const Symbol& symbol) const {
+		auto it = std::find(symbols.begin(), symbols.end(), symbol);
+		if (it == symbols.end()) {
+			throw FormulaException{"Symbol \"" + symbol + "\" not found in symbol map."};
+		}
+		Instruction instruction;
+		instruction.opCode = OpCode::load;
+		instruction.slot = it - symbols.begin();
+		push(instruction);
+	}
+
+	void operator()(const BinaryOperator<OperatorLess>& binary) const {
+		compileBinary(OpCode::less, binary);
+	}
+
+	void operator()(const BinaryOperator<OperatorLessEqual>& binary) const {
+		compileBinary(OpCode::lessEqual, binary);
+	}
+
+	void operator()(const BinaryOperator<OperatorGreater>& binary) const {
+		compileBinary(OpCode::greater, binary);
+	}
+
+	void operator()(const BinaryOperator<OperatorGreaterEqual>& binary) const {
+		compileBinary(OpCode::greaterEqual, binary);
+	}
+
+	void operator()(const BinaryOperator<OperatorAdd>& binary) const {
+		compileBinary(OpCode::add, binary);
+	}
+
+	void operator()(const BinaryOperator<OperatorSubtract>& binary) const {
+		compileBinary(OpCode::subtract, binary);
+	}
+
+	void operator()(const BinaryOperator<OperatorMultiply>& binary) const {
+		compileBinary(OpCode::multiply, binary);
+	}
+
+	void operator()(const BinaryOperator<OperatorDivide>& binary) const {
+		compileBinary(OpCode::divide, binary);
+	}
+
+	void operator()(const UnaryOperator<OperatorMinus>& unary) const {
+		boost::apply_visitor(*this, unary.expr);
+
+		Instruction& last = result.program.back();
+		if (last.opCode == OpCode::constant) {
+			last.value = -last.value;
+			return;
+		}
+		Instruction instruction;
+		instruction.opCode = OpCode::minus;
+		result.program.push_back(instruction);
+	}
+
+private:
+	template<class Tag>
+	void compileBinary(OpCode opCode, const BinaryOperator<Tag>& binary) const {
+		boost::apply_visitor(*this, binary.left);
+		std::size_t rightBegin = result.program.size();
+		boost::apply_visitor(*this, binary.right);
+
+		//if both operands are single constants, calculate the result now
+		auto& program = result.program;
+		if (program.size() == rightBegin + 1 &&
+				program[rightBegin - 1].opCode == OpCode::constant &&
+				program[rightBegin].opCode == OpCode::constant) {
+			FormulaValue value = CompiledMathExpression::apply(opCode,
+					program[rightBegin - 1].value, program[rightBegin].value);
+			program.pop_back();
+			program.back().value = value;
+			--stackSize;
+			return;
+		}
+
+		Instruction instruction;
+		instruction.opCode = opCode;
+		program.push_back(instruction);
+		--stackSize;
+	}
+
+	void push(const Instruction& instruction) const {
+		result.program.push_back(instruction);
+		++stackSize;
+		result.maxStackSize = std::max(result.maxStackSize, stackSize);
+	}
+
+	CompiledMathExpression& result;
+	const SymbolSlots& symbols;
+	mutable std::size_t stackSize = 0;
+};
+
+CompiledMathExpression::CompiledMathExpression(const MathExpression& expression,
+		const SymbolSlots& symbols) {
+	boost::apply_visitor(CompileVisitor{*this, symbols}, expression);
+}
+
+bool CompiledMathExpression::isConstant() const {
+	return program.size() == 1 && program[0].opCode == OpCode::constant;
+}
+
+FormulaValue CompiledMathExpression::apply(OpCode opCode, FormulaValue left, FormulaValue right) {
+	switch (opCode) {
+		case OpCode::less: return left < right;
+		case OpCode::lessEqual: return left <= right;
+		case OpCode::greater: return left > right;
+		case OpCode::greaterEqual: return left >= right;
+		case OpCode::add: return left + right;
+		case OpCode::subtract: return left - right;
+		case OpCode::multiply: return left * right;
+		case OpCode::divide: return left / right;
+		default: assert(false); return 0;
+	}
+}
+
+namespace {
+
+const FormulaInterval anyValue{-std::numeric_limits<FormulaValue>::infinity(),
+		std::numeric_limits<FormulaValue>::infinity()};
+
+//the range of the results of op for the corners of the operand ranges,
+//which is the whole range if op is monotonic in both operands
+template<typename Op>
+FormulaInterval applyToCorners(const FormulaInterval& left, const FormulaInterval& right, Op op) {
+	const FormulaValue corners[] = {
+		op(left.lower, right.lower), op(left.lower, right.upper),
+		op(left.upper, right.lower), op(left.upper, right.upper)
+	};
+	for (FormulaValue corner : corners) {
+		if (std::isnan(corner)) {
+			return anyValue;
+		}
+	}
+	return FormulaInterval{*std::min_element(std::begin(corners), std::end(corners)),
+			*std::max_element(std::begin(corners), std::end(corners))};
+}
+
+//the result of a comparison which is true for some values and false for others
+FormulaInterval compare(bool alwaysTrue, bool alwaysFalse) {
+	return alwaysTrue ? FormulaInterval{1} :
+			alwaysFalse ? FormulaInterval{0} : FormulaInterval{0, 1};
+}
+
+}
+
+FormulaInterval CompiledMathExpression::apply(OpCode opCode, const FormulaInterval& left,
+		const FormulaInterval& right) {
+	if (std::isnan(left.lower) || std::isnan(left.upper) ||
+			std::isnan(right.lower) || std::isnan(right.upper)) {
+		return anyValue;
+	}
+	switch (opCode) {
+		case OpCode::less:
+			return compare(left.upper < right.lower, left.lower >= right.upper);
+		case OpCode::lessEqual:
+			return compare(left.upper <= right.lower, left.lower > right.upper);
+		case OpCode::greater:
+			return compare(left.lower > right.upper, left.upper <= right.lower);
+		case OpCode::greaterEqual:
+			return compare(left.lower >= right.upper, left.upper < right.lower);
+		case OpCode::add:
+			return applyToCorners(left, right, std::plus<FormulaValue>{});
+		case OpCode::subtract:
+			return applyToCorners(left, right, std::minus<FormulaValue>{});
+		case OpCode::multiply:
+			return applyToCorners(left, right, std::multiplies<FormulaValue>{});
+		case OpCode::divide:
+			if (right.lower <= 0 && right.upper >= 0) {
+				return anyValue;
+			}
+			return applyToCorners(left, right, std::divides<FormulaValue>{});
+		default: assert(false); return anyValue;
+	}
+}
+
+template<typename Value, typename Stack>
+Value CompiledMathExpression::run(const Value* slots, Stack& stack) const {
+	std::size_t top = 0; //number of values on the stack
+	for (const Instruction& instruction : program) {
+		switch (instruction.opCode) {
+			case OpCode::constant:
+				stack[top++] = instruction.value;
+				break;
+			case OpCode::load:
+				stack[top++] = slots[instruction.slot];
+				break;
+			case OpCode::minus:
+				stack[top - 1] = negate(stack[top - 1]);
+				break;
+			default:
+				--top;
+				stack[top - 1] = apply(instruction.opCode, stack[top - 1], stack[top]);
+				break;
+		}
+	}
+	return top == 0 ? Value{0.f} : stack[0];
+}
+
+FormulaValue CompiledMathExpression::evaluate(const FormulaValue* slots) const {
+	const std::size_t localStackSize = 32;
+	if (maxStackSize <= localStackSize) {
+		FormulaValue stack[localStackSize];
+		return run(slots, stack);
+	}
+	std::vector<FormulaValue> stack(maxStackSize);
+	return run(slots, stack);
+}
+
+FormulaInterval CompiledMathExpression::evaluateInterval(const FormulaInterval* slots) const {
+	const std::size_t localStackSize = 32;
+	if (maxStackSize <= localStackSize) {
+		FormulaInterval stack[localStackSize];
+		return run(slots, stack);
+	}
+	std::vector<FormulaInterval> stack(maxStackSize);
+	return run(slots, stack);
+}
+
 std::ostream& operator<<(std::ostream& os, const MathExpression& expression) {
 	boost::apply_visitor(PrintVisitor{os}, expression);
 	return os;
@@ -6,6 +6,7 @@
 #include <string>
 #include <stdexcept>
 #include <iostream>
+#include <vector>
 
 #include <boost/variant.hpp>
 
@@ -113,6 +114,74 @@ FormulaValue evaluateMathExpression(const MathExpression& expr, const SymbolTabl
 std::ostream& operator<<(std::ostream& os, const MathExpression& expression);
 std::istream& operator>>(std::istream& is, MathExpression& expression);
 
+//The symbols an expression can use. The index of a symbol is its slot.
+typedef std::vector<Symbol> SymbolSlots;
+
+//The closed range [lower, upper]. A value is the range of only itself.
+struct FormulaInterval {
+	FormulaInterval() = default;
+	FormulaInterval(FormulaValue value) : lower(value), upper(value) {}
+	FormulaInterval(FormulaValue lower, FormulaValue upper) :
+		lower(lower), upper(upper) {}
+
+	FormulaValue lower = 0;
+	FormulaValue upper = 0;
+};
+
+//MathExpression compiled to a flat stack program. Symbols are resolved to
+//slots and constant subexpressions are calculated when compiling, so
+//evaluation doesn't look up anything or allocate memory.
+class CompiledMathExpression {
+public:
+	CompiledMathExpression() = default;
+
+	//Throws FormulaException if expression uses a symbol not in symbols.
+	CompiledMathExpression(const MathExpression& expression, const SymbolSlots& symbols);
+
+	//slots[i] is the value of the i-th symbol given at compilation
+	FormulaValue evaluate(const FormulaValue* slots) const;
+
+	//Contains the value of the expression for any values of the symbols in
+	//the ranges of slots. It can be wider than the exact range, e.g. when a
+	//symbol is used more than once. The range is [-inf, inf] if a division
+	//by a range containing 0 or a NaN can happen.
+	FormulaInterval evaluateInterval(const FormulaInterval* slots) const;
+
+	bool isConstant() const;
+
+private:
+	enum class OpCode : unsigned char {
+		constant, load, minus,
+		less, lessEqual, greater, greaterEqual,
+		add, subtract, multiply, divide
+	};
+
+	struct Instruction {
+		OpCode opCode;
+		union {
+			FormulaValue value; //constant
+			unsigned slot; //load
+		};
+	};
+
+	friend struct CompileVisitor;
+
+	static FormulaValue apply(OpCode opCode, FormulaValue left, FormulaValue right);
+	static FormulaInterval apply(OpCode opCode, const FormulaInterval& left,
+			const FormulaInterval& right);
+
+	static FormulaValue negate(FormulaValue value) { return -value; }
+	static FormulaInterval negate(const FormulaInterval& interval) {
+		return FormulaInterval{-interval.upper, -interval.lower};
+	}
+
+	template<typename Value, typename Stack>
+	Value run(const Value* slots, Stack& stack) const;
+
+	std::vector<Instruction> program;
+	std::size_t maxStackSize = 0;
+};
+
 }
 
 #endif
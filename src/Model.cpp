@@ -14,8 +14,8 @@ void Model::setCar(const Car& newCar) {
 	car = newCar;
 }
 
-void Model::setTrack(const track::Track& newTrack) {
-	track = newTrack;
+void Model::setTrack(track::TrackPtr newTrack) {
+	track = std::move(newTrack);
 }
 
 const Car& Model::getCar() const {
@@ -27,11 +27,7 @@ Car& Model::getCar() {
 }
 
 const track::Track& Model::getTrack() const {
-	return track;
-}
-
-track::Track& Model::getTrack() {
-	return track;
+	return *track;
 }
 
 void Model::setRightPressed(bool isPressed) {
@@ -58,36 +54,21 @@ bool Model::hasCarCollided() const {
 	return isCarCollided;
 }
 
-std::vector<boost::optional<sf::Vector2f>> Model::getRayPoints(unsigned count) const {
-
-	using namespace boost::math::float_constants;
+const float Model::maxViewDistance = 50.f;
 
-	const float maxViewDistance = 50.f;
+void Model::getRayPoints(unsigned count, RayPoints& rayPoints) const {
+	//rotate the directions, so they align with the current rotation of the car
+	sf::Transform transform = Car::getRotation(car.getOrientation());
 
-	//right, (1, 0) is to the front
-	std::vector<sf::Vector2f> directions(count);
+	rayPoints.resize(count);
 	for (unsigned i = 0; i < count; ++i) {
-		directions[i] = {1, i*4.f/count - 2.f};
-	}
-
-	//rotate them, so they align with the current rotation of the car
-	const sf::Vector2f& carOrientation = car.getOrientation();
-
-	sf::Transform transform;
-	transform.rotate(std::atan2(carOrientation.y, carOrientation.x) * 180.f/pi);
-
-	for ( sf::Vector2f& v : directions ) {
-		v = transform.transformPoint(v);
-	}
-
-	std::vector<boost::optional<sf::Vector2f>> rayPoints;
-	rayPoints.reserve(count);
-
-	for ( const sf::Vector2f& v : directions ) {
-		rayPoints.push_back(track.collideWithRay(car.getPosition(), v, maxViewDistance));
+		sf::Vector2f direction = transform.transformPoint(getRayDirection(i, count));
+		rayPoints[i] = track->collideWithRay(car.getPosition(), direction, maxViewDistance);
 	}
+}
 
-	return rayPoints;
+sf::Vector2f Model::getRayDirection(unsigned index, unsigned count) {
+	return {1, index*4.f/count - 2.f};
 }
 
 unsigned Model::getNumberOfCrossedCheckpoints() const {
@@ -101,15 +82,11 @@ void Model::advanceTime(float deltaSeconds) {
 
 	car.move(deltaSeconds);
 	collideCar();
-	handleCheckpoints();
+	numberOfCrossedCheckpoints += handleCheckpoints(*track, car.getCorners(), currentCheckpoint);
 }
 
 void Model::collideCar() {
-	isCarCollided =
-		track.collidesWith(Line2f(car.getFrontLeftCorner(), car.getFrontRightCorner())) ||
-		track.collidesWith(Line2f(car.getFrontLeftCorner(), car.getRearLeftCorner())) ||
-		track.collidesWith(Line2f(car.getFrontRightCorner(), car.getRearRightCorner())) ||
-		track.collidesWith(Line2f(car.getRearLeftCorner(), car.getRearRightCorner()));
+	isCarCollided = collidesWithTrack(*track, car.getCorners());
 
 	if (isCarCollided) {
 		car.setColor(sf::Color::Red);
@@ -118,35 +95,38 @@ void Model::collideCar() {
 	}
 }
 
-bool Model::collidesWithCheckpoint(std::size_t checkpointId) {
-	return track.collidesWithCheckpoint(
-					Line2f(car.getFrontLeftCorner(), car.getFrontRightCorner()),
-					checkpointId) ||
-			track.collidesWithCheckpoint(
-					Line2f(car.getFrontLeftCorner(), car.getRearLeftCorner()),
-					checkpointId) ||
-			track.collidesWithCheckpoint(
-					Line2f(car.getFrontRightCorner(), car.getRearRightCorner()),
-					checkpointId) ||
-			track.collidesWithCheckpoint(
-					Line2f(car.getRearLeftCorner(), car.getRearRightCorner()),
-					checkpointId);
+bool Model::collidesWithTrack(const track::Track& track, const Car::Corners& corners) {
+	return track.collidesWith(Line2f(corners[0], corners[1])) ||
+		track.collidesWith(Line2f(corners[0], corners[2])) ||
+		track.collidesWith(Line2f(corners[1], corners[3])) ||
+		track.collidesWith(Line2f(corners[2], corners[3]));
 }
 
-void Model::handleCheckpoints() {
+bool Model::collidesWithCheckpoint(const track::Track& track, const Car::Corners& corners,
+		std::size_t checkpointId) {
+	return track.collidesWithCheckpoint(Line2f(corners[0], corners[1]), checkpointId) ||
+			track.collidesWithCheckpoint(Line2f(corners[0], corners[2]), checkpointId) ||
+			track.collidesWithCheckpoint(Line2f(corners[1], corners[3]), checkpointId) ||
+			track.collidesWithCheckpoint(Line2f(corners[2], corners[3]), checkpointId);
+}
+
+unsigned Model::handleCheckpoints(const track::Track& track, const Car::Corners& corners,
+		int& currentCheckpoint) {
+	unsigned crossedCheckpoints = 0;
 	if (currentCheckpoint < 0) {
 		for (std::size_t i = 0; i < track.getNumberOfCheckpoints(); ++i) {
-			if (collidesWithCheckpoint(i)) {
+			if (collidesWithCheckpoint(track, corners, i)) {
 				currentCheckpoint = (i + 1) % track.getNumberOfCheckpoints();
-				++numberOfCrossedCheckpoints;
+				++crossedCheckpoints;
 			}
 		}
 	} else {
-		if (collidesWithCheckpoint(currentCheckpoint)) {
+		if (collidesWithCheckpoint(track, corners, currentCheckpoint)) {
 			currentCheckpoint = (currentCheckpoint + 1) % track.getNumberOfCheckpoints();
-			++numberOfCrossedCheckpoints;
+			++crossedCheckpoints;
 		}
 	}
+	return crossedCheckpoints;
 }
 
 void Model::handleInput(float deltaSeconds) {
@@ -177,19 +157,22 @@ void Model::drawCar(sf::RenderWindow& window) const {
 }
 
 void Model::drawTrack(sf::RenderWindow& window, bool drawCheckpoints) const {
-	track.drawBoundary(window);
+	track->drawBoundary(window);
 	if (drawCheckpoints) {
-		track.drawCheckpoints(window, currentCheckpoint);
+		track->drawCheckpoints(window, currentCheckpoint);
 	}
 }
 
 sf::Vector2f Model::getCheckpointDirection() const {
+	return getCheckpointDirection(*track, currentCheckpoint, car.getPosition(), car.getOrientation());
+}
+
+sf::Vector2f Model::getCheckpointDirection(const track::Track& track, int currentCheckpoint,
+		const sf::Vector2f& position, const sf::Vector2f& orientation) {
 	using namespace boost::math::float_constants;
 	if (currentCheckpoint < 0) {
 		return {};
 	}
-	const auto& position = car.getPosition();
-	const auto& orientation = car.getOrientation();
 	auto angle = std::atan2(orientation.y, orientation.x);
 	auto nearestPointToCheckpoint = nearestPoint(position, track.getCheckpoint(currentCheckpoint));
 	auto absoluteDirection = nearestPointToCheckpoint - position;
@@ -15,12 +15,11 @@ public:
 	Model();
 
 	void setCar(const Car& newCar);
-	void setTrack(const track::Track& newTrack);
+	void setTrack(track::TrackPtr newTrack);
 
 	const Car& getCar() const;
 	Car& getCar();
 	const track::Track& getTrack() const;
-	track::Track& getTrack();
 
 	void setRightPressed(bool isPressed);
 	void setLeftPressed(bool isPressed);
@@ -31,9 +30,14 @@ public:
 
 	bool hasCarCollided() const;
 
-	std::vector<boost::optional<sf::Vector2f>> getRayPoints(unsigned count) const;
+	typedef std::vector<boost::optional<sf::Vector2f>> RayPoints;
+
+	//rayPoints is reused, so it doesn't allocate if it already has the capacity
+	void getRayPoints(unsigned count, RayPoints& rayPoints) const;
 
 	unsigned getNumberOfCrossedCheckpoints() const;
+	//the index of the next checkpoint, -1 before the first one
+	int getCurrentCheckpoint() const { return currentCheckpoint; }
 
 	void advanceTime(float deltaSeconds);
 
@@ -42,14 +46,30 @@ public:
 
 	sf::Vector2f getCheckpointDirection() const;
 
+	//The parts of advanceTime() and getRayPoints() on plain values, so
+	//BatchSimulator can calculate the same for its cars.
+	static const float maxViewDistance;
+
+	//(1, 0) is to the front of the car
+	static sf::Vector2f getRayDirection(unsigned index, unsigned count);
+
+	static bool collidesWithTrack(const track::Track& track, const Car::Corners& corners);
+	static bool collidesWithCheckpoint(const track::Track& track, const Car::Corners& corners,
+			std::size_t checkpointId);
+
+	//Returns the number of newly crossed checkpoints and updates currentCheckpoint.
+	static unsigned handleCheckpoints(const track::Track& track, const Car::Corners& corners,
+			int& currentCheckpoint);
+
+	static sf::Vector2f getCheckpointDirection(const track::Track& track, int currentCheckpoint,
+			const sf::Vector2f& position, const sf::Vector2f& orientation);
+
 private:
 	void collideCar();
-	void handleCheckpoints();
 	void handleInput(float deltaSeconds);
-	bool collidesWithCheckpoint(std::size_t checkpointId);
 
 	Car car;
-	track::Track track;
+	track::TrackPtr track;
 
 	bool isCarCollided = false;
 	float currentTime = 0.f;
@@ -1,23 +1,25 @@
 
 #include <unistd.h>
 
+#include <chrono>
 #include <iostream>
+#include <memory>
 #include <sstream>
-#include <fstream>
 
-#include <boost/archive/text_iarchive.hpp>
-#include <boost/archive/text_oarchive.hpp>
 #include <boost/range/algorithm.hpp>
 
 #include "NeuralController.hpp"
+#include "FitnessCache.hpp"
 #include "PopulationRunner.hpp"
+#include "StallDetector.hpp"
+#include "SteadyStateRunner.hpp"
 
 namespace car {
 
 NeuralController::NeuralController(const Parameters& parameters,
 		std::vector<std::function<track::Track()>> trackCreators,
-		boost::asio::io_service& ioService) :
-	ioService(ioService),
+		TaskScheduler& scheduler) :
+	scheduler(scheduler),
 	parameters(parameters),
 	trackCreators(trackCreators)
 {}
@@ -28,9 +30,58 @@ bool compareBestFitnesses(const PopulationRunner& lhs, const PopulationRunner& r
 	return lhs.getBestFitness() < rhs.getBestFitness();
 }
 
+//Every population gets the best genomes of the previous one, in a ring.
+void migrate(std::vector<PopulationRunner>& populations, unsigned count) {
+	for (std::size_t i = 0; i < populations.size(); ++i) {
+		const PopulationRunner& source = populations[(i + populations.size() - 1) % populations.size()];
+		populations[i].getPopulation().receiveMigrants(source.getPopulation(), count);
+	}
+}
+
 }
 
-static void printInfo(unsigned generation, float bestFitness, const std::vector<float>& populationAverages) {
+//how many genomes the prescreen rejected or the racing pruned and how many
+//cars the stall policies stopped, and the car steps they saved
+static std::string getSavingsInfo(const std::vector<PopulationRunner>& populations) {
+	std::size_t rejected = 0, pruned = 0, simulated = 0;
+	std::int64_t saved = 0;
+	std::uint64_t prunedSteps = 0;
+	StallCounters stalls;
+	for (const auto& populationData : populations) {
+		const PopulationRunner::Statistics& statistics = populationData.getStatistics();
+		rejected += statistics.rejectedGenomes;
+		simulated += statistics.simulatedGenomes;
+		saved += statistics.savedCarSteps;
+		pruned += statistics.prunedGenomes;
+		prunedSteps += statistics.prunedCarSteps;
+		stalls += statistics.stalls;
+	}
+
+	std::stringstream ss;
+	if (rejected > 0) {
+		ss << "Prescreen rejected: " << rejected << "/" << simulated << ", ";
+		ss << "Car steps saved: " << saved << ", ";
+	}
+	if (pruned > 0) {
+		ss << "Racing pruned: " << pruned << "/" << simulated << ", ";
+		ss << "Racing steps saved: " << prunedSteps << ", ";
+	}
+	std::uint64_t stallSteps = 0;
+	for (std::size_t i = 0; i < stallPolicyCount; ++i) {
+		stallSteps += stalls.savedSteps[i];
+	}
+	if (stallSteps > 0) {
+		ss << "Stalled cars:";
+		for (std::size_t i = 0; i < stallPolicyCount; ++i) {
+			ss << " " << getStallPolicyName(static_cast<StallPolicy>(i)) << " " << stalls.stoppedCars[i];
+		}
+		ss << ", Stall steps saved: " << stallSteps << ", ";
+	}
+	return ss.str();
+}
+
+static void printInfo(unsigned generation, float bestFitness, const std::vector<float>& populationAverages,
+		const std::string& extraInfo = "") {
 	std::stringstream ss;
 	ss << "Generation: " << generation << ", ";
 	ss << "Current best fitness: " << bestFitness << ", ";
@@ -38,6 +89,7 @@ static void printInfo(unsigned generation, float bestFitness, const std::vector<
 	for (float a : populationAverages) {
 		 ss << a << ", ";
 	}
+	ss << extraInfo;
 	if (isatty(1)) { //if stdout is a terminal
 		std::cout << "\033[2K\r";
 		std::cout << ss.str() << std::flush;
@@ -49,69 +101,263 @@ static void printInfo(unsigned generation, float bestFitness, const std::vector<
 
 void NeuralController::run() {
 
+	const std::vector<track::TrackPtr> tracks = createTracks();
+	simulationFingerprint = getSimulationFingerprint(parameters, tracks);
+	lastCheckpointTime = std::chrono::steady_clock::now();
+	openPhaseLog();
+	if (parameters.traceFile) {
+		traceFile.reset(new trace::TraceFile{*parameters.traceFile});
+	}
+
+	if (parameters.evolutionMode == EvolutionMode::steadyState) {
+		runSteadyState(tracks);
+		return;
+	}
+
 	std::vector<PopulationRunner> populations;
 	populations.reserve(parameters.startingPopulations);
 
 	for (std::size_t i = 0; i < parameters.startingPopulations; ++i) {
-		populations.emplace_back(parameters, trackCreators, ioService);
-		loadPopulation(populations.back().getPopulation());
+		populations.emplace_back(parameters, tracks, scheduler,
+				RandomEngine::mixSeed(parameters.seed, i));
+		//the populations would be the same with the same seed
+		loadPopulation(populations.back().getPopulation(), parameters.startingPopulations == 1);
 	}
 
 	float bestFitness = 0.f;
 
-	for (unsigned generation = 1; !parameters.generationLimit || generation <= *parameters.generationLimit;
+	//a loaded population continues from its generation
+	for (unsigned generation = populations.front().getPopulation().getGeneration() + 1;
+			!parameters.generationLimit || generation <= *parameters.generationLimit;
 			++generation) {
 
+		//the tasks of every population are in the queues together, and each
+		//population is evolved as soon as its own simulations finished
+		CompletionLatch done{populations.size()};
+		{
+			trace::Scope scope{"simulate"};
+			for (auto& populationData: populations) {
+				populationData.startIteration(done);
+			}
+			scheduler.wait(done);
+		}
+
 		std::vector<float> populationAverages;
 		for (auto& populationData: populations) {
-			populationData.runIteration();
+			populationData.finishIteration();
 			populationAverages.push_back(populationData.getAverageFitness());
 		}
 
 		auto& bestPopulation = *boost::max_element(populations, compareBestFitnesses);
-		savePopulation(bestPopulation.getPopulation());
+		if (isCheckpointDue(generation)) {
+			savePopulation(bestPopulation.getPopulation());
+		}
 		if (bestPopulation.getBestFitness() > bestFitness) {
 			bestFitness = bestPopulation.getBestFitness();
 			assert(bestPopulation.getBestGenome() != nullptr);
 			saveNeuralNetwork(*bestPopulation.getBestGenome());
 		}
 
+		if (populations.size() > 1 && parameters.migrationInterval > 0 &&
+				generation % parameters.migrationInterval == 0) {
+			trace::Scope scope{"migrate"};
+			migrate(populations, parameters.migrationSize);
+		}
+
 		if (populations.size() > 1 && generation % parameters.populationCutoff == 0) {
 			auto worstPopulation = boost::min_element(populations, compareBestFitnesses);
 			populations.erase(worstPopulation);
 		}
-		printInfo(generation, bestFitness, populationAverages);
+		printInfo(generation, bestFitness, populationAverages, getSavingsInfo(populations));
+		writePhaseLog(generation);
+		flushTrace(generation);
 	}
+	checkpointWriter.flush();
+	traceFile.reset();
+}
+
+void NeuralController::runSteadyState(const std::vector<track::TrackPtr>& tracks) {
+	SteadyStateRunner runner{parameters, tracks, scheduler, parameters.seed};
+	//the children are bred from the seed and their index, which starts from 0
+	//again, so the seed is not restored
+	loadPopulation(runner.getPopulation(), false);
+	const unsigned firstGeneration = runner.getPopulation().getGeneration() + 1;
+	runner.start();
+
+	float bestFitness = 0.f;
+
+	//a generation is as many simulations as the size of the population
+	for (unsigned generation = firstGeneration; !parameters.generationLimit || generation <= *parameters.generationLimit;
+			++generation) {
+		{
+			trace::Scope scope{"wait for evaluations"};
+			runner.waitForEvaluations(parameters.populationSize);
+		}
+
+		//the simulations go on while the results are saved
+		const Genomes genomes = runner.getGenomes();
+
+		float fitnessSum = 0.f;
+		std::size_t evaluatedCount = 0;
+		const Genome* bestGenome = nullptr;
+		for (const Genome& genome : genomes) {
+			if (!genome.unchanged) {
+				continue;
+			}
+			fitnessSum += genome.fitness;
+			++evaluatedCount;
+			if (bestGenome == nullptr || genome.fitness > bestGenome->fitness) {
+				bestGenome = &genome;
+			}
+		}
+
+		if (isCheckpointDue(generation)) {
+			savePopulation(genomes, parameters.seed, generation);
+		}
+		if (bestGenome != nullptr && bestGenome->fitness > bestFitness) {
+			bestFitness = bestGenome->fitness;
+			saveNeuralNetwork(*bestGenome);
+		}
+		printInfo(generation, bestFitness, {evaluatedCount > 0 ? fitnessSum / evaluatedCount : 0.f});
+		writePhaseLog(generation);
+		flushTrace(generation);
+	}
+	runner.stop();
+	checkpointWriter.flush();
+	traceFile.reset();
+}
+
+std::vector<track::TrackPtr> NeuralController::createTracks() const {
+	std::vector<track::TrackPtr> tracks(trackCreators.size());
+	scheduler.parallelFor(0, trackCreators.size(), [this, &tracks](std::size_t i) {
+			tracks[i] = track::createTrack(trackCreators[i]);
+		});
+	return tracks;
 }
 
 void NeuralController::saveNeuralNetwork(const Genome& genome) {
+	CAR_TIME_PHASE(checkpoint);
+	trace::Scope scope{"checkpoint"};
 	//TODO we are reconstucting the same network as above
-	NeuralNetwork network(parameters.hiddenLayerCount, parameters.neuronPerHiddenLayer,
-			parameters.getInputNeuronCount(), parameters.outputNeuronCount, parameters.useRecurrence);
+	auto network = std::make_shared<NeuralNetwork>(parameters.hiddenLayerCount,
+			parameters.neuronPerHiddenLayer, parameters.getInputNeuronCount(),
+			parameters.outputNeuronCount, parameters.useRecurrence);
+
+	network->setWeights(genome.weights);
+
+	const CheckpointFormat format = parameters.checkpointFormat;
+	checkpointWriter.submit(parameters.bestAIFile, [network, format](const std::string& fileName) {
+			car::saveNeuralNetwork(fileName, *network, format);
+		});
+}
+
+bool NeuralController::isCheckpointDue(unsigned generation) {
+	const auto now = std::chrono::steady_clock::now();
+	const bool due =
+			(parameters.checkpointInterval > 0 && generation % parameters.checkpointInterval == 0) ||
+			(parameters.checkpointSeconds > 0 &&
+				now - lastCheckpointTime >= std::chrono::duration<float>(parameters.checkpointSeconds)) ||
+			(parameters.generationLimit && generation == *parameters.generationLimit);
+	if (due) {
+		lastCheckpointTime = now;
+	}
+	return due;
+}
+
+void NeuralController::openPhaseLog() {
+	if (!instrumentation::isEnabled() || !parameters.populationOutputFile) {
+		return;
+	}
+	const std::string fileName = *parameters.populationOutputFile + ".phases.csv";
+	phaseFile.reset(new std::ofstream{fileName});
+	if (!*phaseFile) {
+		std::cerr << "Can't open " << fileName << std::endl;
+		phaseFile.reset();
+		return;
+	}
+	phaseLog.reset(new instrumentation::PhaseLog{*phaseFile});
+}
+
+void NeuralController::writePhaseLog(unsigned generation) {
+	if (phaseLog) {
+		phaseLog->write(generation);
+	}
+}
+
+void NeuralController::flushTrace(unsigned generation) {
+	if (traceFile && parameters.traceInterval > 0 && generation % parameters.traceInterval == 0) {
+		traceFile->flush();
+	}
+}
+
+CheckpointInfo NeuralController::getCheckpointInfo() const {
+	CheckpointInfo info;
+	info.topology = getNetworkTopology(parameters);
+	info.simulationFingerprint = simulationFingerprint;
+	return info;
+}
 
-	network.setWeights(genome.weights);
+void NeuralController::loadPopulation(GeneticPopulation& population, bool restoreSeed) const {
+	if (!parameters.populationInputFile) {
+		return;
+	}
+	if (!isBinaryCheckpoint(*parameters.populationInputFile)) {
+		population.setGenomes(loadPopulationText(*parameters.populationInputFile));
+		return;
+	}
 
-	std::ofstream ofs(parameters.bestAIFile);
-	boost::archive::text_oarchive oa(ofs);
-	oa << network;
+	MappedCheckpoint checkpoint{*parameters.populationInputFile};
+	const NetworkTopology& topology = checkpoint.getInfo().topology;
+	if (checkpoint.getInfo().kind != CheckpointKind::population ||
+			(topology.isKnown() && topology != getNetworkTopology(parameters))) {
+		throw CheckpointError{"The population doesn't match the network parameters: " +
+				*parameters.populationInputFile};
+	}
+	checkpoint.restorePopulation(population, simulationFingerprint, restoreSeed);
 }
 
-void NeuralController::loadPopulation(GeneticPopulation& population) const {
-	if (parameters.populationInputFile) {
-		std::ifstream ifs(*parameters.populationInputFile);
-		boost::archive::text_iarchive ia(ifs);
-		ia >> population.getPopulation();
+void NeuralController::savePopulation(const GeneticPopulation& population) {
+	if (!parameters.populationOutputFile) {
+		return;
+	}
+	CAR_TIME_PHASE(checkpoint);
+	trace::Scope scope{"checkpoint"};
+	//a snapshot, the population is evolved while it's written
+	if (parameters.checkpointFormat == CheckpointFormat::binary) {
+		submitPopulation(std::make_shared<std::vector<char>>(
+				serializeCheckpoint(getCheckpointInfo(), population)));
+	} else {
+		submitPopulation(std::make_shared<Genomes>(population.getGenomes()));
 	}
 }
 
-void NeuralController::savePopulation(const GeneticPopulation& population) const {
-	if (parameters.populationOutputFile) {
-		std::ofstream ofs(*parameters.populationOutputFile);
-		boost::archive::text_oarchive oa(ofs);
-		oa << population.getPopulation();
+void NeuralController::savePopulation(const Genomes& genomes, std::uint64_t seed,
+		unsigned generation) {
+	if (!parameters.populationOutputFile) {
+		return;
+	}
+	CAR_TIME_PHASE(checkpoint);
+	trace::Scope scope{"checkpoint"};
+	if (parameters.checkpointFormat == CheckpointFormat::binary) {
+		CheckpointInfo info = getCheckpointInfo();
+		info.seed = seed;
+		info.generation = generation;
+		submitPopulation(std::make_shared<std::vector<char>>(serializeCheckpoint(info, genomes)));
+	} else {
+		submitPopulation(std::make_shared<Genomes>(genomes));
 	}
 }
 
+void NeuralController::submitPopulation(std::shared_ptr<const std::vector<char>> data) {
+	checkpointWriter.submit(*parameters.populationOutputFile, [data](const std::string& fileName) {
+			writeFile(fileName, *data);
+		});
+}
 
+void NeuralController::submitPopulation(std::shared_ptr<const Genomes> genomes) {
+	checkpointWriter.submit(*parameters.populationOutputFile, [genomes](const std::string& fileName) {
+			savePopulationText(fileName, *genomes);
+		});
 }
 
+}
@@ -2,32 +2,74 @@
 #ifndef NEURALCONTROLLER_HPP_
 #define NEURALCONTROLLER_HPP_
 
+#include <chrono>
+#include <fstream>
 #include <functional>
+#include <memory>
 
+#include "Checkpoint.hpp"
+#include "CheckpointWriter.hpp"
+#include "Genome.hpp"
+#include "Instrumentation.hpp"
 #include "Parameters.hpp"
+#include "Trace.hpp"
 #include "Track/Track.hpp"
-#include "boost/asio/io_service.hpp"
+#include "TaskScheduler.hpp"
 
 namespace car {
 
 class GeneticPopulation;
-class Genome;
 
 class NeuralController {
 public:
 	NeuralController(const Parameters& parameters,
 			std::vector<std::function<track::Track()>> trackCreators,
-			boost::asio::io_service& ioService);
+			TaskScheduler& scheduler);
 	void run();
 
 private:
-	void loadPopulation(GeneticPopulation& population) const;
-	void savePopulation(const GeneticPopulation& population) const;
+	//Creates and checks each track once, in parallel.
+	std::vector<track::TrackPtr> createTracks() const;
 
-	boost::asio::io_service& ioService;
+	void runSteadyState(const std::vector<track::TrackPtr>& tracks);
+
+	//A binary population also restores the generation, and the seed if
+	//restoreSeed is set.
+	void loadPopulation(GeneticPopulation& population, bool restoreSeed) const;
+	//The snapshots are written by checkpointWriter in the background.
+	void savePopulation(const GeneticPopulation& population);
+	void savePopulation(const Genomes& genomes, std::uint64_t seed, unsigned generation);
+	void submitPopulation(std::shared_ptr<const std::vector<char>> data);
+	void submitPopulation(std::shared_ptr<const Genomes> genomes);
+	CheckpointInfo getCheckpointInfo() const;
+
+	//The population is saved every checkpointInterval generations, after
+	//checkpointSeconds and in the last generation.
+	bool isCheckpointDue(unsigned generation);
+
+	//In instrumented builds the time of the phases is written next to the
+	//population output file, a line per generation.
+	void openPhaseLog();
+	void writePhaseLog(unsigned generation);
+
+	//Writes the trace events every traceInterval generations.
+	void flushTrace(unsigned generation);
+
+	TaskScheduler& scheduler;
 	Parameters parameters;
 	std::vector<std::function<track::Track()>> trackCreators;
 
+	//of the tracks created by run()
+	std::uint64_t simulationFingerprint = 0;
+
+	CheckpointWriter checkpointWriter;
+	std::chrono::steady_clock::time_point lastCheckpointTime;
+
+	std::unique_ptr<std::ofstream> phaseFile;
+	std::unique_ptr<instrumentation::PhaseLog> phaseLog;
+
+	std::unique_ptr<trace::TraceFile> traceFile;
+
 	void saveNeuralNetwork(const Genome& genome);
 };
 
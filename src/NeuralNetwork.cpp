@@ -3,29 +3,59 @@
 
 #include <cassert>
 #include <cmath>
+#include <algorithm>
 
 #include "mathUtil.hpp"
+#include "randomUtil.hpp"
+#include "simdUtil.hpp"
 
 namespace car {
 
+const std::size_t NeuralNetwork::laneWidth;
+
 NeuralNetwork::NeuralNetwork(
 		unsigned hiddenLayerCount,
 		unsigned hiddenLayerNeuronCount,
 		unsigned inputNeuronCount,
 		unsigned outputNeuronCount,
-		bool useRecurrence) : inputNeuronCount(inputNeuronCount)
+		bool useRecurrence) : inputNeuronCount(inputNeuronCount), useRecurrence(useRecurrence)
 {
 	if (hiddenLayerCount > 0) {
-		layers.push_back(NeuronLayer(hiddenLayerNeuronCount, inputNeuronCount, useRecurrence));
+		addLayer(hiddenLayerNeuronCount, inputNeuronCount);
 		for (unsigned i = 0; i < hiddenLayerCount - 1; ++i) {
-			layers.push_back(NeuronLayer(hiddenLayerNeuronCount, hiddenLayerNeuronCount, useRecurrence));
+			addLayer(hiddenLayerNeuronCount, hiddenLayerNeuronCount);
 		}
-		layers.push_back(NeuronLayer(outputNeuronCount, hiddenLayerNeuronCount, useRecurrence));
+		addLayer(outputNeuronCount, hiddenLayerNeuronCount);
 	} else {
-		layers.push_back(NeuronLayer(outputNeuronCount, inputNeuronCount, useRecurrence));
+		addLayer(outputNeuronCount, inputNeuronCount);
+	}
+}
+
+void NeuralNetwork::randomizeWeights(RandomEngine& engine) {
+	setWeights(Weights(getWeightCount()));
+	for (Weight& weight : ownWeights) {
+		weight = randomReal(engine, -1, 1);
+	}
+}
+
+void NeuralNetwork::addLayer(unsigned neuronCount, unsigned inputCount) {
+	Layer layer;
+	layer.inputCount = inputCount;
+	layer.neuronCount = neuronCount;
+	layer.weightOffset = ownWeights.size();
+	layer.stateOffset = recurrentState.size();
+	layers.push_back(layer);
+
+	ownWeights.resize(ownWeights.size() + neuronCount * getRowSize(layer));
+	if (useRecurrence) {
+		recurrentState.resize(recurrentState.size() + neuronCount);
 	}
 }
 
+unsigned NeuralNetwork::getRowSize(const Layer& layer) const {
+	return layer.inputCount + useRecurrence + 1;
+}
+
 unsigned NeuralNetwork::getWeightCountForNetwork(
 		unsigned hiddenLayerCount,
 		unsigned hiddenLayerNeuronCount,
@@ -33,42 +63,37 @@ unsigned NeuralNetwork::getWeightCountForNetwork(
 		unsigned outputNeuronCount,
 		bool useRecurrence)
 {
-	//we shouldn't create an object here, but this is quicker for now
-	return NeuralNetwork(hiddenLayerCount, hiddenLayerNeuronCount, inputNeuronCount, outputNeuronCount, useRecurrence).getWeightCount();
+	const unsigned rowOverhead = 1 + useRecurrence;
+	if (hiddenLayerCount == 0) {
+		return outputNeuronCount * (inputNeuronCount + rowOverhead);
+	}
+	return hiddenLayerNeuronCount * (inputNeuronCount + rowOverhead) +
+			(hiddenLayerCount - 1) * hiddenLayerNeuronCount * (hiddenLayerNeuronCount + rowOverhead) +
+			outputNeuronCount * (hiddenLayerNeuronCount + rowOverhead);
 }
 
 Weights NeuralNetwork::getWeights() const {
-	Weights result;
-	for (const NeuronLayer& layer : layers) {
-		for (const Neuron& neuron : layer.neurons) {
-			for (Weight weight : neuron.weights) {
-				result.push_back(weight);
-			}
-		}
-	}
-	return result;
+	const Weight* data = getWeightData();
+	return Weights(data, data + getWeightCount());
 }
 
 void NeuralNetwork::setWeights(const Weights& weights) {
 	assert(weights.size() == getWeightCount());
-	unsigned weightIndex = 0;
-	for (NeuronLayer& layer : layers) {
-		for (Neuron& neuron : layer.neurons) {
-			for (Weight& weight : neuron.weights) {
-				weight = weights[weightIndex++];
-			}
-		}
-	}
+	ownWeights = weights;
+	weightsView = nullptr;
+}
+
+void NeuralNetwork::setWeightsView(const Weight* weights) {
+	weightsView = weights;
+	Weights{}.swap(ownWeights);
 }
 
 unsigned NeuralNetwork::getWeightCount() const {
-	unsigned count = 0;
-	for (const NeuronLayer& layer : layers) {
-		for (const Neuron& neuron : layer.neurons) {
-			count += neuron.weights.size();
-		}
+	if (layers.empty()) {
+		return 0;
 	}
-	return count;
+	const Layer& last = layers.back();
+	return last.weightOffset + last.neuronCount * getRowSize(last);
 }
 
 unsigned NeuralNetwork::getInputNeuronCount() const {
@@ -76,23 +101,162 @@ unsigned NeuralNetwork::getInputNeuronCount() const {
 }
 
 unsigned NeuralNetwork::getOutputNeuronCount() const {
-	return layers.back().neurons.size();
+	return layers.back().neuronCount;
+}
+
+unsigned NeuralNetwork::getHiddenLayerCount() const {
+	return layers.empty() ? 0 : layers.size() - 1;
 }
 
-Weights NeuralNetwork::evaluateInput(const Weights& input) {
+unsigned NeuralNetwork::getHiddenLayerNeuronCount() const {
+	return layers.size() > 1 ? layers.front().neuronCount : 0;
+}
+
+const Weights& NeuralNetwork::evaluateInput(const Weights& input) {
 	assert(input.size() == inputNeuronCount);
 
-	Weights nextInput = input;
-	Weights output;
-	for (NeuronLayer& layer : layers) {
-		output.clear();
-		for (Neuron& neuron : layer.neurons) {
-			output.push_back(neuron.run(nextInput));
+	Weight* state = recurrentState.data();
+	return evaluateInputs(input.data(), 1, &state);
+}
+
+const Weights& NeuralNetwork::evaluateInputs(const Weight* inputs, std::size_t count,
+		Weight* const* recurrentStates) {
+	assert(!layers.empty());
+
+	const Weight* weights = getWeightData();
+	const Weight* layerInput = inputs;
+	Weights* output = nullptr;
+	for (std::size_t i = 0; i < layers.size(); ++i) {
+		const Layer& layer = layers[i];
+		const unsigned rowSize = getRowSize(layer);
+		const Weight* row = weights + layer.weightOffset;
+
+		output = &layerOutputs[i % 2];
+		output->resize(count * layer.neuronCount);
+		Weight* outputRows = output->data();
+
+		rowPointers.resize(count);
+		for (std::size_t k = 0; k < count; ++k) {
+			rowPointers[k] = layerInput + k*layer.inputCount;
 		}
-		nextInput = output; //we could move here probably
+
+		auto finishNeuron = [&](std::size_t k, unsigned j, Weight netInput) {
+			Weight* state = useRecurrence ? recurrentStates[k] + layer.stateOffset : nullptr;
+			if (useRecurrence) {
+				netInput += state[j]*row[layer.inputCount];
+			}
+			netInput += -1.f*row[rowSize - 1];
+
+			Weight result = sigmoidApproximation(netInput);
+			outputRows[k*layer.neuronCount + j] = result;
+			if (useRecurrence) {
+				state[j] = result;
+			}
+		};
+
+		//the row of the neuron stays in the cache while it's used for every input
+		for (unsigned j = 0; j < layer.neuronCount; ++j, row += rowSize) {
+			std::size_t k = 0;
+			for (; k + 4 <= count; k += 4) {
+				Weight netInputs[4];
+				dotProduct4(row, &rowPointers[k], layer.inputCount, netInputs);
+				for (std::size_t l = 0; l < 4; ++l) {
+					finishNeuron(k + l, j, netInputs[l]);
+				}
+			}
+			for (; k < count; ++k) {
+				finishNeuron(k, j, dotProduct(row, rowPointers[k], layer.inputCount));
+			}
+		}
+		layerInput = outputRows;
+	}
+	return *output;
+}
+
+const Weights& NeuralNetwork::evaluateLanes(const Weight* weights, const Weight* inputs,
+		Weight* recurrentStates) {
+	assert(!layers.empty());
+
+	const std::size_t width = laneWidth;
+	const Weight* layerInput = inputs;
+	Weights* output = nullptr;
+	for (std::size_t i = 0; i < layers.size(); ++i) {
+		const Layer& layer = layers[i];
+		const unsigned rowSize = getRowSize(layer);
+		const Weight* row = weights + layer.weightOffset*width;
+
+		output = &layerOutputs[i % 2];
+		output->resize(layer.neuronCount * width);
+		Weight* outputRows = output->data();
+
+		for (unsigned j = 0; j < layer.neuronCount; ++j, row += rowSize*width) {
+			Weight netInputs[width];
+			dotProductLanes<width>(row, layerInput, layer.inputCount, netInputs);
+
+			//the same as finishNeuron() of evaluateInputs(), with the branches
+			//out of the loops over the lanes
+			Weight* outputRow = outputRows + j*width;
+			Weight* state = useRecurrence ? recurrentStates + (layer.stateOffset + j)*width : nullptr;
+			if (useRecurrence) {
+				for (std::size_t l = 0; l < width; ++l) {
+					netInputs[l] += state[l]*row[layer.inputCount*width + l];
+				}
+			}
+			for (std::size_t l = 0; l < width; ++l) {
+				outputRow[l] = sigmoidApproximation(netInputs[l] + -1.f*row[(rowSize - 1)*width + l]);
+			}
+			if (useRecurrence) {
+				std::copy_n(outputRow, width, state);
+			}
+		}
+		layerInput = outputRows;
 	}
-	return output;
+	return *output;
 }
 
+std::vector<NeuronLayer> NeuralNetwork::toNeuronLayers() const {
+	const Weight* weights = getWeightData();
+	std::vector<NeuronLayer> result(layers.size());
+	for (std::size_t i = 0; i < layers.size(); ++i) {
+		const Layer& layer = layers[i];
+		const unsigned rowSize = getRowSize(layer);
+		result[i].neurons.resize(layer.neuronCount);
+		for (unsigned j = 0; j < layer.neuronCount; ++j) {
+			Neuron& neuron = result[i].neurons[j];
+			const Weight* row = weights + layer.weightOffset + j*rowSize;
+			neuron.weights.assign(row, row + rowSize);
+			if (useRecurrence) {
+				neuron.recurrence = recurrentState[layer.stateOffset + j];
+			}
+		}
+	}
+	return result;
 }
 
+void NeuralNetwork::fromNeuronLayers(const std::vector<NeuronLayer>& neuronLayers) {
+	layers.clear();
+	ownWeights.clear();
+	recurrentState.clear();
+	weightsView = nullptr;
+
+	useRecurrence = !neuronLayers.empty() && !neuronLayers[0].neurons.empty() &&
+			neuronLayers[0].neurons[0].recurrence;
+
+	unsigned inputCount = inputNeuronCount;
+	for (const NeuronLayer& neuronLayer : neuronLayers) {
+		addLayer(neuronLayer.neurons.size(), inputCount);
+		const Layer& layer = layers.back();
+		for (std::size_t j = 0; j < neuronLayer.neurons.size(); ++j) {
+			const Neuron& neuron = neuronLayer.neurons[j];
+			assert(neuron.weights.size() == getRowSize(layer));
+			std::copy(neuron.weights.begin(), neuron.weights.end(),
+					ownWeights.begin() + layer.weightOffset + j*getRowSize(layer));
+			if (useRecurrence) {
+				recurrentState[layer.stateOffset + j] = neuron.recurrence.value_or(0.f);
+			}
+		}
+		inputCount = neuronLayer.neurons.size();
+	}
+}
+
+}
@@ -4,12 +4,19 @@
 #include <vector>
 
 #include <boost/serialization/access.hpp>
+#include <boost/serialization/split_member.hpp>
 #include <boost/serialization/vector.hpp>
 
 #include "NeuronLayer.hpp"
+#include "RandomEngine.hpp"
 
 namespace car {
 
+//The weights of the whole network are stored in one contiguous array. Each
+//layer is a row-major matrix in it, one row per neuron:
+//[input weights..., recurrence weight (if used), bias weight]
+//This is the same order as getWeights() returns, so a genome can be used as
+//the weights of the network directly.
 class NeuralNetwork {
 public:
 	NeuralNetwork() = default;
@@ -30,29 +37,115 @@ public:
 
 	Weights getWeights() const;
 	void setWeights(const Weights& weights);
+
+	//The weights are 0 after construction.
+	void randomizeWeights(RandomEngine& engine);
+
+	//The network uses the weights without copying them, so they have to stay
+	//alive while the network is used (or until the weights are set again).
+	//It has to contain getWeightCount() elements.
+	void setWeightsView(const Weight* weights);
+
 	unsigned getWeightCount() const;
 
 	unsigned getInputNeuronCount() const;
 	unsigned getOutputNeuronCount() const;
-
-	Weights evaluateInput(const Weights& input);
+	unsigned getHiddenLayerCount() const;
+	//0 without hidden layers
+	unsigned getHiddenLayerNeuronCount() const;
+	bool usesRecurrence() const { return useRecurrence; }
+
+	//The result is valid until the next call. It doesn't allocate memory
+	//after the first call.
+	const Weights& evaluateInput(const Weights& input);
+
+	//Evaluates count input vectors with the same weights. It's faster than
+	//evaluating them one by one, because each weight is loaded once for
+	//several inputs. The inputs and the result are row-major matrices with
+	//a row for each input vector. The result of every row is the same as
+	//evaluateInput() would give.
+	//
+	//Every row has its own recurrent state: recurrentStates[i] points to
+	//getRecurrentStateSize() elements. It can be null without recurrence.
+	const Weights& evaluateInputs(const Weight* inputs, std::size_t count,
+			Weight* const* recurrentStates);
+
+	//The number of networks evaluateLanes() evaluates at once.
+	static const std::size_t laneWidth = 8;
+
+	//Evaluates laneWidth networks with the topology of this one but with
+	//their own weights, which is faster than evaluating them one by one
+	//because the loops go over the networks. The weights, the inputs, the
+	//recurrent states and the result are interleaved: element i of network l
+	//is at [i*laneWidth + l]. The results are the same as evaluateInput()
+	//of each network would give.
+	const Weights& evaluateLanes(const Weight* weights, const Weight* inputs,
+			Weight* recurrentStates);
+
+	unsigned getRecurrentStateSize() const { return recurrentState.size(); }
 
 private:
-	unsigned inputNeuronCount;
+	struct Layer {
+		unsigned inputCount;
+		unsigned neuronCount;
+		std::size_t weightOffset; //the first weight of the layer
+		std::size_t stateOffset; //the first recurrent state of the layer
+	};
+
+	void addLayer(unsigned neuronCount, unsigned inputCount);
+	unsigned getRowSize(const Layer& layer) const;
+
+	const Weight* getWeightData() const {
+		return weightsView ? weightsView : ownWeights.data();
+	}
+
+	std::vector<NeuronLayer> toNeuronLayers() const;
+	void fromNeuronLayers(const std::vector<NeuronLayer>& neuronLayers);
+
+	unsigned inputNeuronCount = 0;
+	bool useRecurrence = false;
+
+	std::vector<Layer> layers;
+
+	Weights ownWeights; //used if weightsView is null
+	const Weight* weightsView = nullptr;
 
-	std::vector<NeuronLayer> layers;
+	//previous output of each neuron if recurrence is used
+	Weights recurrentState;
+
+	//outputs of the even and odd layers, not serialized
+	Weights layerOutputs[2];
+
+	//buffer of evaluateInputs()
+	std::vector<const Weight*> rowPointers;
 
 private:
 	friend class boost::serialization::access;
 
+	//The archive format is the same as when every neuron stored its own
+	//weights, so older files can still be loaded.
 	template<class Archive>
-	void serialize(Archive& ar, const unsigned version);
+	void save(Archive& ar, const unsigned version) const;
+
+	template<class Archive>
+	void load(Archive& ar, const unsigned version);
+
+	BOOST_SERIALIZATION_SPLIT_MEMBER()
 };
 
 template<class Archive>
-void NeuralNetwork::serialize(Archive& ar, const unsigned /*version*/) {
+void NeuralNetwork::save(Archive& ar, const unsigned /*version*/) const {
+	const std::vector<NeuronLayer> neuronLayers = toNeuronLayers();
+	ar & inputNeuronCount;
+	ar & neuronLayers;
+}
+
+template<class Archive>
+void NeuralNetwork::load(Archive& ar, const unsigned /*version*/) {
+	std::vector<NeuronLayer> neuronLayers;
 	ar & inputNeuronCount;
-	ar & layers;
+	ar & neuronLayers;
+	fromNeuronLayers(neuronLayers);
 }
 
 }
@@ -10,14 +10,11 @@
 
 namespace car {
 
+//Only used for serializing NeuralNetwork, which stores the weights of all its
+//neurons together.
 class Neuron {
 public:
-	Neuron() = default;
-	Neuron(unsigned inputCount, bool isRecurrent = false);
-
-	Weight run(const Weights& input);
-
-	//size is 1+inputCount (bias)
+	//size is inputCount+1 (bias) or inputCount+2 (recurrence, bias)
 	Weights weights;
 	boost::optional<Weight> recurrence;
 
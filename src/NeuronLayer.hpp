@@ -10,10 +10,8 @@
 
 namespace car {
 
+//Only used for serializing NeuralNetwork
 struct NeuronLayer {
-	NeuronLayer() = default;
-	NeuronLayer(unsigned neuronCount, unsigned inputCount, bool hasRecurrence);
-
 	std::vector<Neuron> neurons;
 
 private:
@@ -3,8 +3,11 @@
 
 #include <stdexcept>
 #include <iostream>
+#include <random>
 
+#include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/trim.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/program_options.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/range/adaptor/reversed.hpp>
@@ -39,6 +42,146 @@ std::ostream& operator<<(std::ostream& os, PanMode panMode) {
 	}
 }
 
+std::istream& operator>>(std::istream& is, SimulationBatching& simulationBatching) {
+	std::string s;
+	is >> s;
+
+	if (boost::algorithm::iequals(s, std::string{"track"})) {
+		simulationBatching = SimulationBatching::byTrack;
+	} else if (boost::algorithm::iequals(s, std::string{"genome"})) {
+		simulationBatching = SimulationBatching::byGenome;
+	} else {
+		throw std::logic_error{"Invalid simulation batching"};
+	}
+
+	return is;
+}
+
+std::ostream& operator<<(std::ostream& os, SimulationBatching simulationBatching) {
+	switch (simulationBatching) {
+	case SimulationBatching::byTrack: return os << "track";
+	case SimulationBatching::byGenome: return os << "genome";
+	default: return os;
+	}
+}
+
+std::istream& operator>>(std::istream& is, EvolutionMode& evolutionMode) {
+	std::string s;
+	is >> s;
+
+	if (boost::algorithm::iequals(s, std::string{"generational"})) {
+		evolutionMode = EvolutionMode::generational;
+	} else if (boost::algorithm::iequals(s, std::string{"steady-state"})) {
+		evolutionMode = EvolutionMode::steadyState;
+	} else {
+		throw std::logic_error{"Invalid evolution mode"};
+	}
+
+	return is;
+}
+
+std::ostream& operator<<(std::ostream& os, EvolutionMode evolutionMode) {
+	switch (evolutionMode) {
+	case EvolutionMode::generational: return os << "generational";
+	case EvolutionMode::steadyState: return os << "steady-state";
+	default: return os;
+	}
+}
+
+std::istream& operator>>(std::istream& is, SelectionMethod& selection) {
+	std::string s;
+	is >> s;
+
+	if (boost::algorithm::iequals(s, std::string{"roulette"})) {
+		selection = SelectionMethod::roulette;
+	} else if (boost::algorithm::iequals(s, std::string{"tournament"})) {
+		selection = SelectionMethod::tournament;
+	} else if (boost::algorithm::iequals(s, std::string{"rank"})) {
+		selection = SelectionMethod::rank;
+	} else {
+		throw std::logic_error{"Invalid selection method"};
+	}
+
+	return is;
+}
+
+std::ostream& operator<<(std::ostream& os, SelectionMethod selection) {
+	switch (selection) {
+	case SelectionMethod::roulette: return os << "roulette";
+	case SelectionMethod::tournament: return os << "tournament";
+	case SelectionMethod::rank: return os << "rank";
+	default: return os;
+	}
+}
+
+std::istream& operator>>(std::istream& is, CheckpointFormat& checkpointFormat) {
+	std::string s;
+	is >> s;
+
+	if (boost::algorithm::iequals(s, std::string{"binary"})) {
+		checkpointFormat = CheckpointFormat::binary;
+	} else if (boost::algorithm::iequals(s, std::string{"text"})) {
+		checkpointFormat = CheckpointFormat::text;
+	} else {
+		throw std::logic_error{"Invalid checkpoint format"};
+	}
+
+	return is;
+}
+
+std::ostream& operator<<(std::ostream& os, CheckpointFormat checkpointFormat) {
+	switch (checkpointFormat) {
+	case CheckpointFormat::binary: return os << "binary";
+	case CheckpointFormat::text: return os << "text";
+	default: return os;
+	}
+}
+
+namespace {
+
+std::vector<unsigned> parseThreadCounts(const std::string& s) {
+	std::vector<std::string> tokens;
+	boost::algorithm::split(tokens, s, [](char ch) { return ch == ','; });
+
+	std::vector<unsigned> threadCounts;
+	for (const std::string& token : tokens) {
+		try {
+			threadCounts.push_back(boost::lexical_cast<unsigned>(boost::algorithm::trim_copy(token)));
+		} catch (const boost::bad_lexical_cast&) {
+			throw std::logic_error{"Invalid benchmark thread counts"};
+		}
+		if (threadCounts.back() == 0) {
+			throw std::logic_error{"Invalid benchmark thread counts"};
+		}
+	}
+	return threadCounts;
+}
+
+//the benchmark always runs the same workload, unless it's given explicitly
+void setBenchmarkDefaults(Parameters& parameters, const boost::program_options::variables_map& vm) {
+	if (vm.count("benchmark-threads")) {
+		parameters.benchmarkThreadCounts = parseThreadCounts(vm["benchmark-threads"].as<std::string>());
+	} else {
+		for (unsigned threads = 1; threads < parameters.threadCount; threads *= 2) {
+			parameters.benchmarkThreadCounts.push_back(threads);
+		}
+		parameters.benchmarkThreadCounts.push_back(std::max(parameters.threadCount, 1u));
+	}
+	if (vm.count("benchmark-output")) {
+		parameters.benchmarkOutputFile = vm["benchmark-output"].as<std::string>();
+	}
+	if (!parameters.generationLimit) {
+		parameters.generationLimit = 5;
+	}
+	if (parameters.tracks.empty()) {
+		for (const char* track : {"circle/default", "polygon/curvy", "polygon/zigzag"}) {
+			parameters.tracks.push_back(parameters.projectRootPath + "tracks/" + track + ".track");
+		}
+	}
+}
+
+}
+
 Parameters parseParameters(int argc, char **argv) {
 
 	namespace po = boost::program_options;
@@ -56,6 +199,13 @@ Parameters parseParameters(int argc, char **argv) {
 	commandLineOnlyDescription.add_options()
 		("help", "produce help message")
 		("ai", "train AI")
+		("benchmark", "Measure the speed of the training with a fixed workload, and write a JSON report. "
+				"The seed is 0, the generation limit is 5 and the tracks are "
+				"circle/default, polygon/curvy and polygon/zigzag unless they are given.")
+		("benchmark-threads", po::value<std::string>(),
+				"Comma separated thread counts to run the benchmark with. Default is 1, 2, 4, ... up to --threads.")
+		("benchmark-output", po::value<std::string>(),
+				"File to write the benchmark report to. Default is the standard output.")
 		("config", po::value<std::vector<std::string>>(&configFiles),
 				"Reads configuration parameters from the specified file. It can be given multiple times. "
 				"Newer values override older ones.")
@@ -63,7 +213,7 @@ Parameters parseParameters(int argc, char **argv) {
 
 	po::options_description configFileDescription("Command-line and config file options");
 	configFileDescription.add_options()
-		("seed", po::value<int>(),
+		("seed", po::value<std::uint64_t>(&parameters.seed),
 				"Seed used for random number generation (e.g. for population generation). Default is to use random seed.")
 		("population-size", po::value<unsigned>(&parameters.populationSize)->default_value(parameters.populationSize),
 				"Size of the population used in the genetic algorithm.")
@@ -83,7 +233,42 @@ Parameters parseParameters(int argc, char **argv) {
 		("output-population", po::value<std::string>(),
 				"Specifies where to save the current population.")
 		("input-population", po::value<std::string>(),
-				"Load population from file.")
+				"Load population from file. A binary population also restores the generation "
+				"and the random state, so the training continues exactly where it was saved.")
+		("checkpoint-format", po::value<CheckpointFormat>(&parameters.checkpointFormat)->default_value(parameters.checkpointFormat),
+				"Format of the saved AI and population. Allowed values: binary, text "
+				"(boost text archive). Both are loaded in either format.")
+		("checkpoint-interval", po::value<unsigned>(&parameters.checkpointInterval)->default_value(parameters.checkpointInterval),
+				"Save the population every this many generations. 0 means only by time and at the end. "
+				"The files are written in the background.")
+		("checkpoint-seconds", po::value<float>(&parameters.checkpointSeconds)->default_value(parameters.checkpointSeconds),
+				"Also save the population if this many seconds passed since the last save. 0 means never.")
+		("stall-checkpoint-seconds", po::value<float>(&parameters.stallCheckpointSeconds)->default_value(parameters.stallCheckpointSeconds),
+				"Stop simulating a car which crossed no new checkpoint for this many seconds. 0 means never.")
+		("stall-speed", po::value<float>(&parameters.stallSpeed)->default_value(parameters.stallSpeed),
+				"The speed limit of stall-speed-seconds.")
+		("stall-speed-seconds", po::value<float>(&parameters.stallSpeedSeconds)->default_value(parameters.stallSpeedSeconds),
+				"Stop simulating a car which is slower than stall-speed for this many seconds. 0 means never.")
+		("stall-approach-seconds", po::value<float>(&parameters.stallApproachSeconds)->default_value(parameters.stallApproachSeconds),
+				"Stop simulating a car which got no closer to its next checkpoint for this many seconds. "
+				"0 means never.")
+		("prescreen-seconds", po::value<float>(&parameters.prescreenSeconds)->default_value(parameters.prescreenSeconds),
+				"Simulate the new genomes for this many seconds on the first prescreen-tracks tracks first, "
+				"and simulate only the best prescreen-fraction of them fully. The rest keep the fitness "
+				"of the short simulation. 0 turns it off.")
+		("prescreen-tracks", po::value<unsigned>(&parameters.prescreenTrackCount)->default_value(parameters.prescreenTrackCount),
+				"Number of tracks used by the prescreen.")
+		("prescreen-fraction", po::value<float>(&parameters.prescreenFraction)->default_value(parameters.prescreenFraction),
+				"The portion of the prescreened genomes which is simulated fully.")
+		("racing", "Simulate the new genomes one track at a time, and stop simulating the ones "
+				"which can't become one of the best genomes kept by the evolution even with the "
+				"highest possible fitness on the remaining tracks. The best genomes still get their "
+				"exact fitness.")
+		("trace-file", po::value<std::string>(),
+				"Record when the tasks, barrier waits and phases of the training run on each thread, "
+				"and write them to this file in the Chrome trace event format (for Perfetto).")
+		("trace-interval", po::value<unsigned>(&parameters.traceInterval)->default_value(parameters.traceInterval),
+				"Write the recorded trace events every this many generations. 0 means only at the end.")
 		("track", po::value<std::vector<std::string>>(&parameters.tracks),
 				"The type of track to use. It can be given multiple times. "
 				"For AI learning, use all tracks for learning. "
@@ -91,10 +276,28 @@ Parameters parseParameters(int argc, char **argv) {
 				"Format: filename[:arg1[:arg2[:...]]]")
 		("threads,j", po::value<unsigned>(&parameters.threadCount)->default_value(parameters.threadCount),
 				"Number of threads used for population simulation.")
+		("evolution", po::value<EvolutionMode>(&parameters.evolutionMode)->default_value(parameters.evolutionMode),
+				"Evolution mode. Allowed values: generational, "
+				"steady-state (a child replaces the worst genome as soon as its simulation finished, "
+				"a generation is population-size simulations, uses a single population, "
+				"not reproducible with multiple threads)")
+		("selection", po::value<SelectionMethod>(&parameters.selection)->default_value(parameters.selection),
+				"How the parents are picked in generational evolution. Allowed values: "
+				"roulette (proportional to fitness), tournament (the best of 3), "
+				"rank (proportional to the rank of the fitness)")
 		("starting-populations", po::value<unsigned>(&parameters.startingPopulations)->default_value(parameters.startingPopulations),
 				"The number of independent populations to start the learning with.")
 		("population-cutoff", po::value<unsigned>(&parameters.populationCutoff)->default_value(parameters.populationCutoff),
 				"The number of generations after the worst population is dropped (if there are more than one).")
+		("migration-interval", po::value<unsigned>(&parameters.migrationInterval)->default_value(parameters.migrationInterval),
+				"Every this many generations, each population gets the best genomes of another one "
+				"(if there are more than one). 0 means no migration.")
+		("migration-size", po::value<unsigned>(&parameters.migrationSize)->default_value(parameters.migrationSize),
+				"The number of genomes moved by a migration. At most 8.")
+		("batch-by", po::value<SimulationBatching>(&parameters.simulationBatching)->default_value(parameters.simulationBatching),
+				"How the cars simulated together are grouped. Allowed values: "
+				"track (different genomes on one track), "
+				"genome (a genome on every track, evaluating its network for all tracks at once)")
 		("fitness-function", po::value<MathExpression>(&parameters.fitnessExpression)->default_value(parameters.fitnessExpression),
 				"Fitness function.")
 		("physics-frequency", po::value<unsigned>(&parameters.physicsTimeStepsPerSecond)->default_value(parameters.physicsTimeStepsPerSecond),
@@ -123,7 +326,9 @@ Parameters parseParameters(int argc, char **argv) {
 	}
 
 	parameters.isTrainingAI = vm.count("ai");
+	parameters.isBenchmarking = vm.count("benchmark");
 	parameters.useRecurrence = vm.count("use-recurrence");
+	parameters.racing = vm.count("racing");
 
 	// Boost only considers the first config value, but we want it the other way around
 	// so the config files are read in reverse order. Now the new values override the
@@ -145,11 +350,16 @@ Parameters parseParameters(int argc, char **argv) {
 	if (vm.count("input-population")) {
 		parameters.populationInputFile = vm["input-population"].as<std::string>();
 	}
+	if (vm.count("trace-file")) {
+		parameters.traceFile = vm["trace-file"].as<std::string>();
+	}
 
-	if (vm.count("seed")) {
-		std::srand(vm["seed"].as<int>());
-	} else {
-		std::srand(std::time(0));
+	if (parameters.isBenchmarking) {
+		setBenchmarkDefaults(parameters, vm);
+	}
+
+	if (!vm.count("seed") && !parameters.isBenchmarking) {
+		parameters.seed = std::random_device{}();
 	}
 
 
@@ -2,12 +2,15 @@
 #ifndef PARAMETERS_HPP_
 #define PARAMETERS_HPP_
 
+#include <cstdint>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <boost/optional.hpp>
 
 #include "MathExpression.hpp"
+#include "Selector.hpp"
 
 namespace car {
 
@@ -15,15 +18,43 @@ enum class PanMode {
 	enabled, disabled, automatic
 };
 
+enum class EvolutionMode {
+	generational, //every genome of a generation is simulated before the next one is bred
+	steadyState //a new child is bred whenever a simulation finished
+};
+
+//How the training groups the cars simulated together by a BatchSimulator.
+enum class SimulationBatching {
+	byTrack, //different genomes on the same track
+	byGenome //the same genomes on every track, with batched network evaluation
+};
+
+//The format of the saved networks and populations. Both are loaded in
+//either format.
+enum class CheckpointFormat {
+	binary, //see Checkpoint.hpp
+	text //boost text archives
+};
+
 struct Parameters {
 
 	std::string projectRootPath;
 
 	//running mode
 	bool isTrainingAI = false;
+	bool isBenchmarking = false;
+
+	//The training is run with each thread count. Default is 1, 2, 4, ... up
+	//to threadCount.
+	std::vector<unsigned> benchmarkThreadCounts;
+	//JSON report of the benchmark, default is the standard output
+	boost::optional<std::string> benchmarkOutputFile;
 
 	boost::optional<unsigned> generationLimit;
 
+	//every random number used for training is derived from this
+	std::uint64_t seed = 0;
+
 	unsigned physicsTimeStepsPerSecond = 64;
 
 	//Neural network parameters
@@ -51,11 +82,55 @@ struct Parameters {
 	boost::optional<std::string> populationOutputFile;
 	boost::optional<std::string> populationInputFile;
 
+	CheckpointFormat checkpointFormat = CheckpointFormat::binary;
+	//The population is saved every checkpointInterval generations, and when
+	//checkpointSeconds passed since the last save. 0 turns either off.
+	unsigned checkpointInterval = 1;
+	float checkpointSeconds = 0.f;
+
+	//The simulation of a car which didn't crash is stopped if it crosses no
+	//new checkpoint for stallCheckpointSeconds, is slower than stallSpeed for
+	//stallSpeedSeconds, or gets no closer to the next checkpoint for
+	//stallApproachSeconds. 0 seconds turns a policy off.
+	float stallCheckpointSeconds = 0.f;
+	float stallSpeed = 1.f;
+	float stallSpeedSeconds = 0.f;
+	float stallApproachSeconds = 0.f;
+
+	//Multi-fidelity evaluation: if prescreenSeconds > 0, the changed genomes
+	//are first simulated for only prescreenSeconds on the first
+	//prescreenTrackCount tracks. The best prescreenFraction of them are
+	//simulated fully, the rest keep the fitness of the prescreen as an
+	//estimate.
+	float prescreenSeconds = 0.f;
+	unsigned prescreenTrackCount = 1;
+	float prescreenFraction = 0.5f;
+
+	//Racing evaluation: the changed genomes are simulated one track at a
+	//time, and a genome is dropped once even the upper bound of the fitness
+	//on the remaining tracks can't get it among the elites. It keeps the sum
+	//of the tracks simulated as an estimate.
+	bool racing = false;
+
+	//Chrome trace event timeline of the threads, written every
+	//traceInterval generations (0: only at the end)
+	boost::optional<std::string> traceFile;
+	unsigned traceInterval = 10;
+
 	std::vector<std::string> tracks;
 
+	EvolutionMode evolutionMode = EvolutionMode::generational;
+	SelectionMethod selection = SelectionMethod::roulette;
+
 	unsigned startingPopulations = 1;
 	unsigned populationCutoff = 10;
 
+	//0 means no migration between the populations
+	unsigned migrationInterval = 0;
+	unsigned migrationSize = 2;
+
+	SimulationBatching simulationBatching = SimulationBatching::byGenome;
+
 	MathExpression fitnessExpression = parseMathExpression(
 		"0.5*td + (ccps > cps)*(100*cps + 2*(ccps-cps)) + (ccps <= cps)*(100*ccps)");
 
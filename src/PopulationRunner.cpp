@@ -1,97 +1,420 @@
 #include "PopulationRunner.hpp"
 
-#include <mutex>
-#include <condition_variable>
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include "FitnessBound.hpp"
 #include "Genome.hpp"
-#include "AsyncHelper.hpp"
+#include "Instrumentation.hpp"
+#include "Trace.hpp"
 
 namespace car {
 
 PopulationRunner::PopulationRunner(const Parameters& parameters,
-		std::vector<std::function<track::Track()>> trackCreators,
-		boost::asio::io_service& ioService):
-			ioService(&ioService),
+		const std::vector<track::TrackPtr>& tracks,
+		TaskScheduler& scheduler,
+		std::uint64_t seed):
+			scheduler(&scheduler),
 			population{parameters.populationSize,
 				NeuralNetwork::getWeightCountForNetwork(
 					parameters.hiddenLayerCount, parameters.neuronPerHiddenLayer,
-					parameters.getInputNeuronCount(), parameters.outputNeuronCount, parameters.useRecurrence)}
+					parameters.getInputNeuronCount(), parameters.outputNeuronCount, parameters.useRecurrence),
+				seed, parameters.selection},
+			trackCount(tracks.size()),
+			prescreenSeconds(parameters.prescreenSeconds),
+			prescreenTrackCount(std::max<std::size_t>(1,
+				std::min<std::size_t>(parameters.prescreenTrackCount, tracks.size()))),
+			prescreenFraction(parameters.prescreenFraction),
+			racing(parameters.racing),
+			fitnessCache{getSimulationFingerprint(parameters, tracks)}
 {
-	controllerDatas.reserve(parameters.populationSize);
-	for (std::size_t i = 0; i < parameters.populationSize; ++i) {
-		controllerDatas.push_back(NeuralControllerData{
-			{
-				parameters.hiddenLayerCount,
-				parameters.neuronPerHiddenLayer,
-				parameters.getInputNeuronCount(),
-				parameters.outputNeuronCount,
-				parameters.useRecurrence
-			},
-			{}
-		});
-
-		auto& controllerData = controllerDatas.back();
-		controllerData.managers.reserve(trackCreators.size());
-		for (const auto& trackCreator: trackCreators) {
-			controllerData.managers.emplace_back(parameters, trackCreator);
+	assert(trackCount > 0);
+	tracksPerTask = parameters.simulationBatching == SimulationBatching::byTrack ? 1 : trackCount;
+
+	//the other stages need at most as many as the full simulation
+	const std::size_t taskCount = getTaskCount(parameters.populationSize, trackCount);
+	simulators.reserve(taskCount);
+	for (std::size_t i = 0; i < taskCount; ++i) {
+		simulators.emplace_back(parameters, tracks);
+	}
+	trackFitnesses.resize(parameters.populationSize * trackCount);
+
+	if (racing) {
+		for (const track::TrackPtr& track : tracks) {
+			trackFitnessBounds.push_back(getFitnessUpperBound(parameters, *track, BatchSimulator::maxTime));
 		}
+		trackOrder.resize(trackCount);
+		std::iota(trackOrder.begin(), trackOrder.end(), 0);
+		trackAverageFitnesses.resize(trackCount);
+		trackAverageCarSteps.resize(trackCount);
+		racingFitnesses.resize(parameters.populationSize);
 	}
 }
 
 void PopulationRunner::runIteration() {
-	Genomes& genomes = population.getPopulation();
-	assert(genomes.size() == controllerDatas.size());
+	CompletionLatch done{1};
+	startIteration(done);
+	scheduler->wait(done);
+	finishIteration();
+}
+
+void PopulationRunner::startIteration(CompletionLatch& done) {
+	assert(population.size() * trackCount == trackFitnesses.size());
+
+	//The simulation is deterministic, so genomes evaluated before keep
+	//their fitness.
+	genomesToSimulate.clear();
+	for (std::size_t i = 0; i < population.size(); ++i) {
+		if (!population.isUnchanged(i)) {
+			if (auto fitness = fitnessCache.find(population.getWeights(i), population.getWeightCount())) {
+				population.setFitness(i, *fitness);
+			}
+		}
+		if (!population.isUnchanged(i)) {
+			genomesToSimulate.push_back(i);
+		}
+	}
+
+	iteration->error = nullptr;
+	iteration->carSteps.store(0);
+	iteration->networkCalls.store(0);
+	iteration->stalls = StallCounters{};
+	iteration->start = std::chrono::steady_clock::now();
+	statistics = Statistics{};
+	statistics.simulatedGenomes = genomesToSimulate.size();
+	rejectedGenomes.clear();
+	prunedGenomes.clear();
+	prunedFitnessEstimates.clear();
+	if (racing) {
+		eliteCutoff = getEliteCutoff();
+		orderRacingTracks();
+		iteration->racedTracks = 0;
+		for (std::size_t i : genomesToSimulate) {
+			racingFitnesses[i] = 0.f;
+		}
+	}
+	if (prescreenSeconds > 0.f && !genomesToSimulate.empty()) {
+		startStage(Stage::prescreen, done);
+	} else {
+		startStage(getFullStage(), done);
+	}
+}
 
-	std::condition_variable conditionVariable;
-	std::mutex mutex;
-	std::size_t tasksLeft{controllerDatas.size()};
+PopulationRunner::Stage PopulationRunner::getFullStage() const {
+	//the full stage batches the tracks of a genome together, so it's faster
+	//if nothing can be pruned
+	return racing && eliteCutoff > -std::numeric_limits<float>::infinity() ?
+			Stage::racing : Stage::full;
+}
 
-	for (std::size_t i = 0; i < controllerDatas.size(); ++i) {
-		auto& genome = genomes[i];
-		auto& data = controllerDatas[i];
+void PopulationRunner::startStage(Stage stage, CompletionLatch& done) {
+	iteration->stage = stage;
+	iteration->tracks.clear();
+	iteration->timeLimit = BatchSimulator::maxTime;
+	switch (stage) {
+	case Stage::prescreen:
+		for (std::size_t j = 0; j < prescreenTrackCount; ++j) {
+			iteration->tracks.push_back(j);
+		}
+		iteration->timeLimit = prescreenSeconds;
+		break;
+	case Stage::full:
+		for (std::size_t j = 0; j < trackCount; ++j) {
+			iteration->tracks.push_back(j);
+		}
+		break;
+	case Stage::racing:
+		iteration->tracks.push_back(trackOrder[iteration->racedTracks]);
+		break;
+	}
+	iteration->stageStartCarSteps = iteration->carSteps.load();
 
-		ioService->post([this, &genome, &data, &tasksLeft, &conditionVariable, &mutex]() {
-				runSimulation(genome, data);
+	const std::size_t taskCount = getTaskCount(genomesToSimulate.size(), iteration->tracks.size());
+	if (taskCount == 0) {
+		scheduler->post([this, &done] { finishStage(done); });
+		return;
+	}
 
-				{
-					std::unique_lock<std::mutex> lock{mutex};
-					if (--tasksLeft == 0) {
-						conditionVariable.notify_all();
-					}
+	iteration->remainingTasks.store(taskCount);
+	for (std::size_t task = 0; task < taskCount; ++task) {
+		scheduler->post([this, task, &done] {
+				try {
+					runTask(task);
+				} catch (...) {
+					recordError(std::current_exception());
+				}
+				//the last one starts the next stage or evolves the population
+				//right away, so it doesn't wait for the other populations
+				if (iteration->remainingTasks.fetch_sub(1) == 1) {
+					finishStage(done);
 				}
 			});
 	}
+}
 
-	{
-		std::unique_lock<std::mutex> lock{mutex};
-		while (tasksLeft != 0) {
-			conditionVariable.wait(lock);
+void PopulationRunner::finishStage(CompletionLatch& done) {
+	if (iteration->error) {
+		finishSimulations(done);
+		return;
+	}
+	switch (iteration->stage) {
+	case Stage::prescreen:
+		statistics.prescreenCarSteps = iteration->carSteps.load();
+		selectPrescreenedGenomes();
+		startStage(getFullStage(), done);
+		return;
+	case Stage::racing:
+		pruneRacingGenomes();
+		if (++iteration->racedTracks < trackCount && !genomesToSimulate.empty()) {
+			startStage(Stage::racing, done);
+			return;
 		}
+		break;
+	case Stage::full:
+		break;
+	}
+	finishSimulations(done);
+}
+
+void PopulationRunner::selectPrescreenedGenomes() {
+	std::vector<float> fitnesses(population.size());
+	for (std::size_t i : genomesToSimulate) {
+		fitnesses[i] = getPrescreenFitness(i);
+	}
+	//stable, so the result doesn't depend on the order of the tasks
+	std::stable_sort(genomesToSimulate.begin(), genomesToSimulate.end(),
+			[&fitnesses](std::size_t left, std::size_t right) {
+				return fitnesses[left] > fitnesses[right];
+			});
+
+	const std::size_t passedCount = std::max<std::size_t>(1, std::min(genomesToSimulate.size(),
+			static_cast<std::size_t>(std::ceil(prescreenFraction * genomesToSimulate.size()))));
+	rejectedGenomes.assign(genomesToSimulate.begin() + passedCount, genomesToSimulate.end());
+	genomesToSimulate.resize(passedCount);
+}
+
+float PopulationRunner::getEliteCutoff() const {
+	std::vector<float> fitnesses;
+	for (std::size_t i = 0; i < population.size(); ++i) {
+		if (population.isUnchanged(i)) {
+			fitnesses.push_back(population.getFitness(i));
+		}
+	}
+	const std::size_t eliteCount = population.getEliteCount();
+	if (eliteCount == 0 || fitnesses.size() < eliteCount) {
+		return -std::numeric_limits<float>::infinity();
+	}
+	std::nth_element(fitnesses.begin(), fitnesses.begin() + (eliteCount - 1), fitnesses.end(),
+			std::greater<float>());
+	return fitnesses[eliteCount - 1];
+}
+
+void PopulationRunner::orderRacingTracks() {
+	if (std::find(trackAverageCarSteps.begin(), trackAverageCarSteps.end(), 0.0) !=
+			trackAverageCarSteps.end()) {
+		return;
+	}
+	//Simulating a genome on a track replaces the bound of the track with the
+	//fitness, which is this much lower on average. The tracks without a bound
+	//are first, as nothing can be pruned before them.
+	std::vector<double> scores(trackCount);
+	for (std::size_t j = 0; j < trackCount; ++j) {
+		scores[j] = (trackFitnessBounds[j] - trackAverageFitnesses[j]) / trackAverageCarSteps[j];
+	}
+	//stable, so equal tracks stay in the given order
+	std::iota(trackOrder.begin(), trackOrder.end(), 0);
+	std::stable_sort(trackOrder.begin(), trackOrder.end(),
+			[&scores](std::size_t left, std::size_t right) {
+				return scores[left] > scores[right];
+			});
+}
+
+void PopulationRunner::pruneRacingGenomes() {
+	if (genomesToSimulate.empty()) {
+		return;
+	}
+	const std::size_t racedTracks = iteration->racedTracks + 1;
+	const std::size_t track = trackOrder[racedTracks - 1];
+
+	double fitnessSum = 0.0;
+	for (std::size_t i : genomesToSimulate) {
+		const float fitness = trackFitnesses[i * trackCount + track];
+		racingFitnesses[i] += fitness;
+		fitnessSum += fitness;
+	}
+	trackAverageFitnesses[track] = fitnessSum / genomesToSimulate.size();
+	trackAverageCarSteps[track] = static_cast<double>(
+			iteration->carSteps.load() - iteration->stageStartCarSteps) / genomesToSimulate.size();
+	//the fitness is exact after the last track
+	if (racedTracks == trackCount) {
+		return;
+	}
+
+	float remainingBound = 0.f;
+	double remainingCarSteps = 0.0;
+	for (std::size_t k = racedTracks; k < trackCount; ++k) {
+		remainingBound += trackFitnessBounds[trackOrder[k]];
+		remainingCarSteps += trackAverageCarSteps[trackOrder[k]];
+	}
+	//for the rounding errors of the sums
+	const float threshold = eliteCutoff - std::abs(eliteCutoff) * 1e-3f;
+
+	std::size_t keptCount = 0;
+	for (std::size_t i : genomesToSimulate) {
+		if (racingFitnesses[i] + remainingBound < threshold) {
+			prunedGenomes.push_back(i);
+			//the remaining tracks can lower the fitness if their bound is negative
+			prunedFitnessEstimates.push_back(
+					std::min(racingFitnesses[i], racingFitnesses[i] + remainingBound));
+			statistics.prunedSimulations += trackCount - racedTracks;
+			statistics.prunedCarSteps += static_cast<std::uint64_t>(remainingCarSteps);
+		} else {
+			genomesToSimulate[keptCount++] = i;
+		}
+	}
+	genomesToSimulate.resize(keptCount);
+}
+
+float PopulationRunner::getPrescreenFitness(std::size_t genome) const {
+	float fitness = 0;
+	for (std::size_t j = 0; j < prescreenTrackCount; ++j) {
+		fitness += trackFitnesses[genome * trackCount + j];
+	}
+	return fitness;
+}
+
+void PopulationRunner::finishIteration() {
+	if (iteration->error) {
+		std::rethrow_exception(iteration->error);
+	}
+}
+
+void PopulationRunner::recordError(std::exception_ptr error) {
+	std::lock_guard<std::mutex> lock{iteration->errorMutex};
+	if (!iteration->error) {
+		iteration->error = error;
+	}
+}
+
+void PopulationRunner::finishSimulations(CompletionLatch& done) {
+	typedef std::chrono::duration<double> Seconds;
+	const auto simulationEnd = std::chrono::steady_clock::now();
+	statistics.simulationSeconds = Seconds(simulationEnd - iteration->start).count();
+	statistics.carSteps = iteration->carSteps.load();
+	statistics.networkCalls = iteration->networkCalls.load();
+	statistics.rejectedGenomes = rejectedGenomes.size();
+	statistics.prunedGenomes = prunedGenomes.size();
+	statistics.stalls = iteration->stalls;
+	const std::size_t passedCount = genomesToSimulate.size() + prunedGenomes.size();
+	if (passedCount > 0) {
+		//as if the racing didn't prune any
+		const double fullCarSteps = static_cast<double>(statistics.carSteps -
+				statistics.prescreenCarSteps + statistics.prunedCarSteps) / passedCount;
+		statistics.savedCarSteps = static_cast<std::int64_t>(fullCarSteps * rejectedGenomes.size()) -
+				static_cast<std::int64_t>(statistics.prescreenCarSteps);
+	}
+
+	if (!iteration->error) {
+		trace::Scope scope{"evolve"};
+		try {
+			evolve();
+		} catch (...) {
+			recordError(std::current_exception());
+		}
+	}
+	statistics.evolutionSeconds = Seconds(std::chrono::steady_clock::now() - simulationEnd).count();
+	done.countDown();
+}
+
+void PopulationRunner::evolve() {
+	//summed in the order of the tracks, so the result doesn't depend on the
+	//order the tasks finished
+	for (std::size_t i : genomesToSimulate) {
+		float fitness = 0;
+		for (std::size_t j = 0; j < trackCount; ++j) {
+			fitness += trackFitnesses[i * trackCount + j];
+		}
+		population.setFitness(i, fitness);
+	}
+	//they are simulated again if they are kept
+	for (std::size_t i : rejectedGenomes) {
+		population.setFitnessEstimate(i, getPrescreenFitness(i));
+	}
+	for (std::size_t j = 0; j < prunedGenomes.size(); ++j) {
+		population.setFitnessEstimate(prunedGenomes[j], prunedFitnessEstimates[j]);
+	}
+
+	fitnessCache.clear();
+	for (std::size_t i = 0; i < population.size(); ++i) {
+		if (!population.isUnchanged(i)) {
+			continue;
+		}
+		fitnessCache.insert(population.getWeights(i), population.getWeightCount(), population.getFitness(i));
 	}
 
 	updateBestFitness();
-	population.evolve();
+	population.evolve(scheduler);
 }
 
-void PopulationRunner::runSimulation(Genome& genome, NeuralControllerData& data) {
-	data.network.setWeights(genome.weights);
-	genome.fitness = 0;
+std::size_t PopulationRunner::getTracksPerTask(std::size_t stageTrackCount) const {
+	return std::min(tracksPerTask, stageTrackCount);
+}
 
-	for (auto& manager: data.managers) {
-		manager.setNeuralNetwork(data.network);
-		manager.init();
-		manager.run();
-		genome.fitness += manager.getFitness();
+std::size_t PopulationRunner::getGenomesPerTask(std::size_t stageTrackCount) const {
+	return std::max<std::size_t>(1, carsPerBatch / getTracksPerTask(stageTrackCount));
+}
+
+std::size_t PopulationRunner::getTaskCount(std::size_t genomeCount, std::size_t stageTrackCount) const {
+	const std::size_t genomesPerTask = getGenomesPerTask(stageTrackCount);
+	const std::size_t batchCount = (genomeCount + genomesPerTask - 1) / genomesPerTask;
+	return batchCount * (stageTrackCount / getTracksPerTask(stageTrackCount));
+}
+
+void PopulationRunner::runTask(std::size_t task) {
+	const std::vector<std::size_t>& tracks = iteration->tracks;
+	const std::size_t stageTracksPerTask = getTracksPerTask(tracks.size());
+	const std::size_t genomesPerTask = getGenomesPerTask(tracks.size());
+	const std::size_t trackGroupCount = tracks.size() / stageTracksPerTask;
+	const std::size_t begin = task / trackGroupCount * genomesPerTask;
+	const std::size_t end = std::min(begin + genomesPerTask, genomesToSimulate.size());
+	const std::size_t trackBegin = task % trackGroupCount * stageTracksPerTask;
+	const std::size_t trackEnd = trackBegin + stageTracksPerTask;
+
+	//the cars of a genome are added after each other, so they share a network
+	BatchSimulator& simulator = simulators[task];
+	simulator.clear();
+	for (std::size_t i = begin; i < end; ++i) {
+		for (std::size_t j = trackBegin; j < trackEnd; ++j) {
+			simulator.addCar(population.getWeights(genomesToSimulate[i]), tracks[j]);
+		}
+	}
+	simulator.run(iteration->timeLimit);
+	iteration->carSteps.fetch_add(simulator.getStepCount(), std::memory_order_relaxed);
+	iteration->networkCalls.fetch_add(simulator.getNetworkCallCount(), std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock{iteration->statisticsMutex};
+		iteration->stalls += simulator.getStallCounters();
+	}
+
+	CAR_TIME_PHASE(fitness);
+	std::size_t car = 0;
+	for (std::size_t i = begin; i < end; ++i) {
+		for (std::size_t j = trackBegin; j < trackEnd; ++j) {
+			trackFitnesses[genomesToSimulate[i] * trackCount + tracks[j]] = simulator.getFitness(car++);
+		}
 	}
 }
 
 void PopulationRunner::updateBestFitness() {
 	fitnessSum = 0.f;
-	for (Genome& genome : population.getPopulation()) {
-		fitnessSum += genome.fitness;
-		if (genome.fitness > bestFitness) {
-			bestFitness = genome.fitness;
-			bestGenome = &genome;
+	for (std::size_t i = 0; i < population.size(); ++i) {
+		fitnessSum += population.getFitness(i);
+		if (population.getFitness(i) > bestFitness) {
+			bestFitness = population.getFitness(i);
+			bestGenome = population.getGenome(i);
 		}
 	}
 }
@@ -1,15 +1,22 @@
 #ifndef POPULATIONRUNNER_HPP_
 #define POPULATIONRUNNER_HPP_
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
-#include <boost/asio/io_service.hpp>
 #include "Parameters.hpp"
 #include "GeneticPopulation.hpp"
+#include "FitnessCache.hpp"
 #include "Track/Track.hpp"
-#include "AIGameManager.hpp"
-#include "NeuralNetwork.hpp"
+#include "BatchSimulator.hpp"
+#include "StallDetector.hpp"
+#include "TaskScheduler.hpp"
 
 namespace car {
 
@@ -18,36 +25,172 @@ class Genome;
 class PopulationRunner {
 public:
 	PopulationRunner(const Parameters& parameters,
-		std::vector<std::function<track::Track()>> trackCreators,
-		boost::asio::io_service& ioService);
+		const std::vector<track::TrackPtr>& tracks,
+		TaskScheduler& scheduler,
+		std::uint64_t seed);
 
 	PopulationRunner(const PopulationRunner&) = delete;
 	PopulationRunner& operator=(const PopulationRunner&) = delete;
 	PopulationRunner(PopulationRunner&&) = default;
 	PopulationRunner& operator=(PopulationRunner&&) = default;
 
+	//Posts the simulations of the genomes to the scheduler. The last one to
+	//finish evolves the population, then counts down done. Nothing else may
+	//be called until that.
+	void startIteration(CompletionLatch& done);
+
+	//Called after done was counted down. Rethrows the first exception of
+	//the tasks of the iteration.
+	void finishIteration();
+
+	//startIteration() and finishIteration() for a single population
 	void runIteration();
 
+	//Counters and times of the last iteration
+	struct Statistics {
+		std::size_t simulatedGenomes = 0; //the rest had a known fitness
+		std::uint64_t carSteps = 0; //see BatchSimulator::getStepCount()
+		//of the prescreen, also included in carSteps
+		std::uint64_t prescreenCarSteps = 0;
+		//genomes which got only the fitness of the prescreen
+		std::size_t rejectedGenomes = 0;
+		//The car steps the rejected genomes would have taken, estimated from
+		//the ones simulated fully, minus prescreenCarSteps. Negative if the
+		//prescreen cost more than it saved.
+		std::int64_t savedCarSteps = 0;
+		//genomes dropped by the racing evaluation before the last track
+		std::size_t prunedGenomes = 0;
+		//the simulations of a genome on a track they skipped
+		std::size_t prunedSimulations = 0;
+		//the car steps of those, estimated from the ones simulated
+		std::uint64_t prunedCarSteps = 0;
+		//the cars stopped by the stall policies, of both stages
+		StallCounters stalls;
+		std::uint64_t networkCalls = 0;
+		double simulationSeconds = 0.0; //until the last simulation finished
+		double evolutionSeconds = 0.0;
+	};
+	const Statistics& getStatistics() const { return statistics; }
+
 	float getBestFitness() const { return bestFitness; }
-	float getAverageFitness() const { return fitnessSum / population.getPopulation().size(); }
-	const Genome* getBestGenome() const { return bestGenome; }
+	float getAverageFitness() const { return fitnessSum / population.size(); }
+	//nullptr before the first iteration
+	const Genome* getBestGenome() const { return bestFitness > 0.f ? &bestGenome : nullptr; }
 	const GeneticPopulation& getPopulation() const { return population; }
 	GeneticPopulation& getPopulation() { return population; }
 private:
-	struct NeuralControllerData {
-		NeuralNetwork network;
-		std::vector<AIGameManager> managers;
-	};
+	//The number of cars simulated together by a task. The batches are big
+	//enough to use BatchSimulator well, but there are still enough of them to
+	//keep every thread busy.
+	static const std::size_t carsPerBatch = 16;
 
-	boost::asio::io_service* ioService;
+	TaskScheduler* scheduler;
 
 	GeneticPopulation population;
-	std::vector<NeuralControllerData> controllerDatas;
+
+	//Every task simulates a batch of genomes on tracksPerTask consecutive
+	//tracks of the stage. Batching by track gives 1 track per task, batching
+	//by genome gives every track. The batches have about carsPerBatch cars.
+	std::size_t trackCount;
+	std::size_t tracksPerTask;
+
+	//the simulator of task i
+	std::vector<BatchSimulator> simulators;
+
+	//see Parameters::prescreenSeconds
+	float prescreenSeconds;
+	std::size_t prescreenTrackCount;
+	float prescreenFraction;
+
+	//see Parameters::racing
+	bool racing;
+	//see getFitnessUpperBound()
+	std::vector<float> trackFitnessBounds;
+	//The order of the racing stages: the most fitness bound ruled out per
+	//car step first. It's the order of the tracks until every track was
+	//raced once.
+	std::vector<std::size_t> trackOrder;
+	//the averages of the genomes in the last racing stage of each track,
+	//0 steps if it wasn't raced yet
+	std::vector<double> trackAverageFitnesses;
+	std::vector<double> trackAverageCarSteps;
+	//The fitness a genome has to be able to reach to be kept by evolve(),
+	//-infinity if too few genomes have an exact fitness.
+	float eliteCutoff = 0.f;
+	//the sum of the fitnesses on the tracks raced so far
+	std::vector<float> racingFitnesses;
+	//the genomes dropped by the racing stages
+	std::vector<std::size_t> prunedGenomes;
+	//the fitness estimates of prunedGenomes
+	std::vector<float> prunedFitnessEstimates;
+
+	//fitness of genome i on track j is at [i * trackCount + j]
+	std::vector<float> trackFitnesses;
+
+	//genomes of the last generation
+	FitnessCache fitnessCache;
+	std::vector<std::size_t> genomesToSimulate;
+	//the genomes which didn't pass the prescreen
+	std::vector<std::size_t> rejectedGenomes;
+
 	float fitnessSum = 0.f; // Updated by updateBestFitness
 	float bestFitness = 0.f; // Updated by updateBestFitness
-	const Genome* bestGenome = nullptr;
+	Genome bestGenome; // Updated by updateBestFitness, copied because evolve() replaces the genomes
+
+	enum class Stage {
+		prescreen, //see Parameters::prescreenSeconds
+		full, //every track
+		racing //the track trackOrder[racedTracks], see Parameters::racing
+	};
+
+	//State of the running iteration. It's on the heap, so the runner can be
+	//moved between iterations.
+	struct Iteration {
+		//the tasks simulate the genomesToSimulate on the tracks for at most
+		//timeLimit seconds
+		Stage stage = Stage::full;
+		std::vector<std::size_t> tracks;
+		float timeLimit = BatchSimulator::maxTime;
+		std::size_t racedTracks = 0;
+		std::uint64_t stageStartCarSteps = 0;
+
+		std::atomic<std::size_t> remainingTasks{0};
+		std::atomic<std::uint64_t> carSteps{0};
+		std::atomic<std::uint64_t> networkCalls{0};
+		StallCounters stalls; //guarded by statisticsMutex
+		std::mutex statisticsMutex;
+		std::chrono::steady_clock::time_point start;
+		std::mutex errorMutex;
+		std::exception_ptr error;
+	};
+	std::unique_ptr<Iteration> iteration{new Iteration};
+	Statistics statistics;
 
-	void runSimulation(Genome& genome, NeuralControllerData& data);
+	std::size_t getTracksPerTask(std::size_t stageTrackCount) const;
+	std::size_t getGenomesPerTask(std::size_t stageTrackCount) const;
+	std::size_t getTaskCount(std::size_t genomeCount, std::size_t stageTrackCount) const;
+	//Posts the tasks of a stage of the simulation, the last one calls
+	//finishStage().
+	void startStage(Stage stage, CompletionLatch& done);
+	void finishStage(CompletionLatch& done);
+	//Keeps the best genomes of the prescreen in genomesToSimulate, and moves
+	//the rest to rejectedGenomes.
+	void selectPrescreenedGenomes();
+	//racing if it's on and eliteCutoff is known
+	Stage getFullStage() const;
+	//the bestTopN-th best exact fitness of the population, see eliteCutoff
+	float getEliteCutoff() const;
+	//Sorts trackOrder by the averages of the last racing stages.
+	void orderRacingTracks();
+	//Adds the fitnesses of the raced track to racingFitnesses, and moves the
+	//genomes which can't reach eliteCutoff to prunedGenomes.
+	void pruneRacingGenomes();
+	//the sum of the fitnesses on the tracks of the prescreen
+	float getPrescreenFitness(std::size_t genome) const;
+	void runTask(std::size_t task);
+	void recordError(std::exception_ptr error);
+	void finishSimulations(CompletionLatch& done);
+	void evolve();
 	void updateBestFitness();
 };
 
@@ -0,0 +1,71 @@
+#ifndef RANDOMENGINE_HPP
+#define RANDOMENGINE_HPP
+
+#include <cstdint>
+#include <limits>
+
+namespace car {
+
+//xoshiro256** generator (http://prng.di.unimi.it/). It is fast, has no
+//shared state, and can be used with the standard distributions.
+//
+//Independent streams are created from the same seed by giving them
+//different stream ids, so every task can have its own generator and the
+//results don't depend on which thread runs it.
+class RandomEngine {
+public:
+	typedef std::uint64_t result_type;
+
+	explicit RandomEngine(std::uint64_t seed = 0) {
+		for (std::uint64_t& word : state) {
+			word = splitMix64(seed);
+		}
+	}
+
+	RandomEngine(std::uint64_t seed, std::uint64_t streamId):
+		RandomEngine(mixSeed(seed, streamId))
+	{}
+
+	//The seed of a stream, which can be used as the seed of further streams.
+	static std::uint64_t mixSeed(std::uint64_t seed, std::uint64_t streamId) {
+		//different stream ids of the same seed always give different seeds
+		std::uint64_t x = splitMix64(seed) ^ streamId;
+		return splitMix64(x);
+	}
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+	result_type operator()() {
+		const std::uint64_t result = rotateLeft(state[1] * 5, 7) * 9;
+		const std::uint64_t t = state[1] << 17;
+
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotateLeft(state[3], 45);
+
+		return result;
+	}
+
+private:
+	static std::uint64_t rotateLeft(std::uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+
+	//advances x and returns the next output of SplitMix64
+	static std::uint64_t splitMix64(std::uint64_t& x) {
+		std::uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	std::uint64_t state[4];
+};
+
+}
+
+#endif /* !RANDOMENGINE_HPP */
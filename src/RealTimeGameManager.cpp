@@ -15,14 +15,16 @@
 
 namespace car {
 
-RealTimeGameManager::RealTimeGameManager(const Parameters& parameters, std::function<track::Track()> trackCreator,
+RealTimeGameManager::RealTimeGameManager(const Parameters& parameters, track::TrackPtr track,
 			bool startWithAi) :
-	GameManager(parameters, trackCreator),
+	GameManager(parameters, std::move(track)),
 	window(sf::VideoMode(parameters.screenWidth, parameters.screenHeight), "car-game")
 {
 	using namespace boost::math::float_constants;
 
 	isAIControl = startWithAi;
+	RandomEngine engine{parameters.seed};
+	neuralNetwork.randomizeWeights(engine);
 	font.loadFromFile(parameters.projectRootPath + "/resources/DejaVuSansMono.ttf");
 	gasTelemetry.setAutomaticBoundsDetection(false);
 	gasTelemetry.setBounds(0.f, 1.f);
@@ -34,7 +36,7 @@ RealTimeGameManager::RealTimeGameManager(const Parameters& parameters, std::func
 	turnTelemetry.setBounds(-1.f, 1.f);
 
 	const float minPixelPerMeter = 10;
-	sf::FloatRect staticViewRect = resizeToEnclose(track.getDimensions(), static_cast<float>(parameters.screenWidth)/parameters.screenHeight);
+	sf::FloatRect staticViewRect = resizeToEnclose(track->getDimensions(), static_cast<float>(parameters.screenWidth)/parameters.screenHeight);
 
 	if (parameters.panMode == PanMode::enabled ||
 		(parameters.panMode == PanMode::automatic && parameters.screenWidth / staticViewRect.width > minPixelPerMeter))
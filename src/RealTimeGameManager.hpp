@@ -10,13 +10,9 @@
 
 namespace car {
 
-namespace track {
-	class Track;
-}
-
 class RealTimeGameManager : public GameManager {
 public:
-	RealTimeGameManager(const Parameters& parameter, std::function<track::Track()> trackCreator,
+	RealTimeGameManager(const Parameters& parameter, track::TrackPtr track,
 			bool startWithAi);
 
 	void run();
@@ -0,0 +1,114 @@
+#include "Selector.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+#include "randomUtil.hpp"
+
+namespace car {
+
+Selector::Selector(SelectionMethod method, unsigned tournamentSize) :
+		method(method), tournamentSize(tournamentSize) {
+	assert(tournamentSize > 0);
+}
+
+void Selector::prepare(const std::vector<float>& fitnesses) {
+	assert(!fitnesses.empty());
+	this->fitnesses = &fitnesses;
+
+	switch (method) {
+	case SelectionMethod::roulette:
+		weights.resize(fitnesses.size());
+		for (std::size_t i = 0; i < fitnesses.size(); ++i) {
+			weights[i] = std::max(fitnesses[i], 0.f);
+		}
+		buildAliasTable();
+		break;
+	case SelectionMethod::rank:
+		//the worst has weight 1, the best has weight n
+		sortedIndices.resize(fitnesses.size());
+		std::iota(sortedIndices.begin(), sortedIndices.end(), 0);
+		std::sort(sortedIndices.begin(), sortedIndices.end(),
+				[&fitnesses](std::uint32_t left, std::uint32_t right) {
+					return fitnesses[left] < fitnesses[right];
+				});
+		weights.resize(fitnesses.size());
+		for (std::size_t i = 0; i < sortedIndices.size(); ++i) {
+			weights[sortedIndices[i]] = static_cast<double>(i + 1);
+		}
+		buildAliasTable();
+		break;
+	case SelectionMethod::tournament:
+		break;
+	}
+}
+
+std::size_t Selector::pick(RandomEngine& engine) const {
+	assert(fitnesses != nullptr);
+	const int last = static_cast<int>(fitnesses->size()) - 1;
+
+	if (method == SelectionMethod::tournament) {
+		std::size_t best = randomInt(engine, 0, last);
+		for (unsigned i = 1; i < tournamentSize; ++i) {
+			const std::size_t index = randomInt(engine, 0, last);
+			if ((*fitnesses)[index] > (*fitnesses)[best]) {
+				best = index;
+			}
+		}
+		return best;
+	}
+
+	const std::size_t bucket = randomInt(engine, 0, last);
+	return randomReal(engine, 0, 1) < probabilities[bucket] ? bucket : aliases[bucket];
+}
+
+void Selector::buildAliasTable() {
+	const std::size_t size = weights.size();
+	probabilities.resize(size);
+	aliases.resize(size);
+
+	const double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+	if (total <= 0.0) {
+		//every one is equally likely
+		std::fill(probabilities.begin(), probabilities.end(), 1.f);
+		std::iota(aliases.begin(), aliases.end(), 0);
+		return;
+	}
+
+	//scaled so the average is 1
+	std::vector<double>& scaled = weights;
+	smallBuckets.clear();
+	largeBuckets.clear();
+	for (std::size_t i = 0; i < size; ++i) {
+		scaled[i] *= size / total;
+		(scaled[i] < 1.0 ? smallBuckets : largeBuckets).push_back(i);
+	}
+
+	//every small bucket is filled up to 1 by a large one
+	while (!smallBuckets.empty() && !largeBuckets.empty()) {
+		const std::uint32_t small = smallBuckets.back();
+		smallBuckets.pop_back();
+		const std::uint32_t large = largeBuckets.back();
+
+		probabilities[small] = static_cast<float>(scaled[small]);
+		aliases[small] = large;
+		scaled[large] -= 1.0 - scaled[small];
+		if (scaled[large] < 1.0) {
+			largeBuckets.pop_back();
+			smallBuckets.push_back(large);
+		}
+	}
+
+	//the rest are 1 apart from rounding errors
+	for (std::uint32_t i : smallBuckets) {
+		probabilities[i] = 1.f;
+		aliases[i] = i;
+	}
+	for (std::uint32_t i : largeBuckets) {
+		probabilities[i] = 1.f;
+		aliases[i] = i;
+	}
+}
+
+}
@@ -0,0 +1,55 @@
+#ifndef SELECTOR_HPP
+#define SELECTOR_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "RandomEngine.hpp"
+
+namespace car {
+
+enum class SelectionMethod {
+	roulette, //proportional to the fitness
+	tournament, //the best of a few random genomes
+	rank //proportional to the rank of the fitness
+};
+
+//Picks the parents of the children from the fitness values of a
+//generation. prepare() builds the tables once per generation, then every
+//pick() takes constant time, and can be called from several threads with
+//their own engines.
+class Selector {
+public:
+	explicit Selector(SelectionMethod method = SelectionMethod::roulette,
+			unsigned tournamentSize = 3);
+
+	//fitnesses have to stay alive and unchanged while picking. Negative
+	//fitness is treated as 0 for roulette selection.
+	void prepare(const std::vector<float>& fitnesses);
+
+	//the index of the picked fitness
+	std::size_t pick(RandomEngine& engine) const;
+
+private:
+	//Walker's alias method: a random bucket is picked, then either the
+	//bucket itself or its alias, so any distribution is sampled in O(1).
+	//The table is built from weights, which are overwritten.
+	void buildAliasTable();
+
+	SelectionMethod method;
+	unsigned tournamentSize;
+	const std::vector<float>* fitnesses = nullptr;
+
+	std::vector<float> probabilities; //of picking the bucket itself
+	std::vector<std::uint32_t> aliases;
+
+	//buffers of prepare()
+	std::vector<double> weights;
+	std::vector<std::uint32_t> sortedIndices;
+	std::vector<std::uint32_t> smallBuckets;
+	std::vector<std::uint32_t> largeBuckets;
+};
+
+}
+
+#endif /* !SELECTOR_HPP */
@@ -0,0 +1,85 @@
+#include "StallDetector.hpp"
+
+#include "Line2.hpp"
+#include "mathUtil.hpp"
+
+namespace car {
+
+const char* getStallPolicyName(StallPolicy policy) {
+	switch (policy) {
+	case StallPolicy::noCheckpoint: return "noCheckpoint";
+	case StallPolicy::slow: return "slow";
+	case StallPolicy::noApproach: return "noApproach";
+	default: return "none";
+	}
+}
+
+bool StallLimits::isEnabled() const {
+	return noCheckpointSeconds > 0.f || slowSeconds > 0.f || noApproachSeconds > 0.f;
+}
+
+StallLimits getStallLimits(const Parameters& parameters) {
+	StallLimits limits;
+	limits.noCheckpointSeconds = parameters.stallCheckpointSeconds;
+	limits.slowSpeed = parameters.stallSpeed;
+	limits.slowSeconds = parameters.stallSpeedSeconds;
+	limits.noApproachSeconds = parameters.stallApproachSeconds;
+	return limits;
+}
+
+void StallCounters::add(StallPolicy policy, std::uint64_t steps) {
+	const std::size_t i = static_cast<std::size_t>(policy);
+	++stoppedCars[i];
+	savedSteps[i] += steps;
+}
+
+StallCounters& StallCounters::operator+=(const StallCounters& other) {
+	for (std::size_t i = 0; i < stallPolicyCount; ++i) {
+		stoppedCars[i] += other.stoppedCars[i];
+		savedSteps[i] += other.savedSteps[i];
+	}
+	return *this;
+}
+
+void StallDetector::reset() {
+	*this = StallDetector{};
+}
+
+StallPolicy StallDetector::update(const StallLimits& limits, float currentTime, float speed,
+		unsigned crossedCheckpoints, const track::Track& track, int currentCheckpoint,
+		const sf::Vector2f& position) {
+	if (crossedCheckpoints != this->crossedCheckpoints) {
+		this->crossedCheckpoints = crossedCheckpoints;
+		lastCheckpointTime = currentTime;
+	}
+	if (limits.noCheckpointSeconds > 0.f && currentTime - lastCheckpointTime > limits.noCheckpointSeconds) {
+		return StallPolicy::noCheckpoint;
+	}
+
+	if (speed >= limits.slowSpeed) {
+		isSlow = false;
+	} else if (!isSlow) {
+		isSlow = true;
+		slowSince = currentTime;
+	}
+	if (limits.slowSeconds > 0.f && isSlow && currentTime - slowSince > limits.slowSeconds) {
+		return StallPolicy::slow;
+	}
+
+	//the next checkpoint is known only after the first one was crossed
+	if (limits.noApproachSeconds > 0.f && currentCheckpoint >= 0) {
+		const float distance = getDistance(position,
+				nearestPoint(position, track.getCheckpoint(currentCheckpoint)));
+		if (currentCheckpoint != approachedCheckpoint || distance < closestDistance) {
+			approachedCheckpoint = currentCheckpoint;
+			closestDistance = distance;
+			closestDistanceTime = currentTime;
+		}
+		if (currentTime - closestDistanceTime > limits.noApproachSeconds) {
+			return StallPolicy::noApproach;
+		}
+	}
+	return StallPolicy::none;
+}
+
+}
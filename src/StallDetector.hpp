@@ -0,0 +1,75 @@
+#ifndef STALLDETECTOR_HPP
+#define STALLDETECTOR_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "Parameters.hpp"
+#include "Track/Track.hpp"
+
+namespace car {
+
+//Policies which stop the simulation of a car which didn't crash, but makes
+//no progress, so it doesn't use up the whole time limit.
+enum class StallPolicy {
+	noCheckpoint, //no new checkpoint for a while
+	slow, //slower than a limit for a while
+	noApproach, //not closer to the next checkpoint for a while
+	none
+};
+
+const std::size_t stallPolicyCount = 3;
+
+const char* getStallPolicyName(StallPolicy policy);
+
+//The limits of the policies in seconds of simulated time, from
+//Parameters. 0 turns a policy off.
+struct StallLimits {
+	float noCheckpointSeconds = 0.f;
+	float slowSpeed = 0.f;
+	float slowSeconds = 0.f;
+	float noApproachSeconds = 0.f;
+
+	bool isEnabled() const;
+};
+
+StallLimits getStallLimits(const Parameters& parameters);
+
+//The number of cars stopped by each policy, and the car steps they would
+//have taken until the time limit. That's an upper bound of the steps
+//saved, as some of them would have crashed earlier.
+struct StallCounters {
+	std::array<std::uint64_t, stallPolicyCount> stoppedCars{};
+	std::array<std::uint64_t, stallPolicyCount> savedSteps{};
+
+	void add(StallPolicy policy, std::uint64_t steps);
+	StallCounters& operator+=(const StallCounters& other);
+};
+
+//The progress of a car. AIGameManager and BatchSimulator call update()
+//after every step the car didn't crash in.
+class StallDetector {
+public:
+	void reset();
+
+	//Returns the first policy which stops the car, or StallPolicy::none.
+	//The distance is only calculated if the noApproach policy is on.
+	StallPolicy update(const StallLimits& limits, float currentTime, float speed,
+			unsigned crossedCheckpoints, const track::Track& track, int currentCheckpoint,
+			const sf::Vector2f& position);
+
+private:
+	unsigned crossedCheckpoints = 0;
+	float lastCheckpointTime = 0.f;
+
+	bool isSlow = false;
+	float slowSince = 0.f;
+
+	int approachedCheckpoint = -1;
+	float closestDistance = 0.f;
+	float closestDistanceTime = 0.f;
+};
+
+}
+
+#endif /* !STALLDETECTOR_HPP */
@@ -0,0 +1,173 @@
+#include "SteadyStateRunner.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include "Genome.hpp"
+#include "Instrumentation.hpp"
+
+namespace car {
+
+SteadyStateRunner::SteadyStateRunner(const Parameters& parameters,
+		const std::vector<track::TrackPtr>& tracks,
+		TaskScheduler& scheduler,
+		std::uint64_t seed):
+			scheduler(&scheduler),
+			trackCount(tracks.size()),
+			population{parameters.populationSize,
+				NeuralNetwork::getWeightCountForNetwork(
+					parameters.hiddenLayerCount, parameters.neuronPerHiddenLayer,
+					parameters.getInputNeuronCount(), parameters.outputNeuronCount, parameters.useRecurrence),
+				seed}
+{
+	//Enough simulations to keep every thread busy, but at most half of the
+	//population, so there are always parents with known fitness.
+	const std::size_t slotCount = std::max<std::size_t>(1, std::min<std::size_t>(
+			2 * std::max<std::size_t>(1, scheduler.getNumThreads()), parameters.populationSize / 2));
+	slots.reserve(slotCount);
+	for (std::size_t i = 0; i < slotCount; ++i) {
+		slots.push_back(Slot{BatchSimulator{parameters, tracks}, Genome{}, noIndex});
+	}
+}
+
+SteadyStateRunner::~SteadyStateRunner() {
+	stop();
+}
+
+void SteadyStateRunner::start() {
+	std::lock_guard<std::mutex> lock{mutex};
+	for (std::size_t i = 0; i < slots.size(); ++i) {
+		if (!takeNextGenome(slots[i])) {
+			break;
+		}
+		++runningSlots;
+		scheduler->post([this, i] { runSlot(i); });
+	}
+}
+
+void SteadyStateRunner::waitForEvaluations(std::size_t count) {
+	std::unique_lock<std::mutex> lock{mutex};
+	reportedEvaluations += count;
+	waitUntil(reportedEvaluations, lock);
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+Genomes SteadyStateRunner::getGenomes() const {
+	std::lock_guard<std::mutex> lock{mutex};
+	return population.getGenomes();
+}
+
+void SteadyStateRunner::stop() {
+	std::unique_lock<std::mutex> lock{mutex};
+	stopping = true;
+	waitUntil(noIndex, lock);
+}
+
+void SteadyStateRunner::runSlot(std::size_t slotIndex) {
+	Slot& slot = slots[slotIndex];
+	float fitness = 0.f;
+	std::exception_ptr simulationError;
+	try {
+		fitness = simulate(slot);
+	} catch (...) {
+		simulationError = std::current_exception();
+	}
+
+	std::lock_guard<std::mutex> lock{mutex};
+	if (simulationError) {
+		if (!error) {
+			error = simulationError;
+		}
+		stopping = true;
+	} else {
+		insertGenome(slot, fitness);
+	}
+
+	if (takeNextGenome(slot)) {
+		scheduler->post([this, slotIndex] { runSlot(slotIndex); });
+	} else {
+		--runningSlots;
+	}
+	notifyWaiting();
+}
+
+float SteadyStateRunner::simulate(Slot& slot) {
+	//a car on every track, which share the network
+	slot.simulator.clear();
+	for (std::size_t j = 0; j < trackCount; ++j) {
+		slot.simulator.addCar(slot.genome.weights.data(), j);
+	}
+	slot.simulator.run();
+
+	//summed in the order of the tracks, like PopulationRunner does
+	CAR_TIME_PHASE(fitness);
+	float fitness = 0;
+	for (std::size_t j = 0; j < trackCount; ++j) {
+		fitness += slot.simulator.getFitness(j);
+	}
+	return fitness;
+}
+
+bool SteadyStateRunner::takeNextGenome(Slot& slot) {
+	while (!stopping) {
+		if (nextStartingGenome < population.size()) {
+			const std::size_t index = nextStartingGenome++;
+			//evaluated before, e.g. restored from a checkpoint
+			if (population.isUnchanged(index)) {
+				continue;
+			}
+			//replaceWorst() only replaces unchanged genomes, so this one
+			//stays at index until its fitness is inserted
+			population.setFitnessEstimate(index, population.getFitness(index));
+			slot.startingIndex = index;
+			slot.genome = population.getGenome(index);
+			return true;
+		}
+
+		slot.genome = population.breedChild(childCount++);
+		slot.startingIndex = noIndex;
+		if (!slot.genome.unchanged) {
+			return true;
+		}
+		//a copy of a parent doesn't have to be simulated
+		population.replaceWorst(slot.genome);
+		++evaluationCount;
+	}
+	return false;
+}
+
+void SteadyStateRunner::insertGenome(Slot& slot, float fitness) {
+	if (slot.startingIndex != noIndex) {
+		assert(!population.isUnchanged(slot.startingIndex));
+		population.setFitness(slot.startingIndex, fitness);
+	} else {
+		slot.genome.fitness = fitness;
+		population.replaceWorst(slot.genome);
+	}
+	++evaluationCount;
+}
+
+void SteadyStateRunner::waitUntil(std::size_t evaluations, std::unique_lock<std::mutex>& lock) {
+	//the waiting thread runs tasks too, so it works even without worker threads
+	CompletionLatch latch{1};
+	waitingLatch = &latch;
+	waitTarget = evaluations;
+	notifyWaiting();
+
+	lock.unlock();
+	scheduler->wait(latch);
+	lock.lock();
+}
+
+void SteadyStateRunner::notifyWaiting() {
+	//stop() waits for the running simulations even after an error
+	const bool waitingForEvaluations = waitTarget != noIndex;
+	if (waitingLatch != nullptr && (runningSlots == 0 ||
+			(waitingForEvaluations && (evaluationCount >= waitTarget || error)))) {
+		waitingLatch->countDown();
+		waitingLatch = nullptr;
+	}
+}
+
+} /* namespace car */
@@ -0,0 +1,93 @@
+#ifndef STEADYSTATERUNNER_HPP_
+#define STEADYSTATERUNNER_HPP_
+
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include "Parameters.hpp"
+#include "GeneticPopulation.hpp"
+#include "Track/Track.hpp"
+#include "BatchSimulator.hpp"
+#include "TaskScheduler.hpp"
+
+namespace car {
+
+//Evolves a population without generations. A few genomes are simulated at
+//the same time, each in its own task. When one finishes, it's inserted into
+//the population, and a new child is bred and posted right away, so no
+//thread waits for the slowest simulation of a generation.
+//
+//The first genomes simulated are the ones of the starting population which
+//don't have a fitness yet.
+//
+//The order the simulations finish depends on the threads, so unlike
+//PopulationRunner, the results are not reproducible with more threads.
+class SteadyStateRunner: public boost::noncopyable {
+public:
+	SteadyStateRunner(const Parameters& parameters,
+		const std::vector<track::TrackPtr>& tracks,
+		TaskScheduler& scheduler,
+		std::uint64_t seed);
+	~SteadyStateRunner();
+
+	//Can only be used before start().
+	GeneticPopulation& getPopulation() { return population; }
+
+	void start();
+
+	//Blocks until count more genomes were evaluated since the last call.
+	//Rethrows the exception of a simulation if there was one.
+	void waitForEvaluations(std::size_t count);
+
+	//A copy of the current population. Can be called while running.
+	Genomes getGenomes() const;
+
+	//Stops breeding children and waits for the running simulations.
+	void stop();
+
+private:
+	static const std::size_t noIndex = static_cast<std::size_t>(-1);
+
+	struct Slot {
+		BatchSimulator simulator;
+		Genome genome;
+		//index of the genome in the starting population, or noIndex for a child
+		std::size_t startingIndex;
+	};
+
+	void runSlot(std::size_t slotIndex);
+	float simulate(Slot& slot);
+
+	//The functions below are called with mutex locked.
+
+	//returns false if no more genomes should be simulated
+	bool takeNextGenome(Slot& slot);
+	void insertGenome(Slot& slot, float fitness);
+	void waitUntil(std::size_t evaluations, std::unique_lock<std::mutex>& lock);
+	void notifyWaiting();
+
+	TaskScheduler* scheduler;
+	std::size_t trackCount;
+
+	mutable std::mutex mutex;
+	GeneticPopulation population;
+	std::vector<Slot> slots;
+	std::size_t runningSlots = 0;
+	std::size_t nextStartingGenome = 0;
+	std::uint64_t childCount = 0;
+	std::size_t evaluationCount = 0;
+	std::size_t reportedEvaluations = 0; //the target of the last waitForEvaluations()
+	bool stopping = false;
+	std::exception_ptr error;
+
+	//counted down when evaluationCount reaches waitTarget, a simulation
+	//failed or nothing runs anymore
+	CompletionLatch* waitingLatch = nullptr;
+	std::size_t waitTarget = 0;
+};
+
+} /* namespace car */
+
+#endif /* STEADYSTATERUNNER_HPP_ */
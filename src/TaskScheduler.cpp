@@ -0,0 +1,180 @@
+#include "TaskScheduler.hpp"
+
+#include <iostream>
+#include <string>
+#include <boost/exception/all.hpp>
+#include "Trace.hpp"
+
+namespace car {
+
+namespace {
+
+thread_local const TaskScheduler* currentScheduler = nullptr;
+thread_local std::size_t currentQueueIndex = 0;
+
+//number of unsuccessful searches for a task before a worker goes to sleep
+const int spinCount = 64;
+
+}
+
+TaskScheduler::TaskScheduler(std::size_t numThreads) {
+	const std::size_t numQueues = numThreads > 0 ? numThreads : 1;
+	queues.reserve(numQueues);
+	for (std::size_t i = 0; i < numQueues; ++i) {
+		queues.emplace_back(new Queue);
+	}
+
+	threads.reserve(numThreads);
+	for (std::size_t i = 0; i < numThreads; ++i) {
+		threads.emplace_back([this, i]() { runWorker(i); });
+	}
+}
+
+TaskScheduler::~TaskScheduler() {
+	{
+		std::lock_guard<std::mutex> lock{sleepMutex};
+		stopping = true;
+	}
+	sleepConditionVariable.notify_all();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+std::size_t TaskScheduler::getCurrentQueueIndex() const {
+	return currentScheduler == this ? currentQueueIndex : queues.size();
+}
+
+void TaskScheduler::post(Task task) {
+	std::size_t index = getCurrentQueueIndex();
+	if (index == queues.size()) {
+		index = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+	}
+
+	//counted before it's pushed, so the counter never goes below zero
+	queuedTasks.fetch_add(1);
+	{
+		Queue& queue = *queues[index];
+		std::lock_guard<std::mutex> lock{queue.mutex};
+		queue.tasks.push_back(std::move(task));
+	}
+
+	//Workers increase sleepingWorkers before checking queuedTasks, so either
+	//they see the new task or we see them sleeping.
+	if (sleepingWorkers.load() > 0) {
+		std::lock_guard<std::mutex> lock{sleepMutex};
+		sleepConditionVariable.notify_one();
+	}
+	//the same for the threads in wait()
+	if (sleepingWaiters.load() > 0) {
+		notifyWaitingThreads();
+	}
+}
+
+void TaskScheduler::notifyWaitingThreads() {
+	std::lock_guard<std::mutex> lock{sleepMutex};
+	waitConditionVariable.notify_all();
+}
+
+void TaskScheduler::wait(CompletionLatch& latch) {
+	{
+		//the last countDown() wakes us up from then on
+		std::lock_guard<std::mutex> lock{latch.mutex};
+		latch.waitingScheduler = this;
+	}
+
+	std::size_t index = getCurrentQueueIndex();
+	while (!latch.isDone()) {
+		if (tryRunTask(index == queues.size() ? 0 : index)) {
+			continue;
+		}
+		trace::Scope scope{"barrier wait"};
+		++sleepingWaiters;
+		{
+			std::unique_lock<std::mutex> lock{sleepMutex};
+			waitConditionVariable.wait(lock, [this, &latch] {
+					return latch.isDone() || queuedTasks.load() > 0;
+				});
+		}
+		--sleepingWaiters;
+	}
+	//the last countDown() may still hold the mutex of the latch
+	latch.wait();
+}
+
+bool TaskScheduler::tryPop(Queue& queue, bool fromBack, Task& task) {
+	std::lock_guard<std::mutex> lock{queue.mutex};
+	if (queue.tasks.empty()) {
+		return false;
+	}
+	if (fromBack) {
+		task = std::move(queue.tasks.back());
+		queue.tasks.pop_back();
+	} else {
+		task = std::move(queue.tasks.front());
+		queue.tasks.pop_front();
+	}
+	return true;
+}
+
+bool TaskScheduler::tryRunTask(std::size_t index) {
+	if (queuedTasks.load(std::memory_order_relaxed) == 0) {
+		return false;
+	}
+
+	Task task;
+	bool found = tryPop(*queues[index], getCurrentQueueIndex() == index, task);
+	for (std::size_t i = 1; !found && i < queues.size(); ++i) {
+		found = tryPop(*queues[(index + i) % queues.size()], false, task);
+	}
+	if (!found) {
+		return false;
+	}
+
+	queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+	trace::Scope scope{"task"};
+	task();
+	return true;
+}
+
+void TaskScheduler::runWorker(std::size_t index) {
+	currentScheduler = this;
+	currentQueueIndex = index;
+	trace::setThreadName("worker " + std::to_string(index));
+
+	int failedSearches = 0;
+	while (true) {
+		bool ranTask = false;
+		try {
+			ranTask = tryRunTask(index);
+		} catch (std::exception& e) {
+			std::cerr << boost::diagnostic_information(e) << std::endl;
+			ranTask = true;
+		}
+
+		if (ranTask) {
+			failedSearches = 0;
+			continue;
+		}
+		if (++failedSearches < spinCount) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		failedSearches = 0;
+		++sleepingWorkers;
+		{
+			std::unique_lock<std::mutex> lock{sleepMutex};
+			sleepConditionVariable.wait(lock, [this] {
+					return stopping || queuedTasks.load() > 0;
+				});
+			if (stopping && queuedTasks.load() == 0) {
+				--sleepingWorkers;
+				return;
+			}
+		}
+		--sleepingWorkers;
+	}
+}
+
+}
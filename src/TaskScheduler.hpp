@@ -0,0 +1,172 @@
+#ifndef TASKSCHEDULER_HPP_
+#define TASKSCHEDULER_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace car {
+
+class TaskScheduler;
+
+//Counts down the number of unfinished tasks. Counting down doesn't take a
+//lock, only the last one does to wake up the waiting threads.
+//
+//The latch is usually on the stack of the waiting thread, which destroys it
+//as soon as wait() returns. So the last count down and the notification are
+//done with the mutex locked, and wait() only returns after it locked the
+//mutex and saw the latch done: after that, countDown() doesn't touch the
+//latch anymore. isDone() alone doesn't guarantee that.
+//
+//The last count down also wakes up the threads waiting in
+//TaskScheduler::wait() for it.
+class CompletionLatch: public boost::noncopyable {
+public:
+	explicit CompletionLatch(std::size_t count = 0): remaining(count) {}
+
+	void add(std::size_t count) {
+		remaining.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	void countDown();
+
+	bool isDone() const {
+		return remaining.load(std::memory_order_acquire) == 0;
+	}
+
+	void wait() {
+		std::unique_lock<std::mutex> lock{mutex};
+		conditionVariable.wait(lock, [this] { return isDone(); });
+	}
+
+private:
+	friend class TaskScheduler;
+
+	std::atomic<std::size_t> remaining;
+	std::mutex mutex;
+	std::condition_variable conditionVariable;
+	TaskScheduler* waitingScheduler = nullptr; //guarded by mutex
+};
+
+//Work stealing thread pool. Every worker thread has its own task queue:
+//tasks posted from a worker go to its own queue, which it processes from
+//the back (the most recent task first), while idle workers steal from the
+//front of the other queues. Tasks posted from other threads are distributed
+//between the queues.
+class TaskScheduler: public boost::noncopyable {
+public:
+	typedef std::function<void()> Task;
+
+	//With 0 threads, tasks are only run by threads waiting in wait().
+	explicit TaskScheduler(std::size_t numThreads);
+	~TaskScheduler();
+
+	std::size_t getNumThreads() const { return threads.size(); }
+
+	void post(Task task);
+
+	//Runs queued tasks until latch is done. When there are none, it sleeps
+	//until a task is posted or the latch is done. The latch can be destroyed
+	//after it returned.
+	void wait(CompletionLatch& latch);
+
+	//Calls function(i) for each i in [begin, end) as separate tasks and waits
+	//for them. If any of them throws, the first exception is rethrown after
+	//all of them finished.
+	template<typename Function>
+	void parallelFor(std::size_t begin, std::size_t end, Function function);
+
+private:
+	friend class CompletionLatch;
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void runWorker(std::size_t index);
+
+	//Tries the queue at index first, then the others. Returns false if all
+	//of them were empty.
+	bool tryRunTask(std::size_t index);
+	bool tryPop(Queue& queue, bool fromBack, Task& task);
+
+	//wakes up the threads sleeping in wait()
+	void notifyWaitingThreads();
+
+	//index of the current thread's queue, or queues.size() if the current
+	//thread is not a worker of this scheduler
+	std::size_t getCurrentQueueIndex() const;
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> threads;
+
+	std::atomic<std::size_t> nextQueue{0};
+	std::atomic<std::size_t> queuedTasks{0};
+
+	std::atomic<std::size_t> sleepingWorkers{0};
+	std::mutex sleepMutex;
+	std::condition_variable sleepConditionVariable;
+	bool stopping = false; //guarded by sleepMutex
+
+	//threads in wait() sleep on this, with sleepMutex
+	std::atomic<std::size_t> sleepingWaiters{0};
+	std::condition_variable waitConditionVariable;
+};
+
+inline void CompletionLatch::countDown() {
+	std::size_t count = remaining.load(std::memory_order_relaxed);
+	while (count > 1) {
+		if (remaining.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel)) {
+			return;
+		}
+	}
+	std::lock_guard<std::mutex> lock{mutex};
+	if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		conditionVariable.notify_all();
+		if (waitingScheduler != nullptr) {
+			waitingScheduler->notifyWaitingThreads();
+		}
+	}
+}
+
+template<typename Function>
+void TaskScheduler::parallelFor(std::size_t begin, std::size_t end, Function function) {
+	if (begin >= end) {
+		return;
+	}
+
+	CompletionLatch latch{end - begin};
+	std::mutex errorMutex;
+	std::exception_ptr error;
+
+	for (std::size_t i = begin; i < end; ++i) {
+		post([i, &function, &latch, &errorMutex, &error]() {
+				try {
+					function(i);
+				} catch (...) {
+					std::lock_guard<std::mutex> lock{errorMutex};
+					if (!error) {
+						error = std::current_exception();
+					}
+				}
+				latch.countDown();
+			});
+	}
+
+	wait(latch);
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+}
+
+#endif /* TASKSCHEDULER_HPP_ */
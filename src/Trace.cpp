@@ -0,0 +1,191 @@
+#include "Trace.hpp"
+
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace car { namespace trace {
+
+namespace {
+
+struct Event {
+	const char* name;
+	std::int64_t nanoseconds;
+	char type;
+};
+
+const std::size_t chunkSize = 4096;
+
+//Only the owner thread writes a chunk. It publishes the events by increasing
+//size, and links the next chunk only after this one is full.
+struct Chunk {
+	std::array<Event, chunkSize> events;
+	std::atomic<std::size_t> size{0};
+	std::atomic<Chunk*> next{nullptr};
+};
+
+struct ThreadBuffer {
+	unsigned id = 0;
+	std::string name; //guarded by the mutex of the registry
+
+	//used only by the owner thread
+	Chunk* tail = nullptr;
+
+	//used only by the reader, with the mutex of the registry locked
+	Chunk* head = nullptr;
+	std::size_t readPosition = 0;
+
+	~ThreadBuffer() {
+		while (head != nullptr) {
+			Chunk* next = head->next.load();
+			delete head;
+			head = next;
+		}
+	}
+};
+
+//The buffers are kept after their thread exits, so their events can still
+//be written.
+struct Registry {
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+Registry& getRegistry() {
+	static Registry registry;
+	return registry;
+}
+
+thread_local ThreadBuffer* currentBuffer = nullptr;
+thread_local std::string currentThreadName;
+
+ThreadBuffer& getThreadBuffer() {
+	if (currentBuffer == nullptr) {
+		std::unique_ptr<ThreadBuffer> buffer{new ThreadBuffer};
+		buffer->head = buffer->tail = new Chunk;
+
+		Registry& registry = getRegistry();
+		std::lock_guard<std::mutex> lock{registry.mutex};
+		buffer->id = static_cast<unsigned>(registry.buffers.size());
+		buffer->name = currentThreadName.empty() ?
+				"thread " + std::to_string(buffer->id) : currentThreadName;
+		currentBuffer = buffer.get();
+		registry.buffers.push_back(std::move(buffer));
+	}
+	return *currentBuffer;
+}
+
+std::int64_t now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Calls function with every event of buffer which was not read yet, and
+//frees the chunks read completely. The mutex of the registry has to be
+//locked.
+template<typename Function>
+void readEvents(ThreadBuffer& buffer, Function function) {
+	while (true) {
+		//next is set only after the chunk is full, so it's loaded first
+		Chunk* next = buffer.head->next.load(std::memory_order_acquire);
+		const std::size_t size = buffer.head->size.load(std::memory_order_acquire);
+		for (std::size_t i = buffer.readPosition; i < size; ++i) {
+			function(buffer.head->events[i]);
+		}
+		buffer.readPosition = size;
+		if (next == nullptr) {
+			return;
+		}
+		delete buffer.head;
+		buffer.head = next;
+		buffer.readPosition = 0;
+	}
+}
+
+}
+
+namespace detail {
+
+std::atomic<bool> recording{false};
+
+void record(const char* name, char type) {
+	ThreadBuffer& buffer = getThreadBuffer();
+	Chunk* chunk = buffer.tail;
+	std::size_t size = chunk->size.load(std::memory_order_relaxed);
+	if (size == chunkSize) {
+		Chunk* next = new Chunk;
+		chunk->next.store(next, std::memory_order_release);
+		buffer.tail = chunk = next;
+		size = 0;
+	}
+	chunk->events[size] = Event{name, now(), type};
+	chunk->size.store(size + 1, std::memory_order_release);
+}
+
+}
+
+void setThreadName(std::string name) {
+	if (currentBuffer != nullptr) {
+		std::lock_guard<std::mutex> lock{getRegistry().mutex};
+		currentBuffer->name = name;
+	}
+	currentThreadName = std::move(name);
+}
+
+TraceFile::TraceFile(const std::string& fileName): file(fileName), startNanoseconds(now()) {
+	if (!file) {
+		throw std::runtime_error{"Can't open trace file: " + fileName};
+	}
+	file << "[";
+
+	Registry& registry = getRegistry();
+	{
+		std::lock_guard<std::mutex> lock{registry.mutex};
+		for (const auto& buffer : registry.buffers) {
+			readEvents(*buffer, [](const Event&) {});
+		}
+	}
+	detail::recording.store(true);
+}
+
+TraceFile::~TraceFile() {
+	detail::recording.store(false);
+	flush();
+	file << "\n]\n";
+}
+
+void TraceFile::flush() {
+	Registry& registry = getRegistry();
+	std::lock_guard<std::mutex> lock{registry.mutex};
+
+	auto separate = [this] {
+		file << (firstEvent ? "\n" : ",\n");
+		firstEvent = false;
+	};
+
+	file << std::fixed << std::setprecision(3);
+	for (const auto& buffer : registry.buffers) {
+		const unsigned id = buffer->id;
+		readEvents(*buffer, [&](const Event& event) {
+				if (namedThreads.size() <= id) {
+					namedThreads.resize(id + 1, false);
+				}
+				if (!namedThreads[id]) {
+					namedThreads[id] = true;
+					separate();
+					file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << id <<
+							",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+				}
+				separate();
+				file << "{\"name\":\"" << event.name << "\",\"ph\":\"" << event.type <<
+						"\",\"pid\":1,\"tid\":" << id << ",\"ts\":" <<
+						(event.nanoseconds - startNanoseconds) / 1000.0 << "}";
+			});
+	}
+	file.flush();
+}
+
+}} /* namespace car::trace */
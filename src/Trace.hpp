@@ -0,0 +1,82 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace car { namespace trace {
+
+//Timeline of the tasks and phases of every thread, in the Chrome trace event
+//format (viewable in Perfetto or chrome://tracing).
+//
+//Events are recorded only while a TraceFile is open. Every thread appends
+//to its own buffer without locks; the TraceFile takes the new events from
+//the buffers when it's flushed.
+
+namespace detail {
+
+extern std::atomic<bool> recording;
+
+//name has to be a string literal, only the pointer is stored
+void record(const char* name, char type);
+
+}
+
+inline bool isRecording() {
+	return detail::recording.load(std::memory_order_relaxed);
+}
+
+//The name of the current thread in the timeline. Threads without a name are
+//called "thread <id>".
+void setThreadName(std::string name);
+
+//Records the duration of the enclosing scope with the given name, which has
+//to be a string literal.
+class Scope: public boost::noncopyable {
+public:
+	explicit Scope(const char* name): name(isRecording() ? name : nullptr) {
+		if (this->name != nullptr) {
+			detail::record(this->name, 'B');
+		}
+	}
+
+	~Scope() {
+		if (name != nullptr) {
+			detail::record(name, 'E');
+		}
+	}
+
+private:
+	const char* name;
+};
+
+//Starts recording, and writes the events to fileName. The events recorded
+//before are dropped. The file is a valid trace after every flush(), the
+//closing bracket, which the viewers don't require, is written by the
+//destructor. Throws std::runtime_error if the file can't be opened.
+//
+//Only one TraceFile can be open at a time.
+class TraceFile: public boost::noncopyable {
+public:
+	explicit TraceFile(const std::string& fileName);
+	~TraceFile();
+
+	//appends the events recorded since the last flush
+	void flush();
+
+private:
+	std::ofstream file;
+	//the events are timed from here
+	std::int64_t startNanoseconds;
+	bool firstEvent = true;
+	//the thread ids whose name is written already
+	std::vector<bool> namedThreads;
+};
+
+}} /* namespace car::trace */
+
+#endif /* !TRACE_HPP */
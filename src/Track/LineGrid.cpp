@@ -0,0 +1,117 @@
+#include "LineGrid.hpp"
+
+#include <functional>
+
+namespace car { namespace track {
+
+namespace {
+
+//Lines are registered in the cells of their bounding box enlarged by this
+//ratio of the cell size, so rounding errors at the cell borders can't hide them
+const float cellPaddingRatio = 0.001f;
+
+//upper limit for the number of cells compared to the number of lines
+const std::size_t maxCellsPerLine = 4;
+
+}
+
+LineGrid::LineGrid(const std::vector<Line2f>& lines) {
+	if (lines.empty()) {
+		return;
+	}
+
+	sf::FloatRect bounds{lines[0].start, sf::Vector2f{0, 0}};
+	float totalLength = 0.f;
+	for (const Line2f& line : lines) {
+		addToBoundingBox(bounds, line.start);
+		addToBoundingBox(bounds, line.end);
+		totalLength += getLength(line.end - line.start);
+	}
+
+	//The cells should be about as big as the lines themselves, so most of
+	//the lines touch only a few cells.
+	cellSize = std::max(totalLength / lines.size(), ROUNDING_ERROR_float);
+	const std::size_t maxCells = maxCellsPerLine * lines.size() + 16;
+	while ((std::floor(bounds.width / cellSize) + 1) *
+			(std::floor(bounds.height / cellSize) + 1) > maxCells) {
+		cellSize *= 2.f;
+	}
+
+	const float padding = cellSize * cellPaddingRatio;
+	origin = sf::Vector2f{bounds.left - padding, bounds.top - padding};
+	cells = MatrixAdaptor{
+		static_cast<std::size_t>(std::floor((bounds.width + 2*padding) / cellSize)) + 1,
+		static_cast<std::size_t>(std::floor((bounds.height + 2*padding) / cellSize)) + 1};
+
+	auto forEachCell = [&](const Line2f& line, const std::function<void(std::size_t)>& function) {
+		std::size_t minColumn = getColumn(std::min(line.start.x, line.end.x) - padding);
+		std::size_t maxColumn = getColumn(std::max(line.start.x, line.end.x) + padding);
+		std::size_t minRow = getRow(std::min(line.start.y, line.end.y) - padding);
+		std::size_t maxRow = getRow(std::max(line.start.y, line.end.y) + padding);
+		for (std::size_t y = minRow; y <= maxRow; ++y) {
+			for (std::size_t x = minColumn; x <= maxColumn; ++x) {
+				function(cells.positionFromCoordinate({x, y}));
+			}
+		}
+	};
+
+	cellBegins.assign(cells.size() + 1, 0);
+	for (const Line2f& line : lines) {
+		forEachCell(line, [&](std::size_t cell) { ++cellBegins[cell + 1]; });
+	}
+	for (std::size_t i = 1; i < cellBegins.size(); ++i) {
+		cellBegins[i] += cellBegins[i - 1];
+	}
+
+	cellLines.resize(cellBegins.back());
+	std::vector<unsigned> cellEnds(cellBegins.begin(), cellBegins.end() - 1);
+	for (unsigned i = 0; i < lines.size(); ++i) {
+		forEachCell(lines[i], [&](std::size_t cell) { cellLines[cellEnds[cell]++] = i; });
+	}
+
+	for (unsigned index : cellLines) {
+		cellLineArrays.add(lines[index]);
+	}
+}
+
+void LineGrid::clear() {
+	cells = MatrixAdaptor{};
+	cellBegins.clear();
+	cellLines.clear();
+	cellLineArrays.clear();
+}
+
+void LineGrid::castRays(std::size_t count, const float* originX, const float* originY,
+		const float* rayX, const float* rayY, float startRatio, float* ratios) const {
+	//in chunks, so the traversal states fit on the stack
+	const std::size_t chunkSize = 16;
+	Traversal traversals[chunkSize];
+	for (std::size_t begin = 0; begin < count; begin += chunkSize) {
+		const std::size_t size = std::min(chunkSize, count - begin);
+		for (std::size_t i = 0; i < size; ++i) {
+			const std::size_t ray = begin + i;
+			const sf::Vector2f origin{originX[ray], originY[ray]};
+			const sf::Vector2f direction{rayX[ray], rayY[ray]};
+			startTraversal(Line2f{origin + direction*startRatio, origin + direction}, traversals[i]);
+		}
+		for (std::size_t i = 0; i < size; ++i) {
+			const std::size_t ray = begin + i;
+			float ratio = 1.f;
+			traverse(traversals[i], [&](std::size_t first, std::size_t last, float exitRatio) {
+					//the exit ratio is along the traversed part of the ray
+					exitRatio = startRatio + exitRatio*(1.f - startRatio);
+					const LineArrays& lines = cellLineArrays;
+					for (std::size_t j = first; j < last; ++j) {
+						ratio = std::min(ratio, getCrossingRatio(originX[ray], originY[ray],
+								rayX[ray], rayY[ray], lines.startX[j], lines.startY[j],
+								lines.deltaX[j], lines.deltaY[j]));
+					}
+					//nothing in the following cells can be closer
+					return ratio <= exitRatio;
+				});
+			ratios[ray] = ratio;
+		}
+	}
+}
+
+}} /* namespace car::track */
@@ -0,0 +1,219 @@
+#ifndef SRC_TRACK_LINEGRID_HPP
+#define SRC_TRACK_LINEGRID_HPP
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include "Line2.hpp"
+#include "MatrixAdaptor.hpp"
+
+namespace car { namespace track {
+
+//Uniform grid over a set of line segments. Every cell stores the indices of
+//the lines whose (slightly enlarged) bounding box overlaps the cell, so a
+//query only has to look at the lines near it. The coordinates of the lines
+//of each cell are also stored next to each other in LineArrays, for the ray
+//casting.
+class LineGrid {
+public:
+	LineGrid() = default;
+	explicit LineGrid(const std::vector<Line2f>& lines);
+
+	bool empty() const { return cells.size() == 0; }
+	void clear();
+
+	//Calls function(lineIndex) for each line near the given line. A line may be
+	//reported more than once. If function returns true, the iteration stops
+	//and true is returned.
+	template<typename Function>
+	bool forEachNearLine(const Line2f& line, Function function) const;
+
+	//Visits the cells crossed by the line in order, starting from line.start.
+	//function(begin, end, exitRatio) is called with the positions of the
+	//lines of the cell in the cell line arrays, and the ratio along the line
+	//where it leaves the cell. If function returns true, the traversal stops.
+	template<typename Function>
+	void traverse(const Line2f& line, Function function) const;
+
+	//For each of the count rays from origin to origin + ray, the smallest
+	//getCrossingRatio() with the lines, or 1 if it doesn't cross any. If no
+	//line crosses the rays before startRatio, the cells before that are
+	//skipped. The rays are processed in chunks: the traversals of a chunk are
+	//started before any of them visits its cells.
+	void castRays(std::size_t count, const float* originX, const float* originY,
+			const float* rayX, const float* rayY, float startRatio, float* ratios) const;
+
+	//State of a traverse() between the cells. Starting the traversals of
+	//several lines before visiting their cells lets the processor calculate
+	//their starting states in parallel.
+	struct Traversal {
+		bool finished;
+		float tLeave;
+		std::size_t x;
+		std::size_t y;
+		int stepX;
+		int stepY;
+		float tMaxX;
+		float tMaxY;
+		float tDeltaX;
+		float tDeltaY;
+	};
+
+	void startTraversal(const Line2f& line, Traversal& traversal) const;
+
+	//Continues the traversal the same way as traverse().
+	template<typename Function>
+	void traverse(Traversal& traversal, Function function) const;
+
+private:
+	std::size_t getColumn(float x) const;
+	std::size_t getRow(float y) const;
+
+	sf::Vector2f origin;
+	float cellSize = 1.f;
+	MatrixAdaptor cells;
+
+	//lines of cell i are cellLines[cellBegins[i], cellBegins[i+1])
+	std::vector<unsigned> cellBegins;
+	std::vector<unsigned> cellLines;
+
+	//the lines of cellLines
+	LineArrays cellLineArrays;
+};
+
+inline
+std::size_t LineGrid::getColumn(float x) const {
+	float column = std::floor((x - origin.x) / cellSize);
+	return static_cast<std::size_t>(clamp(column, 0.f, static_cast<float>(cells.getWidth() - 1)));
+}
+
+inline
+std::size_t LineGrid::getRow(float y) const {
+	float row = std::floor((y - origin.y) / cellSize);
+	return static_cast<std::size_t>(clamp(row, 0.f, static_cast<float>(cells.getHeight() - 1)));
+}
+
+template<typename Function>
+bool LineGrid::forEachNearLine(const Line2f& line, Function function) const {
+	if (empty()) {
+		return false;
+	}
+
+	std::size_t minColumn = getColumn(std::min(line.start.x, line.end.x));
+	std::size_t maxColumn = getColumn(std::max(line.start.x, line.end.x));
+	std::size_t minRow = getRow(std::min(line.start.y, line.end.y));
+	std::size_t maxRow = getRow(std::max(line.start.y, line.end.y));
+
+	for (std::size_t y = minRow; y <= maxRow; ++y) {
+		for (std::size_t x = minColumn; x <= maxColumn; ++x) {
+			std::size_t cell = cells.positionFromCoordinate({x, y});
+			for (unsigned i = cellBegins[cell]; i < cellBegins[cell + 1]; ++i) {
+				if (function(cellLines[i])) {
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+template<typename Function>
+void LineGrid::traverse(const Line2f& line, Function function) const {
+	Traversal traversal;
+	startTraversal(line, traversal);
+	traverse(traversal, function);
+}
+
+inline
+void LineGrid::startTraversal(const Line2f& line, Traversal& traversal) const {
+	traversal.finished = true;
+	if (empty()) {
+		return;
+	}
+
+	const sf::Vector2f direction = line.end - line.start;
+	const float infinity = std::numeric_limits<float>::infinity();
+
+	//clip the line to the grid (slab method), t is the ratio along the line
+	float tEnter = 0.f;
+	float tLeave = 1.f;
+	const float lower[2] = {origin.x, origin.y};
+	const float upper[2] = {origin.x + cells.getWidth() * cellSize,
+			origin.y + cells.getHeight() * cellSize};
+	const float start[2] = {line.start.x, line.start.y};
+	const float delta[2] = {direction.x, direction.y};
+	for (int axis = 0; axis < 2; ++axis) {
+		if (delta[axis] == 0.f) {
+			if (start[axis] < lower[axis] || start[axis] > upper[axis]) {
+				return;
+			}
+			continue;
+		}
+		float t1 = (lower[axis] - start[axis]) / delta[axis];
+		float t2 = (upper[axis] - start[axis]) / delta[axis];
+		tEnter = std::max(tEnter, std::min(t1, t2));
+		tLeave = std::min(tLeave, std::max(t1, t2));
+	}
+	if (tEnter > tLeave) {
+		return;
+	}
+
+	sf::Vector2f enterPoint = line.start + direction * tEnter;
+	std::size_t x = getColumn(enterPoint.x);
+	std::size_t y = getRow(enterPoint.y);
+
+	const int stepX = direction.x > 0.f ? 1 : -1;
+	const int stepY = direction.y > 0.f ? 1 : -1;
+
+	float tMaxX = infinity;
+	float tDeltaX = infinity;
+	if (direction.x != 0.f) {
+		float boundary = origin.x + (x + (stepX > 0 ? 1 : 0)) * cellSize;
+		tMaxX = (boundary - line.start.x) / direction.x;
+		tDeltaX = cellSize / std::abs(direction.x);
+	}
+	float tMaxY = infinity;
+	float tDeltaY = infinity;
+	if (direction.y != 0.f) {
+		float boundary = origin.y + (y + (stepY > 0 ? 1 : 0)) * cellSize;
+		tMaxY = (boundary - line.start.y) / direction.y;
+		tDeltaY = cellSize / std::abs(direction.y);
+	}
+
+	traversal = Traversal{false, tLeave, x, y, stepX, stepY,
+			tMaxX, tMaxY, tDeltaX, tDeltaY};
+}
+
+template<typename Function>
+void LineGrid::traverse(Traversal& traversal, Function function) const {
+	Traversal& t = traversal;
+	while (!t.finished) {
+		std::size_t cell = cells.positionFromCoordinate({t.x, t.y});
+		float tExit = std::min(std::min(t.tMaxX, t.tMaxY), t.tLeave);
+		if (function(std::size_t{cellBegins[cell]}, std::size_t{cellBegins[cell + 1]}, tExit)) {
+			t.finished = true;
+		} else if (tExit >= t.tLeave) {
+			t.finished = true;
+		} else if (t.tMaxX < t.tMaxY) {
+			if ((t.stepX < 0 && t.x == 0) || (t.stepX > 0 && t.x + 1 == cells.getWidth())) {
+				t.finished = true;
+			} else {
+				t.x += t.stepX;
+				t.tMaxX += t.tDeltaX;
+			}
+		} else {
+			if ((t.stepY < 0 && t.y == 0) || (t.stepY > 0 && t.y + 1 == cells.getHeight())) {
+				t.finished = true;
+			} else {
+				t.y += t.stepY;
+				t.tMaxY += t.tDeltaY;
+			}
+		}
+	}
+}
+
+}} /* namespace car::track */
+
+#endif /* SRC_TRACK_LINEGRID_HPP */
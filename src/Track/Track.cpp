@@ -1,5 +1,9 @@
 
 #include "Track.hpp"
+
+#include <algorithm>
+#include <cmath>
+
 #include "Car.hpp"
 #include "drawUtil.hpp"
 #include "mathUtil.hpp"
@@ -19,6 +23,7 @@ void Track::setOrigin(const sf::Vector2f& point, float direction) {
 
 void Track::addLine(const Line2f& line) {
 	lines.push_back(line);
+	lineGrid.clear();
 }
 
 void Track::addCheckpoint(const Line2f& line) {
@@ -26,32 +31,126 @@ void Track::addCheckpoint(const Line2f& line) {
 }
 
 
+void Track::buildLineGrid() {
+	lineGrid = LineGrid{lines};
+}
+
+namespace {
+
+bool crosses(const Line2f& line1, const Line2f& line2) {
+	return getCrossingRatio(line1.start.x, line1.start.y,
+			line1.end.x - line1.start.x, line1.end.y - line1.start.y,
+			line2.start.x, line2.start.y,
+			line2.end.x - line2.start.x, line2.end.y - line2.start.y) <= 1.f;
+}
+
+}
+
 bool Track::collidesWith(const Line2f& line) const {
+	if (!lineGrid.empty()) {
+		return lineGrid.forEachNearLine(line, [&](unsigned index) {
+				return crosses(line, lines[index]);
+			});
+	}
+
 	for ( const Line2f& trackLine : lines ) {
-		if ( intersects(line, trackLine) ) {
+		if ( crosses(line, trackLine) ) {
 			return true;
 		}
 	}
 	return false;
 }
 
+void Track::getLinesNear(const sf::FloatRect& area, LineArrays& result) const {
+	if (lineGrid.empty()) {
+		for (const Line2f& line : lines) {
+			result.add(line);
+		}
+		return;
+	}
+
+	//the grid can report a line from every cell it's in
+	std::vector<unsigned> indices;
+	lineGrid.forEachNearLine(Line2f{area.left, area.top, area.left + area.width, area.top + area.height},
+			[&](unsigned index) {
+				indices.push_back(index);
+				return false;
+			});
+	std::sort(indices.begin(), indices.end());
+	indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+	for (unsigned index : indices) {
+		result.add(lines[index]);
+	}
+}
+
 sf::Vector2f Track::collideWithRay(const sf::Vector2f& origin, const sf::Vector2f& direction,
 		float maxViewDistance) const {
-	Line2f lineToCheck{origin, origin + normalize(direction) * maxViewDistance};
-	for ( const Line2f& trackLine : lines ) {
-		sf::Vector2f out;
-		if ( intersects(trackLine, lineToCheck, &out) ) {
-			lineToCheck.end = out;
+	sf::Vector2f result;
+	collideWithRays(1, &origin.x, &origin.y, &direction.x, &direction.y, maxViewDistance,
+			&result.x, &result.y);
+	return result;
+}
+
+void Track::collideWithRays(std::size_t count, const float* originX, const float* originY,
+		const float* directionX, const float* directionY, float maxViewDistance,
+		float* resultX, float* resultY) const {
+	//in chunks, so the buffers fit on the stack
+	const std::size_t chunkSize = 64;
+	float rayX[chunkSize];
+	float rayY[chunkSize];
+	float ratios[chunkSize];
+	for (std::size_t begin = 0; begin < count; begin += chunkSize) {
+		const std::size_t size = std::min(chunkSize, count - begin);
+		getRays(size, directionX + begin, directionY + begin, maxViewDistance, rayX, rayY);
+		castRays(size, originX + begin, originY + begin, rayX, rayY, 0.f, ratios);
+		for (std::size_t i = 0; i < size; ++i) {
+			resultX[begin + i] = originX[begin + i] + rayX[i] * ratios[i];
+			resultY[begin + i] = originY[begin + i] + rayY[i] * ratios[i];
 		}
 	}
+}
+
+void Track::getRays(std::size_t count, const float* directionX, const float* directionY,
+		float maxViewDistance, float* rayX, float* rayY) {
+	//normalize(direction) * maxViewDistance without branches, so the loop is
+	//vectorized: a 0 direction is divided by 1 instead of its length (a
+	//select between the two would be turned back into a branch)
+	for (std::size_t i = 0; i < count; ++i) {
+		const float length = std::sqrt(directionX[i]*directionX[i] + directionY[i]*directionY[i]);
+		const float divisor = length + static_cast<float>(length == 0.f);
+		rayX[i] = directionX[i] / divisor * maxViewDistance;
+		rayY[i] = directionY[i] / divisor * maxViewDistance;
+	}
+}
+
+void Track::castRays(std::size_t count, const float* originX, const float* originY,
+		const float* rayX, const float* rayY, float startRatio, float* ratios) const {
+	if (!lineGrid.empty()) {
+		lineGrid.castRays(count, originX, originY, rayX, rayY, startRatio, ratios);
+		return;
+	}
 
-	return lineToCheck.end;
+	for (std::size_t i = 0; i < count; ++i) {
+		ratios[i] = 1.f;
+		for (const Line2f& line : lines) {
+			ratios[i] = std::min(ratios[i], getCrossingRatio(originX[i], originY[i], rayX[i], rayY[i],
+					line.start.x, line.start.y, line.end.x - line.start.x, line.end.y - line.start.y));
+		}
+	}
 }
 
 bool Track::collidesWithCheckpoint(const Line2f& line, std::size_t checkpointId) const {
 	return intersects(line, checkpoints[checkpointId]);
 }
 
+std::size_t Track::getNumberOfLines() const {
+	return lines.size();
+}
+
+const Line2f& Track::getLine(std::size_t n) const {
+	return lines[n];
+}
+
 std::size_t Track::getNumberOfCheckpoints() const {
 	return checkpoints.size();
 }
@@ -118,13 +217,32 @@ void Track::check() const
 	const float toleranceSquare = 0.0001;
 	std::vector<CheckedLine> checkedLines(lines.size());
 
+	//Only lines sharing a grid cell can intersect. They are checked in the
+	//same order as comparing every pair would, so the result is the same.
+	LineGrid localGrid;
+	if (lineGrid.empty()) {
+		localGrid = LineGrid{lines};
+	}
+	const LineGrid& grid = lineGrid.empty() ? localGrid : lineGrid;
+	std::vector<unsigned> nearLines;
+
 	for ( std::size_t i = 0; i < lines.size(); ++i ) {
 
 		if (getLengthSQ(lines[i].start - lines[i].end) < toleranceSquare * 4) {
 			throw TrackError{"Line segment too short"};
 		}
 
-		for ( std::size_t j = i + 1; j < lines.size(); ++j ) {
+		nearLines.clear();
+		grid.forEachNearLine(lines[i], [&](unsigned j) {
+				if (j > i) {
+					nearLines.push_back(j);
+				}
+				return false;
+			});
+		std::sort(nearLines.begin(), nearLines.end());
+		nearLines.erase(std::unique(nearLines.begin(), nearLines.end()), nearLines.end());
+
+		for ( unsigned j : nearLines ) {
 			sf::Vector2f p;
 			if (intersects(lines[i], lines[j], &p)) {
 				if (!(
@@ -144,5 +262,11 @@ void Track::check() const
 	}
 }
 
+TrackPtr createTrack(const std::function<Track()>& trackCreator) {
+	auto track = std::make_shared<Track>(trackCreator());
+	track->check();
+	return track;
+}
+
 }} /* namespace car::track */
 
@@ -4,12 +4,14 @@
 #include <vector>
 #include <stdexcept>
 #include <functional>
+#include <memory>
 
 #include <boost/optional.hpp>
 
 #include <SFML/Graphics.hpp>
 
 #include "Line2.hpp"
+#include "LineGrid.hpp"
 
 namespace car {
 
@@ -28,12 +30,47 @@ public:
 	void addLine(const Line2f& line);
 	void addCheckpoint(const Line2f& line);
 
+	//Should be called after all the lines are added. Until then (or after a
+	//line is added again), collision queries check every line.
+	void buildLineGrid();
+
+	//The first point where the ray from origin, maxViewDistance long, crosses
+	//a line, or the end of the ray if it doesn't cross any. The nearest line
+	//is the same whatever order the lines are checked in.
 	sf::Vector2f collideWithRay(const sf::Vector2f& origin, const sf::Vector2f& direction,
 			float maxViewDistance) const;
 
+	//The same as calling collideWithRay() for each of the count rays, whose
+	//coordinates are in separate arrays. The calculations of the different
+	//rays can overlap, and the rays can come from many cars.
+	void collideWithRays(std::size_t count, const float* originX, const float* originY,
+			const float* directionX, const float* directionY, float maxViewDistance,
+			float* resultX, float* resultY) const;
+
+	//The rays of collideWithRays(): the directions normalized to
+	//maxViewDistance length.
+	static void getRays(std::size_t count, const float* directionX, const float* directionY,
+			float maxViewDistance, float* rayX, float* rayY);
+
+	//For each of the count rays from origin to origin + ray, the smallest
+	//getCrossingRatio() with the lines, or 1 if it doesn't cross any. If the
+	//caller knows that no line crosses the rays before startRatio, the
+	//search can start from there.
+	void castRays(std::size_t count, const float* originX, const float* originY,
+			const float* rayX, const float* rayY, float startRatio, float* ratios) const;
+
+	//Whether line crosses a line of the track, by getCrossingRatio().
 	bool collidesWith(const Line2f& line) const;
+
+	//Adds the lines which can cross anything inside area to lines, each once.
+	//Checking the rays and lines inside area only against them gives the
+	//same results as castRays() and collidesWith().
+	void getLinesNear(const sf::FloatRect& area, LineArrays& lines) const;
 	bool collidesWithCheckpoint(const Line2f& line, std::size_t checkpointId) const;
 
+	std::size_t getNumberOfLines() const;
+	const Line2f& getLine(std::size_t n) const;
+
 	std::size_t getNumberOfCheckpoints() const;
 	const Line2f& getCheckpoint(std::size_t n) const;
 	void check() const;
@@ -48,11 +85,20 @@ public:
 private:
 	typedef std::vector<Line2f> Lines;
 	Lines lines;
+	LineGrid lineGrid;
 	Lines checkpoints;
 	sf::Vector2f startingPoint;
 	float startingDirection = 0.f;
 };
 
+//Tracks are immutable after they are created, so one instance is shared by
+//every simulation running on it.
+typedef std::shared_ptr<const Track> TrackPtr;
+
+//Calls trackCreator and checks the result. Throws TrackError if the track
+//is invalid.
+TrackPtr createTrack(const std::function<Track()>& trackCreator);
+
 }} /* namespace car::track */
 
 #endif /* !TRACK_HPP */
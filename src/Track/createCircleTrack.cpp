@@ -32,6 +32,7 @@ Track createCircleTrack(const CircleTrackParams& params) {
 	}
 
 	track.setOrigin({0.f, (params.innerRadius + params.outerRadius)/2.f}, 0.f);
+	track.buildLineGrid();
 
 	return track;
 }
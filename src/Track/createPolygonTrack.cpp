@@ -106,6 +106,7 @@ Track createPolygonTrack(float checkpointDistance, float trackWidth, const std::
 	for (const auto& line: additions) {
 		track.addLine(line);
 	}
+	track.buildLineGrid();
 
 	return track;
 }
@@ -1,12 +1,30 @@
 #ifndef RANDOMUTIL_HPP
 #define RANDOMUTIL_HPP
 
+#include <cassert>
+
+#include "RandomEngine.hpp"
+
 namespace car {
 
-float randomReal(float min, float max);
+//uniform between min and max
+inline
+float randomReal(RandomEngine& engine, float min, float max) {
+	assert(max >= min);
+	//the top 24 bits fit in the mantissa of a float exactly
+	const float unit = static_cast<float>(engine() >> 40) * (1.f / (1u << 24));
+	return min + unit * (max - min);
+}
 
 //inclusive on both sides
-int randomInt(int min, int max);
+inline
+int randomInt(RandomEngine& engine, int min, int max) {
+	assert(max >= min);
+	const std::uint64_t range = static_cast<std::uint64_t>(
+			static_cast<std::int64_t>(max) - min) + 1;
+	//multiply-shift instead of modulo, the top 32 bits scaled to the range
+	return static_cast<int>(min + static_cast<std::int64_t>(((engine() >> 32) * range) >> 32));
+}
 
 }
 
@@ -0,0 +1,171 @@
+#ifndef SIMDUTIL_HPP
+#define SIMDUTIL_HPP
+
+#include <cstddef>
+
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+namespace car {
+
+//Vectorized with AVX or SSE if the compiler targets them, scalar otherwise.
+//The pointers don't have to be aligned.
+inline
+float dotProduct(const float* a, const float* b, std::size_t size) {
+	std::size_t i = 0;
+	float result = 0.f;
+
+#if defined(__AVX__)
+	__m256 sum8 = _mm256_setzero_ps();
+	for (; i + 8 <= size; i += 8) {
+		sum8 = _mm256_add_ps(sum8, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	}
+	__m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+#elif defined(__SSE__)
+	__m128 sum4 = _mm_setzero_ps();
+#endif
+
+#if defined(__AVX__) || defined(__SSE__)
+	for (; i + 4 <= size; i += 4) {
+		sum4 = _mm_add_ps(sum4, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	}
+	sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+	sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+	result = _mm_cvtss_f32(sum4);
+#endif
+
+	for (; i < size; ++i) {
+		result += a[i]*b[i];
+	}
+	return result;
+}
+
+//Calculates dotProduct(a, b[k], size) for 4 vectors at the same time, so the
+//elements of a are loaded only once. The results are exactly the same as
+//the ones of dotProduct().
+inline
+void dotProduct4(const float* a, const float* const b[4], std::size_t size, float results[4]) {
+	std::size_t i = 0;
+
+#if defined(__AVX__)
+	__m256 sum8[4] = {_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps()};
+	for (; i + 8 <= size; i += 8) {
+		const __m256 a8 = _mm256_loadu_ps(a + i);
+		for (int k = 0; k < 4; ++k) {
+			sum8[k] = _mm256_add_ps(sum8[k], _mm256_mul_ps(a8, _mm256_loadu_ps(b[k] + i)));
+		}
+	}
+	__m128 sum4[4];
+	for (int k = 0; k < 4; ++k) {
+		sum4[k] = _mm_add_ps(_mm256_castps256_ps128(sum8[k]), _mm256_extractf128_ps(sum8[k], 1));
+	}
+#elif defined(__SSE__)
+	__m128 sum4[4] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+#endif
+
+#if defined(__AVX__) || defined(__SSE__)
+	for (; i + 4 <= size; i += 4) {
+		const __m128 a4 = _mm_loadu_ps(a + i);
+		for (int k = 0; k < 4; ++k) {
+			sum4[k] = _mm_add_ps(sum4[k], _mm_mul_ps(a4, _mm_loadu_ps(b[k] + i)));
+		}
+	}
+	for (int k = 0; k < 4; ++k) {
+		sum4[k] = _mm_add_ps(sum4[k], _mm_movehl_ps(sum4[k], sum4[k]));
+		sum4[k] = _mm_add_ss(sum4[k], _mm_shuffle_ps(sum4[k], sum4[k], 1));
+		results[k] = _mm_cvtss_f32(sum4[k]);
+	}
+#else
+	for (int k = 0; k < 4; ++k) {
+		results[k] = 0.f;
+	}
+#endif
+
+	for (; i < size; ++i) {
+		for (int k = 0; k < 4; ++k) {
+			results[k] += a[i]*b[k][i];
+		}
+	}
+}
+
+//Calculates dotProduct() for width pairs of vectors, whose elements are
+//interleaved: element i of vector l is a[i*width + l]. The loops over the
+//vectors are vectorized instead of the loops over the elements, but the
+//partial sums are added in the same order as in dotProduct(), so the
+//results are exactly the same. width has to be a multiple of 8.
+template<std::size_t width>
+void dotProductLanes(const float* a, const float* b, std::size_t size, float results[width]) {
+	static_assert(width % 8 == 0, "the lanes have to fill whole vectors");
+	std::size_t i = 0;
+
+#if defined(__AVX__)
+	const std::size_t vectorCount = width / 8;
+	__m256 sum8[8][vectorCount];
+	__m256 sum4[4][vectorCount];
+	for (std::size_t v = 0; v < vectorCount; ++v) {
+		for (std::size_t j = 0; j < 8; ++j) {
+			sum8[j][v] = _mm256_setzero_ps();
+		}
+	}
+	for (; i + 8 <= size; i += 8) {
+		for (std::size_t j = 0; j < 8; ++j) {
+			for (std::size_t v = 0; v < vectorCount; ++v) {
+				const std::size_t k = (i + j)*width + v*8;
+				sum8[j][v] = _mm256_add_ps(sum8[j][v], _mm256_mul_ps(_mm256_loadu_ps(a + k), _mm256_loadu_ps(b + k)));
+			}
+		}
+	}
+	for (std::size_t v = 0; v < vectorCount; ++v) {
+		for (std::size_t j = 0; j < 4; ++j) {
+			sum4[j][v] = _mm256_add_ps(sum8[j][v], sum8[j + 4][v]);
+		}
+	}
+	for (; i + 4 <= size; i += 4) {
+		for (std::size_t j = 0; j < 4; ++j) {
+			for (std::size_t v = 0; v < vectorCount; ++v) {
+				const std::size_t k = (i + j)*width + v*8;
+				sum4[j][v] = _mm256_add_ps(sum4[j][v], _mm256_mul_ps(_mm256_loadu_ps(a + k), _mm256_loadu_ps(b + k)));
+			}
+		}
+	}
+	for (std::size_t v = 0; v < vectorCount; ++v) {
+		_mm256_storeu_ps(results + v*8, _mm256_add_ps(
+				_mm256_add_ps(sum4[0][v], sum4[2][v]), _mm256_add_ps(sum4[1][v], sum4[3][v])));
+	}
+#elif defined(__SSE__)
+	const std::size_t vectorCount = width / 4;
+	__m128 sum4[4][vectorCount];
+	for (std::size_t v = 0; v < vectorCount; ++v) {
+		for (std::size_t j = 0; j < 4; ++j) {
+			sum4[j][v] = _mm_setzero_ps();
+		}
+	}
+	for (; i + 4 <= size; i += 4) {
+		for (std::size_t j = 0; j < 4; ++j) {
+			for (std::size_t v = 0; v < vectorCount; ++v) {
+				const std::size_t k = (i + j)*width + v*4;
+				sum4[j][v] = _mm_add_ps(sum4[j][v], _mm_mul_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k)));
+			}
+		}
+	}
+	for (std::size_t v = 0; v < vectorCount; ++v) {
+		_mm_storeu_ps(results + v*4, _mm_add_ps(
+				_mm_add_ps(sum4[0][v], sum4[2][v]), _mm_add_ps(sum4[1][v], sum4[3][v])));
+	}
+#else
+	for (std::size_t l = 0; l < width; ++l) {
+		results[l] = 0.f;
+	}
+#endif
+
+	for (; i < size; ++i) {
+		for (std::size_t l = 0; l < width; ++l) {
+			results[l] += a[i*width + l] * b[i*width + l];
+		}
+	}
+}
+
+}
+
+#endif /* !SIMDUTIL_HPP */
@@ -0,0 +1,27 @@
+
+//Converts populations and networks between the binary checkpoint format and
+//the boost text archives. The direction depends on the format of the input.
+
+#include <cstring>
+#include <iostream>
+
+#include "Checkpoint.hpp"
+
+using namespace car;
+
+int main(int argc, char** argv) {
+	if (argc != 4 || (std::strcmp(argv[1], "population") != 0 && std::strcmp(argv[1], "network") != 0)) {
+		std::cerr << "Usage: " << argv[0] << " population|network <input> <output>" << std::endl;
+		return 1;
+	}
+	const CheckpointKind kind = std::strcmp(argv[1], "network") == 0 ?
+			CheckpointKind::network : CheckpointKind::population;
+
+	try {
+		convertCheckpoint(kind, argv[2], argv[3]);
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,169 @@
+#include <boost/test/unit_test.hpp>
+
+#include <set>
+
+#include "AIGameManager.hpp"
+#include "BatchSimulator.hpp"
+#include "Track/createCircleTrack.hpp"
+
+using namespace car;
+
+namespace {
+
+track::TrackPtr createTrack() {
+	return std::make_shared<const track::Track>(
+			track::createCircleTrack(track::CircleTrackParams{}));
+}
+
+std::vector<Weights> createRandomWeights(const Parameters& parameters, std::size_t count) {
+	RandomEngine engine{parameters.seed};
+	std::vector<Weights> result;
+	for (std::size_t i = 0; i < count; ++i) {
+		NeuralNetwork network{parameters.hiddenLayerCount, parameters.neuronPerHiddenLayer,
+			parameters.getInputNeuronCount(), parameters.outputNeuronCount, parameters.useRecurrence};
+		network.randomizeWeights(engine);
+		result.push_back(network.getWeights());
+	}
+	return result;
+}
+
+//The batch does the same calculations as the scalar path, the tolerance is
+//only there for compilers which evaluate float expressions differently.
+//Returns the stall counters of the batch.
+StallCounters checkSameAsAIGameManager(const Parameters& parameters, std::size_t carCount) {
+	track::TrackPtr track = createTrack();
+	std::vector<Weights> weights = createRandomWeights(parameters, carCount);
+
+	BatchSimulator simulator{parameters, track};
+	for (const Weights& carWeights : weights) {
+		simulator.addCar(carWeights.data());
+	}
+	simulator.run();
+	BOOST_REQUIRE_EQUAL(simulator.getCarCount(), carCount);
+
+	std::set<unsigned> crossedCheckpoints;
+	StallCounters stallCounters;
+	for (std::size_t i = 0; i < carCount; ++i) {
+		NeuralNetwork network{parameters.hiddenLayerCount, parameters.neuronPerHiddenLayer,
+			parameters.getInputNeuronCount(), parameters.outputNeuronCount, parameters.useRecurrence};
+		network.setWeights(weights[i]);
+
+		AIGameManager manager{parameters, track};
+		manager.setNeuralNetwork(network);
+		manager.run();
+
+		BOOST_TEST_MESSAGE("car " << i);
+		BOOST_CHECK_CLOSE(simulator.getFitness(i), manager.getFitness(), 1e-3);
+		crossedCheckpoints.insert(simulator.getNumberOfCrossedCheckpoints(i));
+		if (manager.getStallPolicy() != StallPolicy::none) {
+			stallCounters.add(manager.getStallPolicy(), 0);
+		}
+	}
+	BOOST_CHECK(simulator.getStallCounters().stoppedCars == stallCounters.stoppedCars);
+
+	//the cars didn't all stop at the same time
+	BOOST_CHECK_GT(crossedCheckpoints.size(), 1u);
+	return simulator.getStallCounters();
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(BatchSimulatorTest)
+
+BOOST_AUTO_TEST_CASE(results_are_the_same_as_with_AIGameManager) {
+	Parameters parameters;
+	parameters.seed = 5;
+	checkSameAsAIGameManager(parameters, 40);
+}
+
+BOOST_AUTO_TEST_CASE(results_are_the_same_as_with_AIGameManager_with_recurrence) {
+	Parameters parameters;
+	parameters.seed = 6;
+	parameters.useRecurrence = true;
+	checkSameAsAIGameManager(parameters, 40);
+}
+
+BOOST_AUTO_TEST_CASE(stall_policies_stop_the_same_cars_as_with_AIGameManager) {
+	for (std::size_t policy = 0; policy < stallPolicyCount; ++policy) {
+		Parameters parameters;
+		parameters.seed = 7;
+		switch (static_cast<StallPolicy>(policy)) {
+		case StallPolicy::noCheckpoint: parameters.stallCheckpointSeconds = 10.f; break;
+		case StallPolicy::slow: parameters.stallSpeedSeconds = 5.f; break;
+		default: parameters.stallApproachSeconds = 5.f; break;
+		}
+		BOOST_TEST_MESSAGE(getStallPolicyName(static_cast<StallPolicy>(policy)));
+		const StallCounters counters = checkSameAsAIGameManager(parameters, 40);
+		BOOST_CHECK_GT(counters.stoppedCars[policy], 0u);
+		BOOST_CHECK_GT(counters.savedSteps[policy], counters.stoppedCars[policy]);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(cars_of_the_same_network_on_different_tracks_are_the_same_as_with_AIGameManager) {
+	Parameters parameters;
+	parameters.seed = 7;
+	parameters.useRecurrence = true;
+	std::vector<track::TrackPtr> tracks;
+	for (int i = 0; i < 5; ++i) {
+		track::CircleTrackParams params;
+		params.innerRadius = 30.f + 10.f*i;
+		params.outerRadius = params.innerRadius + 8.f + i;
+		params.numberOfCheckpoints = 40 + 8*i;
+		tracks.push_back(std::make_shared<const track::Track>(track::createCircleTrack(params)));
+	}
+	std::vector<Weights> weights = createRandomWeights(parameters, 3);
+
+	//every genome on every track, so the networks evaluate 5 inputs at once
+	BatchSimulator simulator{parameters, tracks};
+	for (const Weights& carWeights : weights) {
+		for (std::size_t j = 0; j < tracks.size(); ++j) {
+			simulator.addCar(carWeights.data(), j);
+		}
+	}
+	simulator.run();
+	BOOST_REQUIRE_EQUAL(simulator.getCarCount(), weights.size() * tracks.size());
+	//a call evaluates every running car of a genome
+	BOOST_CHECK_GT(simulator.getNetworkCallCount(), 0u);
+	BOOST_CHECK_LT(simulator.getNetworkCallCount(), simulator.getStepCount());
+
+	std::size_t car = 0;
+	for (const Weights& carWeights : weights) {
+		NeuralNetwork network{parameters.hiddenLayerCount, parameters.neuronPerHiddenLayer,
+			parameters.getInputNeuronCount(), parameters.outputNeuronCount, parameters.useRecurrence};
+		network.setWeights(carWeights);
+		for (const track::TrackPtr& track : tracks) {
+			AIGameManager manager{parameters, track};
+			manager.setNeuralNetwork(network);
+			manager.run();
+
+			BOOST_TEST_MESSAGE("car " << car);
+			BOOST_CHECK_CLOSE(simulator.getFitness(car), manager.getFitness(), 1e-3);
+			++car;
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(cars_can_be_run_again_after_clear) {
+	Parameters parameters;
+	parameters.useRecurrence = true;
+	std::vector<Weights> weights = createRandomWeights(parameters, 3);
+
+	BatchSimulator simulator{parameters, createTrack()};
+	simulator.addCar(weights[0].data());
+	simulator.addCar(weights[1].data());
+	simulator.run();
+	const float fitness = simulator.getFitness(1);
+
+	simulator.clear();
+	BOOST_CHECK_EQUAL(simulator.getCarCount(), 0u);
+	simulator.addCar(weights[2].data());
+	simulator.addCar(weights[1].data());
+	simulator.run();
+	BOOST_CHECK_EQUAL(simulator.getCarCount(), 2u);
+	BOOST_CHECK_EQUAL(simulator.getFitness(1), fitness);
+
+	simulator.run();
+	BOOST_CHECK_EQUAL(simulator.getFitness(1), fitness);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
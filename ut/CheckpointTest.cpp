@@ -0,0 +1,177 @@
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include "Checkpoint.hpp"
+#include "GeneticPopulation.hpp"
+
+using namespace car;
+
+namespace {
+
+//removes the file at the end of the test
+struct TemporaryFile {
+	explicit TemporaryFile(std::string name): name(std::move(name)) {}
+	~TemporaryFile() { std::remove(name.c_str()); }
+	std::string name;
+};
+
+void setFakeFitness(GeneticPopulation& population) {
+	for (std::size_t i = 0; i < population.size(); ++i) {
+		const Weight* weights = population.getWeights(i);
+		population.setFitness(i, 1.f + weights[i % 30] * weights[0]);
+	}
+}
+
+void evolveWithFakeFitness(GeneticPopulation& population, int generations) {
+	for (int generation = 0; generation < generations; ++generation) {
+		setFakeFitness(population);
+		population.evolve();
+	}
+}
+
+void checkSameGenomes(const Genomes& genomes1, const Genomes& genomes2) {
+	BOOST_REQUIRE_EQUAL(genomes1.size(), genomes2.size());
+	for (std::size_t i = 0; i < genomes1.size(); ++i) {
+		BOOST_CHECK(genomes1[i].weights == genomes2[i].weights);
+		BOOST_CHECK_EQUAL(genomes1[i].fitness, genomes2[i].fitness);
+		BOOST_CHECK_EQUAL(genomes1[i].unchanged, genomes2[i].unchanged);
+	}
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(CheckpointTest)
+
+BOOST_AUTO_TEST_CASE(population_can_be_saved_and_mapped) {
+	TemporaryFile file{"CheckpointTest_population.bin"};
+	GeneticPopulation population{20, 30, 5};
+	evolveWithFakeFitness(population, 2);
+	setFakeFitness(population);
+
+	CheckpointInfo info;
+	info.simulationFingerprint = 123;
+	saveCheckpoint(file.name, info, population);
+
+	MappedCheckpoint checkpoint{file.name};
+	BOOST_CHECK(checkpoint.getInfo().kind == CheckpointKind::population);
+	BOOST_CHECK_EQUAL(checkpoint.getInfo().seed, 5u);
+	BOOST_CHECK_EQUAL(checkpoint.getInfo().generation, 2u);
+	BOOST_CHECK_EQUAL(checkpoint.getInfo().simulationFingerprint, 123u);
+	BOOST_CHECK_EQUAL(checkpoint.getWeightCount(), 30u);
+	BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(checkpoint.getWeights()) % 64, 0u);
+	checkSameGenomes(checkpoint.getGenomes(), population.getGenomes());
+}
+
+BOOST_AUTO_TEST_CASE(restored_population_evolves_the_same_way) {
+	TemporaryFile file{"CheckpointTest_resume.bin"};
+	GeneticPopulation original{20, 30, 5};
+	evolveWithFakeFitness(original, 3);
+
+	CheckpointInfo info;
+	info.simulationFingerprint = 123;
+	saveCheckpoint(file.name, info, original);
+	evolveWithFakeFitness(original, 3);
+
+	GeneticPopulation resumed{20, 30, 6};
+	MappedCheckpoint{file.name}.restorePopulation(resumed, 123);
+	BOOST_CHECK_EQUAL(resumed.getSeed(), 5u);
+	BOOST_CHECK_EQUAL(resumed.getGeneration(), 3u);
+	evolveWithFakeFitness(resumed, 3);
+
+	checkSameGenomes(resumed.getGenomes(), original.getGenomes());
+}
+
+BOOST_AUTO_TEST_CASE(fitness_of_other_simulation_setup_is_dropped) {
+	TemporaryFile file{"CheckpointTest_fingerprint.bin"};
+	GeneticPopulation population{20, 30, 5};
+	setFakeFitness(population);
+	CheckpointInfo info;
+	info.simulationFingerprint = 123;
+	saveCheckpoint(file.name, info, population);
+
+	GeneticPopulation restored{20, 30, 6};
+	MappedCheckpoint{file.name}.restorePopulation(restored, 124, false);
+	BOOST_CHECK_EQUAL(restored.getSeed(), 6u);
+	for (std::size_t i = 0; i < restored.size(); ++i) {
+		BOOST_CHECK(!restored.isUnchanged(i));
+		BOOST_CHECK(std::equal(restored.getWeights(i), restored.getWeights(i) + 30,
+				population.getWeights(i)));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(network_gives_same_output_in_both_formats) {
+	TemporaryFile binaryFile{"CheckpointTest_network.bin"};
+	TemporaryFile textFile{"CheckpointTest_network.txt"};
+	TemporaryFile convertedFile{"CheckpointTest_converted.bin"};
+	NeuralNetwork network{2, 5, 4, 3, true};
+	RandomEngine engine{3};
+	network.randomizeWeights(engine);
+
+	saveNeuralNetwork(binaryFile.name, network, CheckpointFormat::binary);
+	saveNeuralNetwork(textFile.name, network, CheckpointFormat::text);
+	BOOST_CHECK(isBinaryCheckpoint(binaryFile.name));
+	BOOST_CHECK(!isBinaryCheckpoint(textFile.name));
+	convertCheckpoint(CheckpointKind::network, textFile.name, convertedFile.name);
+
+	const Weights input{0.1f, -0.4f, 0.7f, 0.2f};
+	const Weights expected = network.evaluateInput(input);
+	for (const std::string& fileName : {binaryFile.name, textFile.name, convertedFile.name}) {
+		NeuralNetwork loaded = loadNeuralNetwork(fileName);
+		BOOST_CHECK(loaded.getWeights() == network.getWeights());
+		BOOST_CHECK(loaded.evaluateInput(input) == expected);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(text_population_is_converted_to_binary) {
+	TemporaryFile textFile{"CheckpointTest_population.txt"};
+	TemporaryFile binaryFile{"CheckpointTest_converted.bin"};
+	const Genomes genomes{Genome{{1.f, 2.f, 3.f}}, Genome{{4.f, 5.f, 6.f}}};
+	savePopulationText(textFile.name, genomes);
+
+	convertCheckpoint(CheckpointKind::population, textFile.name, binaryFile.name);
+
+	MappedCheckpoint checkpoint{binaryFile.name};
+	BOOST_CHECK(!checkpoint.getInfo().topology.isKnown());
+	checkSameGenomes(checkpoint.getGenomes(), genomes);
+}
+
+BOOST_AUTO_TEST_CASE(truncated_checkpoint_throws) {
+	TemporaryFile file{"CheckpointTest_truncated.bin"};
+	saveCheckpoint(file.name, CheckpointInfo{}, Genomes{Genome{Weights(100, 1.f)}});
+	std::string data;
+	{
+		std::ifstream ifs(file.name, std::ios::binary);
+		data.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+	}
+	{
+		std::ofstream ofs(file.name, std::ios::binary);
+		ofs.write(data.data(), data.size() - 4);
+	}
+	BOOST_CHECK_THROW(MappedCheckpoint{file.name}, CheckpointError);
+	BOOST_CHECK_THROW(MappedCheckpoint{"CheckpointTest_missing.bin"}, CheckpointError);
+}
+
+BOOST_AUTO_TEST_CASE(corrupt_block_offset_throws) {
+	TemporaryFile file{"CheckpointTest_corrupt.bin"};
+	saveCheckpoint(file.name, CheckpointInfo{}, Genomes{Genome{Weights(100, 1.f)}});
+	std::string data;
+	{
+		std::ifstream ifs(file.name, std::ios::binary);
+		data.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+	}
+	//the starts of the fitness and the unchanged blocks, the end of the block would wrap around
+	for (std::size_t offset : {64, 72}) {
+		std::string corrupt = data;
+		const std::uint64_t start = static_cast<std::uint64_t>(-4);
+		std::copy_n(reinterpret_cast<const char*>(&start), sizeof(start), &corrupt[offset]);
+		{
+			std::ofstream ofs(file.name, std::ios::binary);
+			ofs.write(corrupt.data(), corrupt.size());
+		}
+		BOOST_CHECK_THROW(MappedCheckpoint{file.name}, CheckpointError);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
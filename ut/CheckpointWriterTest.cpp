@@ -0,0 +1,89 @@
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include "CheckpointWriter.hpp"
+
+using namespace car;
+
+namespace {
+
+CheckpointWriter::WriteFunction writeText(const std::string& text) {
+	return [text](const std::string& fileName) {
+		std::ofstream ofs(fileName);
+		ofs << text;
+	};
+}
+
+std::string readText(const std::string& fileName) {
+	std::ifstream ifs(fileName);
+	std::string text;
+	std::getline(ifs, text);
+	return text;
+}
+
+bool exists(const std::string& fileName) {
+	return std::ifstream(fileName).good();
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(CheckpointWriterTest)
+
+BOOST_AUTO_TEST_CASE(submitted_file_is_written_after_flush) {
+	const std::string fileName = "CheckpointWriterTest_written.txt";
+	CheckpointWriter writer;
+	writer.submit(fileName, writeText("first"));
+	writer.flush();
+
+	BOOST_CHECK_EQUAL(readText(fileName), "first");
+	BOOST_CHECK(!exists(fileName + ".tmp"));
+	BOOST_CHECK_EQUAL(writer.getWrittenCount(), 1u);
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(pending_snapshot_is_replaced_by_newer_one) {
+	const std::string blockingFileName = "CheckpointWriterTest_blocking.txt";
+	const std::string fileName = "CheckpointWriterTest_replaced.txt";
+	std::promise<void> started, release;
+	std::shared_future<void> released = release.get_future().share();
+
+	CheckpointWriter writer;
+	writer.submit(blockingFileName, [&started, released](const std::string& name) {
+			started.set_value();
+			released.wait();
+			std::ofstream{name} << "blocking";
+		});
+	started.get_future().wait();
+
+	//the writer thread is busy, so these have to wait
+	writer.submit(fileName, writeText("old"));
+	writer.submit(fileName, writeText("new"));
+	release.set_value();
+	writer.flush();
+
+	BOOST_CHECK_EQUAL(readText(fileName), "new");
+	BOOST_CHECK_EQUAL(writer.getWrittenCount(), 2u);
+	BOOST_CHECK_EQUAL(writer.getDroppedCount(), 1u);
+	std::remove(blockingFileName.c_str());
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(failed_write_keeps_the_previous_file) {
+	const std::string fileName = "CheckpointWriterTest_failed.txt";
+	CheckpointWriter writer;
+	writer.submit(fileName, writeText("good"));
+	writer.flush();
+
+	writer.submit(fileName, [](const std::string& name) {
+			std::ofstream{name} << "partial";
+			throw std::runtime_error{"write failed"};
+		});
+	BOOST_CHECK_THROW(writer.flush(), std::runtime_error);
+	BOOST_CHECK_EQUAL(readText(fileName), "good");
+	BOOST_CHECK(!exists(fileName + ".tmp"));
+
+	std::remove(fileName.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+
+#include "BatchSimulator.hpp"
+#include "Car.hpp"
+#include "FitnessBound.hpp"
+#include "NeuralNetwork.hpp"
+#include "Track/createCircleTrack.hpp"
+
+using namespace car;
+
+BOOST_AUTO_TEST_SUITE(FitnessBoundTest)
+
+BOOST_AUTO_TEST_CASE(travel_distance_bound_is_close_to_full_throttle) {
+	Parameters parameters;
+	parameters.fitnessExpression = parseMathExpression("td");
+	track::Track track;
+	const float bound = getFitnessUpperBound(parameters, track, BatchSimulator::maxTime);
+
+	//the same steps as BatchSimulator::run()
+	const float timeStep = 1.f / parameters.physicsTimeStepsPerSecond;
+	Car car;
+	car.setThrottle(1.f);
+	for (float currentTime = 0.f; currentTime <= BatchSimulator::maxTime; currentTime += timeStep) {
+		car.move(timeStep);
+	}
+	BOOST_CHECK_GE(bound, car.getTravelDistance());
+	BOOST_CHECK_LE(bound, car.getTravelDistance() * 1.05f);
+}
+
+BOOST_AUTO_TEST_CASE(bound_of_non_monotonic_expression_covers_every_travel_distance) {
+	Parameters parameters;
+	parameters.fitnessExpression = parseMathExpression("td");
+	track::Track track;
+	BOOST_REQUIRE_GT(getFitnessUpperBound(parameters, track, BatchSimulator::maxTime), 100.f);
+
+	//0 at both ends of the range of td, but almost 100 just below 100
+	parameters.fitnessExpression = parseMathExpression("td * (td < 100)");
+	BOOST_CHECK_GE(getFitnessUpperBound(parameters, track, BatchSimulator::maxTime), 100.f);
+}
+
+BOOST_AUTO_TEST_CASE(bound_of_negative_expression_is_negative) {
+	Parameters parameters;
+	parameters.fitnessExpression = parseMathExpression("td");
+	track::Track track;
+	const float travelDistanceBound = getFitnessUpperBound(parameters, track, BatchSimulator::maxTime);
+
+	//racing adds the bounds of the remaining tracks, so a negative one has to stay negative
+	parameters.fitnessExpression = parseMathExpression("td - 100000");
+	const float bound = getFitnessUpperBound(parameters, track, BatchSimulator::maxTime);
+	BOOST_CHECK_LT(bound, 0.f);
+	BOOST_CHECK_GE(bound, travelDistanceBound - 100000.f);
+}
+
+BOOST_AUTO_TEST_CASE(bound_is_above_the_fitness_of_random_cars) {
+	Parameters parameters;
+	auto track = std::make_shared<const track::Track>(
+			track::createCircleTrack(track::CircleTrackParams{}));
+	const float bound = getFitnessUpperBound(parameters, *track, BatchSimulator::maxTime);
+	BOOST_REQUIRE(std::isfinite(bound));
+
+	RandomEngine engine{parameters.seed};
+	std::vector<Weights> weights;
+	BatchSimulator simulator{parameters, track};
+	for (std::size_t i = 0; i < 20; ++i) {
+		NeuralNetwork network{parameters.hiddenLayerCount, parameters.neuronPerHiddenLayer,
+			parameters.getInputNeuronCount(), parameters.outputNeuronCount, parameters.useRecurrence};
+		network.randomizeWeights(engine);
+		weights.push_back(network.getWeights());
+	}
+	for (const Weights& carWeights : weights) {
+		simulator.addCar(carWeights.data());
+	}
+	simulator.run();
+	for (std::size_t i = 0; i < weights.size(); ++i) {
+		BOOST_CHECK_LT(simulator.getFitness(i), bound);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(no_bound_if_checkpoints_are_closer_than_the_car) {
+	Parameters parameters;
+	track::Track track;
+	track.addCheckpoint(Line2f{{0.f, -5.f}, {0.f, 5.f}});
+	track.addCheckpoint(Line2f{{1.f, -5.f}, {1.f, 5.f}});
+	const float bound = getFitnessUpperBound(parameters, track, BatchSimulator::maxTime);
+	BOOST_CHECK(std::isinf(bound));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,50 @@
+#include <boost/test/unit_test.hpp>
+#include "FitnessCache.hpp"
+#include "Track/createCircleTrack.hpp"
+
+using namespace car;
+
+BOOST_AUTO_TEST_SUITE(FitnessCacheTest)
+
+BOOST_AUTO_TEST_CASE(inserted_weights_are_found) {
+	FitnessCache cache{1};
+	cache.insert({1.f, 2.f, 3.f}, 10.f);
+
+	auto fitness = cache.find({1.f, 2.f, 3.f});
+	BOOST_REQUIRE(fitness);
+	BOOST_CHECK_EQUAL(*fitness, 10.f);
+	BOOST_CHECK(!cache.find({1.f, 2.f, 3.5f}));
+	BOOST_CHECK(!cache.find({1.f, 2.f}));
+}
+
+BOOST_AUTO_TEST_CASE(clear_removes_everything) {
+	FitnessCache cache;
+	cache.insert({1.f}, 10.f);
+	cache.insert({2.f}, 20.f);
+	BOOST_CHECK_EQUAL(cache.size(), 2u);
+
+	cache.clear();
+	BOOST_CHECK_EQUAL(cache.size(), 0u);
+	BOOST_CHECK(!cache.find({1.f}));
+}
+
+BOOST_AUTO_TEST_CASE(fingerprint_depends_on_tracks_and_parameters) {
+	Parameters parameters;
+	track::CircleTrackParams circleParams;
+	std::vector<track::TrackPtr> tracks{
+		std::make_shared<const track::Track>(track::createCircleTrack(circleParams))};
+	const std::uint64_t fingerprint = getSimulationFingerprint(parameters, tracks);
+
+	BOOST_CHECK_EQUAL(getSimulationFingerprint(parameters, tracks), fingerprint);
+
+	Parameters otherParameters = parameters;
+	otherParameters.fitnessExpression = parseMathExpression("td");
+	BOOST_CHECK_NE(getSimulationFingerprint(otherParameters, tracks), fingerprint);
+
+	circleParams.outerRadius += 1.f;
+	std::vector<track::TrackPtr> otherTracks{
+		std::make_shared<const track::Track>(track::createCircleTrack(circleParams))};
+	BOOST_CHECK_NE(getSimulationFingerprint(parameters, otherTracks), fingerprint);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
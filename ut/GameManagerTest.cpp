@@ -0,0 +1,95 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "GameManager.hpp"
+#include "Track/createCircleTrack.hpp"
+
+namespace {
+
+std::atomic<std::size_t> allocationCount{0};
+
+}
+
+//Count every allocation of the test binary, so we can check that the
+//physics step doesn't allocate memory.
+void* operator new(std::size_t size) {
+	++allocationCount;
+	if (void* result = std::malloc(size == 0 ? 1 : size)) {
+		return result;
+	}
+	throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+using namespace car;
+
+namespace {
+
+track::TrackPtr createTrack() {
+	return std::make_shared<const track::Track>(
+			track::createCircleTrack(track::CircleTrackParams{}));
+}
+
+std::size_t countAllocationsOfAdvance(const Parameters& parameters) {
+	GameManager manager{parameters, createTrack()};
+
+	//the first step may size the buffers
+	manager.advance();
+
+	std::size_t allocationsBefore = allocationCount;
+	for (int i = 0; i < 1000; ++i) {
+		manager.advance();
+	}
+	return allocationCount - allocationsBefore;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(GameManagerTest)
+
+BOOST_AUTO_TEST_CASE(advance_does_not_allocate) {
+	Parameters parameters;
+	BOOST_CHECK_EQUAL(countAllocationsOfAdvance(parameters), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(advance_does_not_allocate_with_recurrence) {
+	Parameters parameters;
+	parameters.useRecurrence = true;
+	parameters.hiddenLayerCount = 3;
+	BOOST_CHECK_EQUAL(countAllocationsOfAdvance(parameters), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(init_does_not_copy_the_track) {
+	Parameters parameters;
+	track::TrackPtr track = createTrack();
+	GameManager manager{parameters, track};
+	manager.advance();
+
+	std::size_t allocationsBefore = allocationCount;
+	manager.init();
+	BOOST_CHECK_EQUAL(allocationCount - allocationsBefore, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,161 @@
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include "GeneticPopulation.hpp"
+#include "TaskScheduler.hpp"
+
+using namespace car;
+
+namespace {
+
+void setFakeFitness(GeneticPopulation& population) {
+	for (std::size_t i = 0; i < population.size(); ++i) {
+		const Weight* weights = population.getWeights(i);
+		population.setFitness(i, 1.f + weights[i % 30] * weights[0]);
+	}
+}
+
+Genomes evolveWithFakeFitness(std::uint64_t seed, unsigned populationSize = 20,
+		TaskScheduler* scheduler = nullptr) {
+	GeneticPopulation population{populationSize, 30, seed};
+	for (int generation = 0; generation < 5; ++generation) {
+		setFakeFitness(population);
+		population.evolve(scheduler);
+	}
+	return population.getGenomes();
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(GeneticPopulationTest)
+
+BOOST_AUTO_TEST_CASE(same_seed_gives_same_population) {
+	Genomes population1 = evolveWithFakeFitness(7);
+	Genomes population2 = evolveWithFakeFitness(7);
+
+	BOOST_REQUIRE_EQUAL(population1.size(), population2.size());
+	for (std::size_t i = 0; i < population1.size(); ++i) {
+		BOOST_CHECK(population1[i].weights == population2[i].weights);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(different_seed_gives_different_population) {
+	Genomes population1 = evolveWithFakeFitness(7);
+	Genomes population2 = evolveWithFakeFitness(8);
+
+	BOOST_CHECK(population1[0].weights != population2[0].weights);
+}
+
+BOOST_AUTO_TEST_CASE(evolving_in_parallel_gives_the_same_population) {
+	TaskScheduler scheduler{3};
+	Genomes population1 = evolveWithFakeFitness(7, 200);
+	Genomes population2 = evolveWithFakeFitness(7, 200, &scheduler);
+
+	BOOST_REQUIRE_EQUAL(population1.size(), population2.size());
+	for (std::size_t i = 0; i < population1.size(); ++i) {
+		BOOST_CHECK(population1[i].weights == population2[i].weights);
+		BOOST_CHECK_EQUAL(population1[i].fitness, population2[i].fitness);
+		BOOST_CHECK_EQUAL(population1[i].unchanged, population2[i].unchanged);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(genomes_can_be_set_and_read_back) {
+	GeneticPopulation population{4, 3, 1};
+	Genomes genomes{Genome{{1.f, 2.f, 3.f}, 5.f}, Genome{{4.f, 5.f, 6.f}}};
+	genomes[0].unchanged = true;
+	population.setGenomes(genomes);
+
+	BOOST_REQUIRE_EQUAL(population.size(), 2u);
+	BOOST_CHECK_EQUAL(population.getWeights(1)[2], 6.f);
+	BOOST_CHECK(population.isUnchanged(0));
+	BOOST_CHECK(!population.isUnchanged(1));
+
+	const Genomes result = population.getGenomes();
+	BOOST_REQUIRE_EQUAL(result.size(), 2u);
+	BOOST_CHECK(result[0].weights == genomes[0].weights);
+	BOOST_CHECK_EQUAL(result[0].fitness, 5.f);
+	BOOST_CHECK(result[1].weights == genomes[1].weights);
+}
+
+BOOST_AUTO_TEST_CASE(copied_genomes_keep_their_fitness) {
+	GeneticPopulation population{20, 30, 3};
+	for (std::size_t i = 0; i < population.size(); ++i) {
+		population.setFitness(i, static_cast<float>(i + 1));
+	}
+	const Genomes before = population.getGenomes();
+	population.evolve();
+
+	std::size_t unchangedCount = 0;
+	for (const Genome& genome : population.getGenomes()) {
+		if (!genome.unchanged) {
+			continue;
+		}
+		++unchangedCount;
+		auto it = std::find_if(before.begin(), before.end(),
+				[&](const Genome& old) { return old.weights == genome.weights; });
+		BOOST_REQUIRE(it != before.end());
+		BOOST_CHECK_EQUAL(genome.fitness, it->fitness);
+	}
+	//at least the best ones are copied
+	BOOST_CHECK_GE(unchangedCount, 8u);
+}
+
+BOOST_AUTO_TEST_CASE(copies_of_estimated_genomes_are_simulated_again) {
+	GeneticPopulation population{20, 30, 3};
+	for (std::size_t i = 0; i < population.size(); ++i) {
+		population.setFitnessEstimate(i, static_cast<float>(i + 1));
+	}
+	BOOST_CHECK(!population.isUnchanged(0));
+	population.evolve();
+
+	for (const Genome& genome : population.getGenomes()) {
+		BOOST_CHECK(!genome.unchanged);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(migrants_replace_the_last_genomes_and_keep_their_fitness) {
+	GeneticPopulation source{20, 30, 3};
+	GeneticPopulation destination{20, 30, 4};
+	for (GeneticPopulation* population : {&source, &destination}) {
+		for (std::size_t i = 0; i < population->size(); ++i) {
+			population->setFitness(i, static_cast<float>(i + 1));
+		}
+		population->evolve();
+	}
+	const Genomes before = destination.getGenomes();
+
+	destination.receiveMigrants(source, 3);
+
+	const Genomes genomes = destination.getGenomes();
+	BOOST_REQUIRE_EQUAL(genomes.size(), before.size());
+	for (std::size_t i = 0; i < genomes.size() - 3; ++i) {
+		BOOST_CHECK(genomes[i].weights == before[i].weights);
+	}
+	for (std::size_t i = 0; i < 3; ++i) {
+		const Genome& migrant = genomes[genomes.size() - 1 - i];
+		BOOST_CHECK(migrant.weights == source.getGenome(i).weights);
+		BOOST_CHECK(migrant.unchanged);
+		BOOST_CHECK_EQUAL(migrant.fitness, 20.f - i);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(steady_state_child_replaces_the_worst_known_genome) {
+	GeneticPopulation population{20, 30, 3};
+	//the first one is not simulated yet, so it can't be a parent or be replaced
+	for (std::size_t i = 1; i < population.size(); ++i) {
+		population.setFitness(i, static_cast<float>(i + 1));
+	}
+
+	Genome child = population.breedChild(0);
+	BOOST_CHECK_EQUAL(child.weights.size(), 30u);
+	BOOST_CHECK(population.breedChild(0).weights == child.weights);
+
+	child.fitness = 100.f;
+	population.replaceWorst(child);
+	const Genomes genomes = population.getGenomes();
+	BOOST_CHECK(genomes[1].weights == child.weights);
+	BOOST_CHECK(genomes[1].unchanged);
+	BOOST_CHECK_EQUAL(genomes[1].fitness, 100.f);
+	BOOST_CHECK(!genomes[0].unchanged);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
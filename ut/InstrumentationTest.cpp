@@ -0,0 +1,63 @@
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "Instrumentation.hpp"
+
+using namespace car;
+using namespace car::instrumentation;
+
+namespace {
+
+void timeEvolve() {
+	CAR_TIME_PHASE(evolve);
+}
+
+std::size_t countLines(const std::string& text) {
+	std::size_t lines = 0;
+	for (char c : text) {
+		lines += c == '\n';
+	}
+	return lines;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(InstrumentationTest)
+
+BOOST_AUTO_TEST_CASE(difference_of_totals) {
+	Totals left, right;
+	left.nanoseconds[1] = 50;
+	left.calls[1] = 3;
+	right.nanoseconds[1] = 20;
+	right.calls[1] = 1;
+	const Totals difference = left - right;
+	BOOST_CHECK_EQUAL(difference.nanoseconds[1], 30u);
+	BOOST_CHECK_EQUAL(difference.calls[1], 2u);
+	BOOST_CHECK_EQUAL(difference.calls[0], 0u);
+}
+
+BOOST_AUTO_TEST_CASE(calls_of_every_thread_are_collected) {
+	const Totals before = collect();
+	timeEvolve();
+	std::thread{timeEvolve}.join();
+	const Totals difference = collect() - before;
+
+	const std::size_t evolve = static_cast<std::size_t>(Phase::evolve);
+	BOOST_CHECK_EQUAL(difference.calls[evolve], isEnabled() ? 2u : 0u);
+	BOOST_CHECK_EQUAL(difference.calls[static_cast<std::size_t>(Phase::physics)], 0u);
+}
+
+BOOST_AUTO_TEST_CASE(phase_log_writes_a_line_per_generation) {
+	std::ostringstream out;
+	PhaseLog log{out};
+	log.write(1);
+	log.write(2);
+
+	const std::string text = out.str();
+	BOOST_CHECK_EQUAL(countLines(text), 3u);
+	BOOST_CHECK_EQUAL(text.substr(0, text.find(',')), "generation");
+	BOOST_CHECK(text.find("\n2,") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
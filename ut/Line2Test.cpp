@@ -527,6 +527,21 @@ BOOST_AUTO_TEST_CASE(nearestPoint_null_line) {
 	BOOST_CHECK_CLOSE(result.y, 1.f, 0.001);
 }
 
+BOOST_AUTO_TEST_CASE(getDistance_of_intersecting_lines) {
+	Line2f line1{{0.f, 0.f}, {2.f, 2.f}};
+	Line2f line2{{0.f, 2.f}, {2.f, 0.f}};
+
+	BOOST_CHECK_EQUAL(getDistance(line1, line2), 0.f);
+}
+
+BOOST_AUTO_TEST_CASE(getDistance_of_separate_lines) {
+	Line2f line1{{0.f, 0.f}, {4.f, 0.f}};
+	Line2f line2{{2.f, 1.f}, {6.f, 3.f}};
+
+	BOOST_CHECK_CLOSE(getDistance(line1, line2), 1.f, 0.001);
+	BOOST_CHECK_CLOSE(getDistance(line2, line1), 1.f, 0.001);
+}
+
 
 
 BOOST_AUTO_TEST_SUITE_END()
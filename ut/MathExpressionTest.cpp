@@ -3,6 +3,7 @@
 
 #include "MathExpression.hpp"
 
+#include <cmath>
 #include <sstream>
 
 using namespace car;
@@ -161,6 +162,80 @@ BOOST_AUTO_TEST_CASE(test_output_7) {
 	BOOST_CHECK_EQUAL(ss.str(), "3+3+4");
 }
 
+namespace {
+
+void checkCompiledMatchesTree(const std::string& input) {
+	const SymbolSlots symbols{"x", "y", "z"};
+	const FormulaValue values[][3] = {{0, 0, 0.25f}, {1, 2, 3}, {-2.5f, 7, 0.5f}, {3, 3, -1}};
+
+	MathExpression expression = parseMathExpression(input);
+	CompiledMathExpression compiled{expression, symbols};
+	for (const auto& slots : values) {
+		SymbolTable symbolTable{{"x", slots[0]}, {"y", slots[1]}, {"z", slots[2]}};
+		BOOST_CHECK_EQUAL(compiled.evaluate(slots), evaluateMathExpression(expression, symbolTable));
+	}
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(test_compiled_matches_tree_evaluation) {
+	checkCompiledMatchesTree("2");
+	checkCompiledMatchesTree("x");
+	checkCompiledMatchesTree("-x");
+	checkCompiledMatchesTree("x+y*z");
+	checkCompiledMatchesTree("(x-y)/z");
+	checkCompiledMatchesTree("x<y + (x<=y)*2 + (x>z)*4 + (x>=z)*8");
+	checkCompiledMatchesTree("2 3 x - -y");
+	checkCompiledMatchesTree("0.5*x + (z > y)*(100*y + 2*(z-y)) + (z <= y)*(100*z)");
+	checkCompiledMatchesTree("(1+2)*x - 4/8 + -(3*3)");
+}
+
+BOOST_AUTO_TEST_CASE(test_compiled_constant_folding) {
+	CompiledMathExpression compiled{parseMathExpression("(1+2)*-4 + (3 < 4)"), SymbolSlots{}};
+	BOOST_CHECK(compiled.isConstant());
+	BOOST_CHECK_EQUAL(compiled.evaluate(nullptr), FormulaValue(-11));
+
+	BOOST_CHECK(!CompiledMathExpression(parseMathExpression("1+x"), SymbolSlots{"x"}).isConstant());
+}
+
+BOOST_AUTO_TEST_CASE(test_compiled_interval_evaluation) {
+	const SymbolSlots symbols{"x", "y"};
+	const FormulaInterval slots[] = {FormulaInterval{-1, 2}, FormulaInterval{3, 4}};
+	auto evaluate = [&](const std::string& input) {
+		return CompiledMathExpression(parseMathExpression(input), symbols).evaluateInterval(slots);
+	};
+
+	FormulaInterval result = evaluate("x*y - 1");
+	BOOST_CHECK_EQUAL(result.lower, -5);
+	BOOST_CHECK_EQUAL(result.upper, 7);
+	result = evaluate("-x / y");
+	BOOST_CHECK_EQUAL(result.lower, -2.f/3);
+	BOOST_CHECK_EQUAL(result.upper, 1.f/3);
+	result = evaluate("x * (x < 1)");
+	BOOST_CHECK_EQUAL(result.lower, -1);
+	BOOST_CHECK_EQUAL(result.upper, 2);
+	result = evaluate("(x < y) + (y >= 5)");
+	BOOST_CHECK_EQUAL(result.lower, 1);
+	BOOST_CHECK_EQUAL(result.upper, 1);
+	result = evaluate("y / x");
+	BOOST_CHECK(std::isinf(result.lower) && std::isinf(result.upper));
+	BOOST_CHECK_LT(result.lower, result.upper);
+}
+
+BOOST_AUTO_TEST_CASE(test_compiled_unknown_symbol) {
+	BOOST_CHECK_THROW(CompiledMathExpression(parseMathExpression("x+w"), SymbolSlots{"x"}),
+			FormulaException);
+}
+
+BOOST_AUTO_TEST_CASE(test_compiled_deep_expression) {
+	//right associative additions need a value on the stack for every level
+	std::string input = "x";
+	for (int i = 0; i < 50; ++i) {
+		input = "x+(" + input + ")";
+	}
+	checkCompiledMatchesTree(input);
+}
+
 
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,10 +1,51 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <cmath>
+#include <sstream>
+
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+
 #include "NeuralNetwork.hpp"
 
 using namespace car;
 
+namespace {
+
+//NeuralNetwork(1, 2, 2, 1, false) saved when every neuron stored its own weights
+const std::string oldNetworkArchive =
+	"22 serialization::archive 18 0 0 2 0 0 2 0 0 0 0 0 2 0 0 0 3 0 "
+	"1.250000000e-01 -2.500000000e-01 3.750000000e-01 0 1 0 3 0 "
+	"-5.000000000e-01 6.250000000e-01 -7.500000000e-01 0 1 0 3 0 "
+	"8.750000000e-01 -1.000000000e+00 1.125000000e+00 0\n";
+
+//NeuralNetwork(1, 2, 2, 1, true) saved when every neuron stored its own weights
+const std::string oldRecurrentNetworkArchive =
+	"22 serialization::archive 18 0 0 2 0 0 2 0 0 0 0 0 2 0 0 0 4 0 "
+	"1.250000000e-01 -2.500000000e-01 3.750000000e-01 -5.000000000e-01 0 1 1 0.000000000e+00 4 0 "
+	"6.250000000e-01 -7.500000000e-01 8.750000000e-01 -1.000000000e+00 1 0.000000000e+00 1 0 4 0 "
+	"1.125000000e+00 -1.250000000e+00 1.375000000e+00 -1.500000000e+00 1 0.000000000e+00\n";
+
+NeuralNetwork loadNetwork(const std::string& archive) {
+	NeuralNetwork network;
+	std::istringstream ss{archive};
+	boost::archive::text_iarchive ia(ss);
+	ia >> network;
+	return network;
+}
+
+std::string saveNetwork(const NeuralNetwork& network) {
+	std::ostringstream ss;
+	{
+		boost::archive::text_oarchive oa(ss);
+		oa << network;
+	}
+	return ss.str();
+}
+
+}
+
 BOOST_AUTO_TEST_SUITE(NeuralNetworkTest)
 
 BOOST_AUTO_TEST_CASE(getWeight_returns_correct_value_0_hidderlayer) {
@@ -28,5 +69,149 @@ BOOST_AUTO_TEST_CASE(getWeight_returns_correct_value_2_hidderlayer) {
 	BOOST_CHECK_EQUAL(nn.getWeightCount(), 3*2 + 3*2 + 3*3);
 }
 
+BOOST_AUTO_TEST_CASE(getWeightCountForNetwork_matches_network) {
+	for (bool useRecurrence : {false, true}) {
+		for (unsigned hiddenLayerCount = 0; hiddenLayerCount < 4; ++hiddenLayerCount) {
+			NeuralNetwork nn(hiddenLayerCount, 5, 7, 3, useRecurrence);
+			BOOST_CHECK_EQUAL(nn.getWeightCount(), nn.getWeights().size());
+			BOOST_CHECK_EQUAL(nn.getWeightCount(),
+					NeuralNetwork::getWeightCountForNetwork(hiddenLayerCount, 5, 7, 3, useRecurrence));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(old_archive_is_loaded_and_evaluated) {
+	NeuralNetwork nn = loadNetwork(oldNetworkArchive);
+
+	BOOST_REQUIRE_EQUAL(nn.getInputNeuronCount(), 2);
+	BOOST_REQUIRE_EQUAL(nn.getOutputNeuronCount(), 1);
+	BOOST_CHECK_EQUAL(nn.getWeightCount(), 9);
+
+	Weights input{0.5f, -0.25f};
+	BOOST_CHECK_CLOSE(nn.evaluateInput(input)[0], -0.608735f, 0.001);
+	BOOST_CHECK_CLOSE(nn.evaluateInput(input)[0], -0.608735f, 0.001);
+}
+
+BOOST_AUTO_TEST_CASE(old_recurrent_archive_is_loaded_and_evaluated) {
+	NeuralNetwork nn = loadNetwork(oldRecurrentNetworkArchive);
+
+	BOOST_REQUIRE_EQUAL(nn.getInputNeuronCount(), 2);
+	BOOST_REQUIRE_EQUAL(nn.getOutputNeuronCount(), 1);
+	BOOST_CHECK_EQUAL(nn.getWeightCount(), 12);
+
+	Weights input{0.5f, -0.25f};
+	BOOST_CHECK_CLOSE(nn.evaluateInput(input)[0], 0.54185f, 0.001);
+	BOOST_CHECK_CLOSE(nn.evaluateInput(input)[0], 0.654863f, 0.001);
+}
+
+BOOST_AUTO_TEST_CASE(saved_archive_format_is_unchanged) {
+	BOOST_CHECK_EQUAL(saveNetwork(loadNetwork(oldNetworkArchive)), oldNetworkArchive);
+	BOOST_CHECK_EQUAL(saveNetwork(loadNetwork(oldRecurrentNetworkArchive)), oldRecurrentNetworkArchive);
+}
+
+BOOST_AUTO_TEST_CASE(weights_view_gives_same_result_as_copied_weights) {
+	NeuralNetwork copied(2, 13, 17, 3, false);
+	NeuralNetwork viewed = copied;
+
+	Weights weights(copied.getWeightCount());
+	for (std::size_t i = 0; i < weights.size(); ++i) {
+		weights[i] = std::sin(static_cast<float>(i));
+	}
+	copied.setWeights(weights);
+	viewed.setWeightsView(weights.data());
+
+	BOOST_CHECK(viewed.getWeights() == weights);
+
+	Weights input(17);
+	for (std::size_t i = 0; i < input.size(); ++i) {
+		input[i] = std::cos(static_cast<float>(i));
+	}
+	Weights expected = copied.evaluateInput(input);
+	Weights result = viewed.evaluateInput(input);
+	BOOST_REQUIRE_EQUAL(result.size(), 3);
+	for (std::size_t i = 0; i < result.size(); ++i) {
+		BOOST_CHECK_EQUAL(result[i], expected[i]);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(evaluating_inputs_together_gives_same_result_as_one_by_one) {
+	const std::size_t count = 7; //not a multiple of the SIMD batch
+	NeuralNetwork batched(2, 13, 17, 3, true);
+
+	Weights weights(batched.getWeightCount());
+	for (std::size_t i = 0; i < weights.size(); ++i) {
+		weights[i] = std::sin(static_cast<float>(i));
+	}
+	batched.setWeights(weights);
+	std::vector<NeuralNetwork> networks(count, batched);
+
+	std::vector<Weights> states(count, Weights(batched.getRecurrentStateSize()));
+	std::vector<Weight*> statePointers;
+	for (Weights& state : states) {
+		statePointers.push_back(state.data());
+	}
+
+	//a few steps, so the recurrent states are used
+	for (int step = 0; step < 3; ++step) {
+		Weights inputs(count * 17);
+		for (std::size_t i = 0; i < inputs.size(); ++i) {
+			inputs[i] = std::cos(static_cast<float>(i + step));
+		}
+		Weights result = batched.evaluateInputs(inputs.data(), count, statePointers.data());
+		BOOST_REQUIRE_EQUAL(result.size(), count * 3);
+
+		for (std::size_t i = 0; i < count; ++i) {
+			Weights input(inputs.begin() + i*17, inputs.begin() + (i + 1)*17);
+			Weights expected = networks[i].evaluateInput(input);
+			for (std::size_t j = 0; j < 3; ++j) {
+				BOOST_CHECK_EQUAL(result[i*3 + j], expected[j]);
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(evaluating_lanes_gives_same_result_as_one_by_one) {
+	const std::size_t width = NeuralNetwork::laneWidth;
+	NeuralNetwork prototype(2, 13, 17, 3, true);
+	const std::size_t weightCount = prototype.getWeightCount();
+	const std::size_t stateCount = prototype.getRecurrentStateSize();
+
+	//every lane has different weights
+	std::vector<NeuralNetwork> networks;
+	Weights laneWeights(weightCount * width);
+	for (std::size_t l = 0; l < width; ++l) {
+		Weights weights(weightCount);
+		for (std::size_t i = 0; i < weightCount; ++i) {
+			weights[i] = std::sin(static_cast<float>(i + 100*l));
+			laneWeights[i*width + l] = weights[i];
+		}
+		networks.push_back(prototype);
+		networks.back().setWeights(weights);
+	}
+	Weights laneStates(stateCount * width);
+
+	//a few steps, so the recurrent states are used
+	for (int step = 0; step < 3; ++step) {
+		Weights laneInputs(17 * width);
+		for (std::size_t i = 0; i < laneInputs.size(); ++i) {
+			laneInputs[i] = std::cos(static_cast<float>(i + step));
+		}
+		Weights result = prototype.evaluateLanes(laneWeights.data(), laneInputs.data(),
+				laneStates.data());
+		BOOST_REQUIRE_EQUAL(result.size(), 3 * width);
+
+		for (std::size_t l = 0; l < width; ++l) {
+			Weights input(17);
+			for (std::size_t i = 0; i < input.size(); ++i) {
+				input[i] = laneInputs[i*width + l];
+			}
+			Weights expected = networks[l].evaluateInput(input);
+			for (std::size_t j = 0; j < 3; ++j) {
+				BOOST_CHECK_EQUAL(result[j*width + l], expected[j]);
+			}
+		}
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
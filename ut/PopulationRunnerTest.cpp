@@ -0,0 +1,99 @@
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+
+#include "PopulationRunner.hpp"
+#include "Track/createCircleTrack.hpp"
+
+using namespace car;
+
+namespace {
+
+std::vector<track::TrackPtr> createTracks() {
+	auto track = std::make_shared<const track::Track>(
+			track::createCircleTrack(track::CircleTrackParams{}));
+	return {track, track};
+}
+
+//Runs two generations with and without racing, and checks that racing
+//pruned some genomes but kept the same elites.
+void checkRacingKeepsElites(const std::string& fitnessExpression) {
+	Parameters parameters;
+	parameters.populationSize = 40;
+	parameters.fitnessExpression = parseMathExpression(fitnessExpression);
+	TaskScheduler scheduler{2};
+	PopulationRunner runner{parameters, createTracks(), scheduler, 1};
+	parameters.racing = true;
+	PopulationRunner racingRunner{parameters, createTracks(), scheduler, 1};
+
+	//the first generation has no exact fitness to prune by
+	for (int i = 0; i < 2; ++i) {
+		runner.runIteration();
+		racingRunner.runIteration();
+	}
+	BOOST_CHECK_GT(racingRunner.getStatistics().prunedGenomes, 0u);
+	BOOST_CHECK_LT(racingRunner.getStatistics().carSteps, runner.getStatistics().carSteps);
+	BOOST_CHECK_EQUAL(racingRunner.getBestFitness(), runner.getBestFitness());
+
+	//evolve() put the elites to the front
+	const GeneticPopulation& population = runner.getPopulation();
+	const GeneticPopulation& racingPopulation = racingRunner.getPopulation();
+	for (std::size_t i = 0; i < population.getEliteCount(); ++i) {
+		BOOST_CHECK_EQUAL(racingPopulation.getFitness(i), population.getFitness(i));
+		BOOST_CHECK(std::equal(population.getWeights(i), population.getWeights(i) + population.getWeightCount(),
+				racingPopulation.getWeights(i)));
+	}
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(PopulationRunnerTest)
+
+BOOST_AUTO_TEST_CASE(every_genome_is_simulated_fully_without_prescreen) {
+	Parameters parameters;
+	parameters.populationSize = 20;
+	TaskScheduler scheduler{2};
+	PopulationRunner runner{parameters, createTracks(), scheduler, 1};
+	runner.runIteration();
+
+	const PopulationRunner::Statistics& statistics = runner.getStatistics();
+	BOOST_CHECK_EQUAL(statistics.simulatedGenomes, 20u);
+	BOOST_CHECK_EQUAL(statistics.rejectedGenomes, 0u);
+	BOOST_CHECK_EQUAL(statistics.prescreenCarSteps, 0u);
+	BOOST_CHECK_EQUAL(statistics.savedCarSteps, 0);
+	BOOST_CHECK_GT(statistics.carSteps, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(only_the_best_of_the_prescreen_are_simulated_fully) {
+	Parameters parameters;
+	parameters.populationSize = 20;
+	parameters.prescreenSeconds = 1.f;
+	parameters.prescreenFraction = 0.25f;
+	TaskScheduler scheduler{2};
+	PopulationRunner runner{parameters, createTracks(), scheduler, 1};
+	runner.runIteration();
+
+	const PopulationRunner::Statistics& statistics = runner.getStatistics();
+	BOOST_CHECK_EQUAL(statistics.simulatedGenomes, 20u);
+	BOOST_CHECK_EQUAL(statistics.rejectedGenomes, 15u);
+	//at most a second of 64 steps for each genome on 1 track
+	BOOST_CHECK_GT(statistics.prescreenCarSteps, 0u);
+	BOOST_CHECK_LE(statistics.prescreenCarSteps, 20u * 65u);
+	BOOST_CHECK_GT(statistics.carSteps, statistics.prescreenCarSteps);
+	BOOST_CHECK(runner.getBestGenome() != nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(racing_keeps_the_elites_of_the_full_simulation) {
+	//the bound of a track is 1, so a genome which scored 0 on a track is
+	//pruned once the elites scored 1 on both
+	checkRacingKeepsElites("ccps > 2");
+}
+
+BOOST_AUTO_TEST_CASE(racing_keeps_the_elites_with_negative_fitness) {
+	//The bound of a track is -9, so the fitness of a pruned genome is lower
+	//than what it got on the raced tracks. The elites are only kept if its
+	//estimate isn't above the fitness of the elites.
+	checkRacingKeepsElites("(ccps > 2) - 10");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
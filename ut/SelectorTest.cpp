@@ -0,0 +1,74 @@
+#include <boost/test/unit_test.hpp>
+
+#include "Selector.hpp"
+
+using namespace car;
+
+namespace {
+
+const int sampleCount = 100000;
+
+std::vector<double> getFrequencies(Selector& selector, const std::vector<float>& fitnesses) {
+	selector.prepare(fitnesses);
+	RandomEngine engine{42};
+	std::vector<double> frequencies(fitnesses.size());
+	for (int i = 0; i < sampleCount; ++i) {
+		frequencies[selector.pick(engine)] += 1.0 / sampleCount;
+	}
+	return frequencies;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(SelectorTest)
+
+BOOST_AUTO_TEST_CASE(roulette_is_proportional_to_fitness) {
+	Selector selector{SelectionMethod::roulette};
+	std::vector<float> fitnesses{1.f, 0.f, 4.f, 3.f, 2.f};
+	std::vector<double> frequencies = getFrequencies(selector, fitnesses);
+
+	for (std::size_t i = 0; i < fitnesses.size(); ++i) {
+		BOOST_TEST_MESSAGE("genome " << i);
+		BOOST_CHECK_SMALL(frequencies[i] - fitnesses[i] / 10.0, 0.01);
+	}
+	BOOST_CHECK_EQUAL(frequencies[1], 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(roulette_treats_negative_fitness_as_zero) {
+	Selector selector{SelectionMethod::roulette};
+	std::vector<double> frequencies = getFrequencies(selector, {-5.f, 1.f, 1.f});
+
+	BOOST_CHECK_EQUAL(frequencies[0], 0.0);
+	BOOST_CHECK_SMALL(frequencies[1] - 0.5, 0.01);
+}
+
+BOOST_AUTO_TEST_CASE(roulette_without_fitness_is_uniform) {
+	Selector selector{SelectionMethod::roulette};
+	std::vector<double> frequencies = getFrequencies(selector, {0.f, 0.f, 0.f, 0.f});
+
+	for (double frequency : frequencies) {
+		BOOST_CHECK_SMALL(frequency - 0.25, 0.01);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(rank_is_proportional_to_the_rank) {
+	Selector selector{SelectionMethod::rank};
+	//ranks: 2, 4, 1, 3
+	std::vector<double> frequencies = getFrequencies(selector, {5.f, 1000.f, -3.f, 6.f});
+
+	BOOST_CHECK_SMALL(frequencies[0] - 0.2, 0.01);
+	BOOST_CHECK_SMALL(frequencies[1] - 0.4, 0.01);
+	BOOST_CHECK_SMALL(frequencies[2] - 0.1, 0.01);
+	BOOST_CHECK_SMALL(frequencies[3] - 0.3, 0.01);
+}
+
+BOOST_AUTO_TEST_CASE(tournament_prefers_the_better_ones) {
+	Selector selector{SelectionMethod::tournament, 3};
+	//the best of 3 picks from 4 is the worst one only if all of them are
+	std::vector<double> frequencies = getFrequencies(selector, {1.f, 2.f, 3.f, 4.f});
+
+	BOOST_CHECK_SMALL(frequencies[0] - 1.0/64, 0.01);
+	BOOST_CHECK_SMALL(frequencies[3] - 37.0/64, 0.01);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,89 @@
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+
+#include "SteadyStateRunner.hpp"
+#include "Track/createCircleTrack.hpp"
+
+using namespace car;
+
+namespace {
+
+std::vector<track::TrackPtr> createTracks() {
+	return {std::make_shared<const track::Track>(
+			track::createCircleTrack(track::CircleTrackParams{}))};
+}
+
+float simulate(const Parameters& parameters, const Weights& weights) {
+	BatchSimulator simulator{parameters, createTracks()};
+	simulator.addCar(weights.data());
+	simulator.run();
+	return simulator.getFitness(0);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(SteadyStateRunnerTest)
+
+BOOST_AUTO_TEST_CASE(every_genome_gets_fitness_with_worker_threads) {
+	Parameters parameters;
+	parameters.populationSize = 12;
+	TaskScheduler scheduler{3};
+	SteadyStateRunner runner{parameters, createTracks(), scheduler, 1};
+	runner.start();
+	runner.waitForEvaluations(30);
+	runner.stop();
+
+	const Genomes genomes = runner.getGenomes();
+	BOOST_REQUIRE_EQUAL(genomes.size(), 12u);
+	for (const Genome& genome : genomes) {
+		BOOST_CHECK(genome.unchanged);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(waiting_thread_runs_the_simulations_without_workers) {
+	Parameters parameters;
+	parameters.populationSize = 10;
+	TaskScheduler scheduler{0};
+	SteadyStateRunner runner{parameters, createTracks(), scheduler, 2};
+	runner.start();
+	runner.waitForEvaluations(10);
+	runner.waitForEvaluations(5);
+
+	const Genomes genomes = runner.getGenomes();
+	for (const Genome& genome : genomes) {
+		BOOST_CHECK(genome.unchanged);
+	}
+	//destroyed while the simulations are running
+}
+
+BOOST_AUTO_TEST_CASE(evaluated_starting_population_keeps_the_right_fitnesses) {
+	Parameters parameters;
+	parameters.populationSize = 12;
+	TaskScheduler scheduler{2};
+	SteadyStateRunner runner{parameters, createTracks(), scheduler, 3};
+
+	//as restored from a checkpoint
+	Genomes genomes = runner.getGenomes();
+	for (Genome& genome : genomes) {
+		genome.fitness = simulate(parameters, genome.weights);
+		genome.unchanged = true;
+	}
+	//the worst ones last, so the children would replace them while they
+	//were simulated again
+	std::stable_sort(genomes.begin(), genomes.end(), [](const Genome& left, const Genome& right) {
+			return left.fitness > right.fitness;
+		});
+	runner.getPopulation().setGenomes(genomes);
+
+	runner.start();
+	runner.waitForEvaluations(40);
+	runner.stop();
+
+	for (const Genome& genome : runner.getGenomes()) {
+		BOOST_CHECK(genome.unchanged);
+		BOOST_CHECK_EQUAL(genome.fitness, simulate(parameters, genome.weights));
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,148 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "TaskScheduler.hpp"
+
+using namespace car;
+
+namespace {
+
+void checkEveryIndexRunsOnce(std::size_t numThreads) {
+	TaskScheduler scheduler{numThreads};
+	std::vector<std::atomic<int>> counts(1000);
+	for (auto& count : counts) {
+		count = 0;
+	}
+
+	scheduler.parallelFor(0, counts.size(), [&](std::size_t i) { ++counts[i]; });
+
+	for (std::size_t i = 0; i < counts.size(); ++i) {
+		BOOST_CHECK_EQUAL(counts[i], 1);
+	}
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(TaskSchedulerTest)
+
+BOOST_AUTO_TEST_CASE(parallelFor_without_worker_threads) {
+	checkEveryIndexRunsOnce(0);
+}
+
+BOOST_AUTO_TEST_CASE(parallelFor_with_one_worker_thread) {
+	checkEveryIndexRunsOnce(1);
+}
+
+BOOST_AUTO_TEST_CASE(parallelFor_with_many_worker_threads) {
+	checkEveryIndexRunsOnce(8);
+}
+
+BOOST_AUTO_TEST_CASE(parallelFor_with_empty_range) {
+	TaskScheduler scheduler{2};
+	bool called = false;
+	scheduler.parallelFor(5, 5, [&](std::size_t) { called = true; });
+	BOOST_CHECK(!called);
+}
+
+BOOST_AUTO_TEST_CASE(nested_parallelFor) {
+	TaskScheduler scheduler{4};
+	std::atomic<int> sum{0};
+	scheduler.parallelFor(0, 10, [&](std::size_t i) {
+			scheduler.parallelFor(0, 10, [&](std::size_t j) { sum += i * 10 + j; });
+		});
+	BOOST_CHECK_EQUAL(sum, 4950);
+}
+
+BOOST_AUTO_TEST_CASE(parallelFor_rethrows_exception_after_every_task_finished) {
+	TaskScheduler scheduler{4};
+	std::atomic<int> finished{0};
+	BOOST_CHECK_THROW(scheduler.parallelFor(0, 100, [&](std::size_t i) {
+			++finished;
+			if (i == 10) {
+				throw std::runtime_error{"error"};
+			}
+		}), std::runtime_error);
+	BOOST_CHECK_EQUAL(finished, 100);
+}
+
+BOOST_AUTO_TEST_CASE(posted_tasks_are_run) {
+	CompletionLatch latch{50};
+	std::atomic<int> count{0};
+	{
+		TaskScheduler scheduler{3};
+		for (int i = 0; i < 50; ++i) {
+			scheduler.post([&] {
+					++count;
+					latch.countDown();
+				});
+		}
+		scheduler.wait(latch);
+	}
+	BOOST_CHECK_EQUAL(count, 50);
+	BOOST_CHECK(latch.isDone());
+}
+
+//The latches are destroyed right after wait() returns, while the task which
+//counted down last may just be finishing. Meant for the asan and tsan builds.
+BOOST_AUTO_TEST_CASE(waiting_thread_runs_tasks_posted_while_it_sleeps) {
+	TaskScheduler scheduler{1};
+	CompletionLatch latch{1};
+	std::atomic<bool> started{false};
+	std::atomic<bool> childDone{false};
+	std::thread::id childThread;
+
+	//keeps the only worker busy until the child task is run by someone else
+	scheduler.post([&] {
+			started = true;
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			scheduler.post([&] {
+					childThread = std::this_thread::get_id();
+					childDone = true;
+				});
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+			while (!childDone && std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::yield();
+			}
+			latch.countDown();
+		});
+	while (!started) {
+		std::this_thread::yield();
+	}
+	scheduler.wait(latch);
+
+	BOOST_CHECK(childDone);
+	BOOST_CHECK(childThread == std::this_thread::get_id());
+}
+
+BOOST_AUTO_TEST_CASE(short_lived_latches_can_be_destroyed_after_wait) {
+	TaskScheduler scheduler{3};
+	std::atomic<int> count{0};
+	for (int i = 0; i < 20000; ++i) {
+		std::unique_ptr<CompletionLatch> latch{new CompletionLatch{2}};
+		for (int j = 0; j < 2; ++j) {
+			scheduler.post([&count, &latch] {
+					++count;
+					latch->countDown();
+				});
+		}
+		scheduler.wait(*latch);
+	}
+	BOOST_CHECK_EQUAL(count, 40000);
+}
+
+BOOST_AUTO_TEST_CASE(latch_can_be_destroyed_after_its_own_wait) {
+	TaskScheduler scheduler{2};
+	for (int i = 0; i < 20000; ++i) {
+		std::unique_ptr<CompletionLatch> latch{new CompletionLatch{1}};
+		scheduler.post([&latch] { latch->countDown(); });
+		latch->wait();
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
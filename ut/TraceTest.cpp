@@ -0,0 +1,70 @@
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include "Trace.hpp"
+
+using namespace car;
+
+namespace {
+
+std::string readFile(const std::string& fileName) {
+	std::ifstream ifs(fileName);
+	return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+std::size_t countOccurrences(const std::string& text, const std::string& pattern) {
+	std::size_t count = 0;
+	for (std::size_t i = text.find(pattern); i != std::string::npos; i = text.find(pattern, i + 1)) {
+		++count;
+	}
+	return count;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(TraceTest)
+
+BOOST_AUTO_TEST_CASE(nothing_is_recorded_without_trace_file) {
+	BOOST_CHECK(!trace::isRecording());
+	trace::Scope scope{"not recorded"};
+}
+
+BOOST_AUTO_TEST_CASE(events_of_every_thread_are_written) {
+	const std::string fileName = "TraceTest.json";
+	{
+		trace::Scope before{"before"};
+		trace::TraceFile traceFile{fileName};
+		BOOST_CHECK(trace::isRecording());
+		{
+			trace::Scope scope{"main phase"};
+		}
+		traceFile.flush();
+		const std::string flushed = readFile(fileName);
+		BOOST_CHECK_EQUAL(countOccurrences(flushed, "\"main phase\""), 2u);
+
+		std::thread{[] {
+				trace::setThreadName("test worker");
+				//more than a chunk of the buffer
+				for (int i = 0; i < 5000; ++i) {
+					trace::Scope scope{"worker task"};
+				}
+			}}.join();
+	}
+	BOOST_CHECK(!trace::isRecording());
+
+	const std::string text = readFile(fileName);
+	std::remove(fileName.c_str());
+	BOOST_CHECK_EQUAL(text.front(), '[');
+	BOOST_CHECK_EQUAL(text.substr(text.size() - 3), "\n]\n");
+	BOOST_CHECK_EQUAL(countOccurrences(text, "\"main phase\""), 2u);
+	BOOST_CHECK_EQUAL(countOccurrences(text, "\"worker task\",\"ph\":\"B\""), 5000u);
+	BOOST_CHECK_EQUAL(countOccurrences(text, "\"worker task\",\"ph\":\"E\""), 5000u);
+	BOOST_CHECK_EQUAL(countOccurrences(text, "\"test worker\""), 1u);
+	BOOST_CHECK_EQUAL(countOccurrences(text, "\"before\""), 0u);
+	BOOST_CHECK_EQUAL(countOccurrences(text, "\"not recorded\""), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
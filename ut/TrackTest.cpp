@@ -0,0 +1,142 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/math/constants/constants.hpp>
+#include "Track/Track.hpp"
+#include "Track/createCircleTrack.hpp"
+#include "Track/createPolygonTrack.hpp"
+
+using namespace car;
+using namespace car::track;
+
+namespace {
+
+//The same lines without the grid, so every query checks every line
+Track copyWithoutGrid(const Track& track) {
+	Track result;
+	for (std::size_t i = 0; i < track.getNumberOfLines(); ++i) {
+		result.addLine(track.getLine(i));
+	}
+	return result;
+}
+
+void checkRaysMatch(const Track& track) {
+	using namespace boost::math::float_constants;
+
+	Track reference = copyWithoutGrid(track);
+	sf::FloatRect dimensions = track.getDimensions();
+
+	const int steps = 23;
+	const int directions = 17;
+	for (int i = 0; i <= steps; ++i) {
+		for (int j = 0; j <= steps; ++j) {
+			sf::Vector2f origin{
+				dimensions.left - 10.f + (dimensions.width + 20.f) * i / steps,
+				dimensions.top - 10.f + (dimensions.height + 20.f) * j / steps};
+
+			for (int k = 0; k < directions; ++k) {
+				sf::Vector2f direction{std::cos(2*pi*k/directions), std::sin(2*pi*k/directions)};
+				sf::Vector2f expected = reference.collideWithRay(origin, direction, 50.f);
+				sf::Vector2f result = track.collideWithRay(origin, direction, 50.f);
+				BOOST_CHECK_SMALL(getDistance(expected, result), 0.001f);
+
+				Line2f line{origin, origin + direction * 3.f};
+				BOOST_CHECK_EQUAL(track.collidesWith(line), reference.collidesWith(line));
+
+				//starting from a ratio before the first crossing doesn't change it
+				const float startRatio = 0.3f;
+				const sf::Vector2f ray = direction * 50.f;
+				float expectedRatio = 0.f;
+				float ratio = 0.f;
+				reference.castRays(1, &origin.x, &origin.y, &ray.x, &ray.y, 0.f, &expectedRatio);
+				track.castRays(1, &origin.x, &origin.y, &ray.x, &ray.y, startRatio, &ratio);
+				if (expectedRatio > startRatio) {
+					BOOST_CHECK_EQUAL(ratio, expectedRatio);
+				}
+			}
+		}
+	}
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(TrackTest)
+
+BOOST_AUTO_TEST_CASE(circle_track_grid_gives_same_results_as_line_scan) {
+	checkRaysMatch(createCircleTrack(CircleTrackParams{}));
+}
+
+BOOST_AUTO_TEST_CASE(huge_circle_track_grid_gives_same_results_as_line_scan) {
+	CircleTrackParams params;
+	params.innerRadius = 300.f;
+	params.outerRadius = 310.f;
+	params.resolution = 600;
+	checkRaysMatch(createCircleTrack(params));
+}
+
+BOOST_AUTO_TEST_CASE(polygon_track_grid_gives_same_results_as_line_scan) {
+	checkRaysMatch(createPolygonTrack(5.f, 5.f, {
+			{-55.f, 45.f}, {-45.f, 55.f}, {-30.f, 55.f}, {-15.f, 35.f}, {15.f, 35.f},
+			{45.f, 55.f}, {55.f, 45.f}, {55.f, -10.f}, {45.f, -45.f}, {-45.f, -45.f}}));
+}
+
+BOOST_AUTO_TEST_CASE(lines_near_an_area_give_same_results_as_track) {
+	Track track = createCircleTrack(CircleTrackParams{});
+	//between the outer and the inner circle
+	const sf::FloatRect dimensions = track.getDimensions();
+	const sf::Vector2f center{dimensions.left + 5.f, dimensions.top + dimensions.height/2};
+	LineArrays lines;
+	track.getLinesNear(sf::FloatRect{center.x - 20.f, center.y - 20.f, 40.f, 40.f}, lines);
+	BOOST_CHECK_LT(lines.size(), track.getNumberOfLines());
+
+	int crossingCount = 0;
+	for (int k = 0; k < 32; ++k) {
+		const sf::Vector2f ray{10.f*std::cos(k/5.f), 10.f*std::sin(k/5.f)};
+		float expected = 0.f;
+		track.castRays(1, &center.x, &center.y, &ray.x, &ray.y, 0.f, &expected);
+		float ratio = 1.f;
+		for (std::size_t j = 0; j < lines.size(); ++j) {
+			ratio = std::min(ratio, getCrossingRatio(center.x, center.y, ray.x, ray.y,
+					lines.startX[j], lines.startY[j], lines.deltaX[j], lines.deltaY[j]));
+		}
+		BOOST_CHECK_EQUAL(ratio, expected);
+		crossingCount += expected < 1.f;
+	}
+	BOOST_CHECK_GT(crossingCount, 0);
+}
+
+BOOST_AUTO_TEST_CASE(ray_without_wall_returns_max_distance) {
+	Track track = createCircleTrack(CircleTrackParams{});
+	sf::Vector2f result = track.collideWithRay({1000.f, 1000.f}, {1.f, 0.f}, 50.f);
+	BOOST_CHECK_CLOSE(result.x, 1050.f, 0.001);
+	BOOST_CHECK_CLOSE(result.y, 1000.f, 0.001);
+}
+
+BOOST_AUTO_TEST_CASE(ray_stops_at_nearest_wall) {
+	Track track = createCircleTrack(CircleTrackParams{});
+	sf::Vector2f result = track.collideWithRay({55.f, 0.f}, {-1.f, 0.f}, 200.f);
+	BOOST_CHECK_CLOSE(getLength(result), 50.f, 1.0);
+	BOOST_CHECK_GT(result.x, 0.f);
+}
+
+BOOST_AUTO_TEST_CASE(check_accepts_valid_tracks) {
+	CircleTrackParams params;
+	params.resolution = 600;
+	Track track = createCircleTrack(params);
+	BOOST_CHECK_NO_THROW(track.check());
+	BOOST_CHECK_NO_THROW(copyWithoutGrid(track).check());
+}
+
+BOOST_AUTO_TEST_CASE(check_finds_intersection_of_distant_lines) {
+	Track track = createCircleTrack(CircleTrackParams{});
+	track.addLine(Line2f{{-100.f, 0.f}, {100.f, 0.f}});
+	track.buildLineGrid();
+	BOOST_CHECK_THROW(track.check(), TrackError);
+	BOOST_CHECK_THROW(copyWithoutGrid(track).check(), TrackError);
+}
+
+BOOST_AUTO_TEST_CASE(check_finds_short_line) {
+	Track track = createCircleTrack(CircleTrackParams{});
+	track.addLine(Line2f{{200.f, 200.f}, {200.f, 200.001f}});
+	BOOST_CHECK_THROW(track.check(), TrackError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
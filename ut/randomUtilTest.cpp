@@ -0,0 +1,49 @@
+#include <boost/test/unit_test.hpp>
+#include "randomUtil.hpp"
+
+using namespace car;
+
+BOOST_AUTO_TEST_SUITE(randomUtilTest)
+
+BOOST_AUTO_TEST_CASE(same_seed_gives_same_numbers) {
+	RandomEngine engine1{42}, engine2{42};
+	for (int i = 0; i < 100; ++i) {
+		BOOST_CHECK_EQUAL(engine1(), engine2());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(streams_of_the_same_seed_differ) {
+	RandomEngine stream0{42, 0}, stream1{42, 1}, other{43, 0};
+	auto first = stream0();
+	BOOST_CHECK_NE(first, stream1());
+	BOOST_CHECK_NE(first, other());
+	BOOST_CHECK_NE(RandomEngine::mixSeed(1, 2), RandomEngine::mixSeed(2, 1));
+}
+
+BOOST_AUTO_TEST_CASE(randomReal_is_in_range) {
+	RandomEngine engine{1};
+	float sum = 0.f;
+	for (int i = 0; i < 10000; ++i) {
+		float value = randomReal(engine, -2.f, 3.f);
+		BOOST_REQUIRE_GE(value, -2.f);
+		BOOST_REQUIRE_LE(value, 3.f);
+		sum += value;
+	}
+	BOOST_CHECK_CLOSE(sum / 10000, 0.5f, 10.);
+}
+
+BOOST_AUTO_TEST_CASE(randomInt_covers_both_ends) {
+	RandomEngine engine{1};
+	int counts[5] = {0};
+	for (int i = 0; i < 10000; ++i) {
+		int value = randomInt(engine, 3, 7);
+		BOOST_REQUIRE_GE(value, 3);
+		BOOST_REQUIRE_LE(value, 7);
+		++counts[value - 3];
+	}
+	for (int count : counts) {
+		BOOST_CHECK_GT(count, 1800);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()